@@ -0,0 +1,225 @@
+/**
+ * @file adcContinuous.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ * 
+ * @brief Implementation of adcContinuous class
+**/
+
+#include "adcContinuous.h"
+#include "soc/soc_caps.h"
+
+#include <string.h>
+
+static const char* TAG = "adc_dma";
+
+adcControl::adcContinuous::adcContinuous(){
+    handle = NULL;
+    attenuation = ADC_ATTEN_DB_11;
+    rate = defaultContinuousRate;
+    task_handle = NULL;
+    running = false;
+
+    frames = 0;
+    overflows = 0;
+
+    lock = xSemaphoreCreateMutex();
+    clear();
+}
+
+adcControl::adcContinuous::~adcContinuous(){
+    stop();
+    if(handle != NULL){
+        adc_continuous_deinit(handle);
+    }
+    vSemaphoreDelete(lock);
+}
+
+esp_err_t adcControl::adcContinuous::init(adc_atten_t atten){
+    attenuation = atten;
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = continuousBufferSize,
+        .conv_frame_size = continuousFrameSize,
+    };
+    esp_err_t ret = adc_continuous_new_handle(&handle_config, &handle);
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Failed to create handle (%s)", esp_err_to_name(ret));
+        handle = NULL;
+        return ret;
+    }
+
+    adc_continuous_evt_cbs_t callbacks = {
+        .on_conv_done = onFrame,
+        .on_pool_ovf = onOverflow,
+    };
+    ret = adc_continuous_register_event_callbacks(handle, &callbacks, this);
+    if(ret == ESP_OK){
+        ret = configure();
+    }
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Failed to set up scan (%s)", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t adcControl::adcContinuous::configure(){
+    adc_digi_pattern_config_t pattern[continuousChannels];
+
+    for(int i = 0; i < continuousChannels; i++){
+        pattern[i].atten = attenuation;
+        pattern[i].channel = i;
+        pattern[i].unit = ADC_UNIT_1;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_continuous_config_t config = {
+        .pattern_num = continuousChannels,
+        .adc_pattern = pattern,
+        .sample_freq_hz = rate,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    return adc_continuous_config(handle, &config);
+}
+
+esp_err_t adcControl::adcContinuous::setRate(uint32_t conversion_rate){
+    bool was_running = running;
+
+    if(conversion_rate < SOC_ADC_SAMPLE_FREQ_THRES_LOW) conversion_rate = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+    if(conversion_rate > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) conversion_rate = SOC_ADC_SAMPLE_FREQ_THRES_HIGH;
+    rate = conversion_rate;
+
+    if(handle == NULL){
+        return ESP_OK; //applied by init()
+    }
+
+    stop();
+    esp_err_t ret = configure();
+    if(ret == ESP_OK && was_running){
+        ret = start();
+    }
+
+    ESP_LOGI(TAG, "Scanning at %lu conversions/s", (unsigned long)rate);
+    return ret;
+}
+
+esp_err_t adcControl::adcContinuous::start(){
+    if(handle == NULL){
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(running){
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    clear();
+    xSemaphoreGive(lock);
+
+    running = true;
+    xTaskCreatePinnedToCore(task, "adc_dma", continuousStackSize, this, continuousPriority, &task_handle, 1);
+
+    esp_err_t ret = adc_continuous_start(handle);
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Failed to start (%s)", esp_err_to_name(ret));
+        stop();
+    }
+    return ret;
+}
+
+void adcControl::adcContinuous::stop(){
+    if(!running){
+        return;
+    }
+
+    adc_continuous_stop(handle);
+
+    //the task ends after its drain, so it never stops holding the lock
+    running = false;
+    if(task_handle != NULL) xTaskNotifyGive(task_handle);
+    while(task_handle != NULL){
+        vTaskDelay(1);
+    }
+}
+
+void adcControl::adcContinuous::clear(){
+    memset(history, 0, sizeof(history));
+    memset(head, 0, sizeof(head));
+    memset(count, 0, sizeof(count));
+    memset(sum, 0, sizeof(sum));
+}
+
+bool adcControl::adcContinuous::average(int channel, uint32_t *raw_out){
+    bool ret = false;
+
+    if(!running || channel < 0 || channel >= continuousChannels){
+        return false;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if(count[channel] > 0){
+        *raw_out = sum[channel] / count[channel];
+        ret = true;
+    }
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+void adcControl::adcContinuous::drain(){
+    uint32_t length = 0;
+
+    while(adc_continuous_read(handle, frame, sizeof(frame), &length, 0) == ESP_OK){
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for(uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES){
+            const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&frame[i];
+            int channel = result->type1.channel;
+            if(channel >= continuousChannels){
+                continue;
+            }
+
+            //replace the oldest reading in the running sum
+            uint16_t *slot = &history[channel][head[channel]];
+            sum[channel] += result->type1.data;
+            if(count[channel] == continuousHistory) sum[channel] -= *slot;
+            else count[channel]++;
+            *slot = result->type1.data;
+            head[channel] = (head[channel] + 1) % continuousHistory;
+        }
+        xSemaphoreGive(lock);
+
+        frames++;
+    }
+}
+
+void adcControl::adcContinuous::task(void *pvParameters){
+    adcContinuous *self = (adcContinuous *)pvParameters;
+
+    while(1){
+        //woken once per frame by onFrame()
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if(!self->running){
+            break;
+        }
+        self->drain();
+    }
+
+    self->task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+bool IRAM_ATTR adcControl::adcContinuous::onFrame(adc_continuous_handle_t, const adc_continuous_evt_data_t *, void *user_data){
+    adcContinuous *self = (adcContinuous *)user_data;
+    BaseType_t woken = pdFALSE;
+
+    if(self->task_handle != NULL){
+        vTaskNotifyGiveFromISR(self->task_handle, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+bool IRAM_ATTR adcControl::adcContinuous::onOverflow(adc_continuous_handle_t, const adc_continuous_evt_data_t *, void *user_data){
+    adcContinuous *self = (adcContinuous *)user_data;
+
+    self->overflows++;
+    return false;
+}
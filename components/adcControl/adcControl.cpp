@@ -9,6 +9,14 @@
 static const char* TAG = "adc";
 
 adcControl::adc::adc(){
+    adc1_handle = NULL;
+    adc2_handle = NULL;
+    continuous = false;
+    powered = false;
+    sweep_time = 0;
+}
+
+void adcControl::adc::init(){
     //adc1 setup
     adc_oneshot_unit_init_cfg_t init_config1 = {
         .unit_id = ADC_UNIT_1,
@@ -36,6 +44,9 @@ adcControl::adc::adc(){
 
     adc_cali_create_scheme_line_fitting(&cali_config_unit1, &cali_handle_unit1);
 
+    //adc1 continuous scan, started by setContinuous()
+    adc1_dma.init(adcAttenuation);
+
     //adc2 setup
     adc_oneshot_unit_init_cfg_t init_config2 = {
         .unit_id = ADC_UNIT_2,
@@ -60,6 +71,10 @@ adcControl::adc::adc(){
 
     adc_cali_create_scheme_line_fitting(&cali_config_unit2, &cali_handle_unit2);
 
+    //conversion tables, from each unit's calibration
+    buildTable(&tables[0], cali_handle_unit1);
+    buildTable(&tables[1], cali_handle_unit2);
+
     //gpio power
     gpio_config_t io_conf = {
         .pin_bit_mask = (uint64_t)0x1 << adcControl::adcPin,
@@ -74,6 +89,10 @@ adcControl::adc::adc(){
 }
 
 adcControl::adc::~adc(){
+    if(!isReady()){
+        return;
+    }
+
     adc_oneshot_del_unit(adc1_handle);
     adc_oneshot_del_unit(adc2_handle);
 
@@ -88,14 +107,28 @@ adcControl::adc::~adc(){
 
 void adcControl::adc::powerOn(){
     gpio_set_level(adcControl::adcPin, 1);
+    powered = true;
+    if(continuous) adc1_dma.start();
     ESP_LOGI(TAG, "Thermister Power On");
 }
 
 void adcControl::adc::powerOff(){
+    adc1_dma.stop();
+    powered = false;
     gpio_set_level(adcControl::adcPin, 0);
     ESP_LOGI(TAG, "Thermister Power Off");
 }
 
+esp_err_t adcControl::adc::setContinuous(bool enable){
+    continuous = enable;
+
+    if(!enable){
+        adc1_dma.stop();
+        return ESP_OK;
+    }
+    return powered ? adc1_dma.start() : ESP_OK;
+}
+
 void adcControl::adc::readADC1(int *value_out, adc_channel_t channel){
     int ignore, buffer;
     
@@ -125,17 +158,18 @@ float adcControl::adc::sample(int sensor){
     int adc_channel; //adc channel irrespective of adc unit
     uint32_t reading = 0; //adc read value
     uint32_t average_reading; //average of samples
-    int voltage; //read value converted to voltage value
-    float resistance; //calculated resistance of thermistor given voltage
-    float temperature; //calculated temperature from thermistor's resistance
 
-    //Convert sensor value to channel value considering the appropriate unit and unsused adc channels
-    if(sensor > 9) adc_channel = sensor - 6;
-    else if(sensor > 8) adc_channel = sensor - 7; //skip adc2_1 if using adc2_0
-    else if(sensor > 7) adc_channel = sensor - 8; //reset count to adc2 if using adc2_0
-    //else if(sensor > 7) adc_channel = sensor - 7; //reset count to adc2 and skip adc2_0 if using adc2_1
-    else adc_channel = sensor;
+    adc_channel = channelOf(sensor);
     
+    //ADC1 is owned by the continuous scan while it runs
+    if(sensor < continuousChannels && adc1_dma.isRunning()){
+        if(!adc1_dma.average(adc_channel, &average_reading)){
+            ESP_LOGD(TAG, "Sensor %i not scanned yet", (int)sensor);
+            return NAN;
+        }
+        return convert(sensor, average_reading);
+    }
+
     //sample ADC loop
     for (int i = 0; i < numSamples; i++)
     {
@@ -147,19 +181,88 @@ float adcControl::adc::sample(int sensor){
     } //sampling loop
     average_reading = reading / numSamples; //divide loop sum by number of samples to find average sample reading
 
+    return convert(sensor, average_reading);
+}
+
+uint32_t adcControl::adc::sampleAll(float *temperature_out){
+    int64_t start = esp_timer_get_time();
+
+    for(int sensor = 0; sensor < numSensors; sensor++){
+        int adc_channel = channelOf(sensor);
+        uint32_t average_reading;
+
+        //ADC1 is owned by the continuous scan while it runs
+        if(sensor < continuousChannels && adc1_dma.isRunning()){
+            if(!adc1_dma.average(adc_channel, &average_reading)){
+                temperature_out[sensor] = NAN;
+                continue;
+            }
+            temperature_out[sensor] = convert(sensor, average_reading);
+            continue;
+        }
+
+        //one discarded read after switching channel, then every sample
+        adc_oneshot_unit_handle_t handle = sensor < 8 ? adc1_handle : adc2_handle;
+        int buffer;
+        uint32_t reading = 0;
+
+        adc_oneshot_read(handle, (adc_channel_t)adc_channel, &buffer); //ignore first reading
+        for(int i = 0; i < numSamples; i++){
+            adc_oneshot_read(handle, (adc_channel_t)adc_channel, &buffer);
+            reading += buffer;
+        }
+        average_reading = reading / numSamples;
+
+        temperature_out[sensor] = convert(sensor, average_reading);
+    }
+
+    sweep_time = esp_timer_get_time() - start;
+    ESP_LOGD(TAG, "Sensors swept in %ius", (int)sweep_time);
+
+    return sweep_time;
+}
+
+int adcControl::adc::channelOf(int sensor){
+    //Convert sensor value to channel value considering the appropriate unit and unsused adc channels
+    if(sensor > 9) return sensor - 6;
+    else if(sensor > 8) return sensor - 7; //skip adc2_1 if using adc2_0
+    else if(sensor > 7) return sensor - 8; //reset count to adc2 if using adc2_0
+    //else if(sensor > 7) return sensor - 7; //reset count to adc2 and skip adc2_0 if using adc2_1
+    else return sensor;
+}
+
+float adcControl::adc::convert(int sensor, uint32_t average_reading){
+    float temperature;
+
+    if(!tables[sensor < 8 ? 0 : 1].lookup(average_reading, &temperature)){
+        temperature = convertExact(sensor < 8 ? cali_handle_unit1 : cali_handle_unit2, average_reading);
+    }
+    ESP_LOGD(TAG, "Sensor %i sampled at %f", (int)sensor, (float)temperature);
+
+    return temperature;
+}
+
+float adcControl::adc::convertExact(adc_cali_handle_t cali_handle, uint32_t average_reading){
+    int voltage; //read value converted to voltage value
+    float resistance; //calculated resistance of thermistor given voltage
+    float temperature; //calculated temperature from thermistor's resistance
+
     //Convert sample reading to a voltage (mV) using adc characteristics
-    if(sensor < 8) adc_cali_raw_to_voltage(cali_handle_unit1, average_reading, &voltage);
-    else adc_cali_raw_to_voltage(cali_handle_unit2, average_reading, &voltage);
+    adc_cali_raw_to_voltage(cali_handle, average_reading, &voltage);
     
     //Convert voltage to temperature (K) usin thermistor characteristics
     resistance = ((thermistorNominal*supplyVoltage)/voltage)-thermistorNominal;
     temperature = (bCoefficient/log(resistance/r_inf))-kelvin;
-    ESP_LOGD(TAG, "Sensor %i sampled at %f", (int)sensor, (float)temperature);
-
 
     return temperature;
 }
 
+void adcControl::adc::buildTable(thermistorTable *table, adc_cali_handle_t cali_handle){
+    for(int point = 0; point < tablePoints; point++){
+        table->set(point, convertExact(cali_handle, thermistorTable::rawOf(point)));
+    }
+}
+
 float adcControl::adc::test(){
     float average = 0;
 
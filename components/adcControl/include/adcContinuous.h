@@ -0,0 +1,140 @@
+/**
+ * @file adcContinuous.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ * 
+ * @brief Continuous DMA sampling of the ADC1 thermistor bank
+**/
+
+#ifndef _adcContinuous_H_included
+#define _adcContinuous_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#include "esp_adc/adc_continuous.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <stdint.h>
+
+namespace adcControl{
+    //continuous config
+    constexpr int continuousChannels = 8; //ADC1 channels 0-7, sensors 0-7
+    constexpr int continuousHistory = 256; //newest readings kept per channel for averaging
+    constexpr uint32_t continuousFrameSize = 1024; //bytes of conversions per DMA frame
+    constexpr uint32_t continuousBufferSize = continuousFrameSize * 4; //bytes the driver buffers between drains
+    constexpr uint32_t defaultContinuousRate = 20000; //conversions per second over every channel
+    constexpr uint32_t continuousStackSize = 3072;
+    constexpr UBaseType_t continuousPriority = 2; //drains a frame in well under a frame time
+
+    /**
+     * @brief Scans ADC1 channels 0-7 into a ring of recent readings per channel
+     * @note - The ADC digital controller converts and DMA fills frames with no CPU;
+     * a task woken once per frame sorts the frame into the channel rings
+     * @note - average() is the mean of the newest continuousHistory readings of a
+     * channel, kept as a running sum, so a sweep does no conversions
+     * @note - ADC2 can not be sampled by DMA on the ESP32 and is read in oneshot mode
+     */
+    class adcContinuous{
+    public:
+        /**
+         * @brief Construct a new adc Continuous object
+         * @note call init() before use
+         *
+         */
+        adcContinuous();
+        ~adcContinuous();
+
+        /**
+         * @brief Creates the driver handle and sets up the scan of every channel
+         *
+         * @param atten attenuation of every channel
+         * @return esp_err_t
+         */
+        esp_err_t init(adc_atten_t atten);
+
+        /**
+         * @brief Starts conversions and the drain task
+         * @note readings from before are dropped
+         *
+         * @return esp_err_t
+         */
+        esp_err_t start();
+
+        /**
+         * @brief Stops conversions and the drain task
+         * @note returns once the task has ended, so the buffers can be reused
+         *
+         */
+        void stop();
+
+        /**
+         * @brief Set how fast the channels are scanned
+         * @note restarts the scan if it was running
+         *
+         * @param rate conversions per second over every channel, clamped to
+         * what the ADC supports
+         * @return esp_err_t
+         */
+        esp_err_t setRate(uint32_t rate);
+
+        /**
+         * @brief Get the mean of the newest readings of a channel
+         *
+         * @param channel ADC1 channel, 0-7
+         * @param raw_out mean raw reading
+         * @return true if the channel has been read since start();
+         * @return false if not, or the scan is not running
+         */
+        bool average(int channel, uint32_t *raw_out);
+
+        inline bool isRunning(){
+            return running;
+        }
+        inline uint32_t getRate(){
+            return rate;
+        }
+        inline uint32_t getFrames(){
+            return frames;
+        }
+        inline uint32_t getOverflows(){
+            return overflows;
+        }
+        inline uint32_t getReadings(int channel){
+            return channel >= 0 && channel < continuousChannels ? count[channel] : 0;
+        }
+
+    private:
+        static void task(void *pvParameters);
+        static bool onFrame(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data); //ISR
+        static bool onOverflow(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data); //ISR
+        esp_err_t configure(); //applies rate and atten; scan must be stopped
+        void drain(); //sorts every buffered frame into the channel rings
+        void clear(); //drops every reading; lock must be held
+
+        adc_continuous_handle_t handle;
+        adc_atten_t attenuation;
+        uint32_t rate;
+        TaskHandle_t task_handle; //cleared by the task as it ends
+        volatile bool running; //cleared to end the task
+
+        //newest readings of each channel
+        uint16_t history[continuousChannels][continuousHistory];
+        int head[continuousChannels]; //next slot written
+        uint32_t count[continuousChannels]; //readings kept, at most continuousHistory
+        uint32_t sum[continuousChannels]; //of the readings kept
+
+        uint8_t frame[continuousFrameSize];
+
+        //metrics
+        uint32_t frames; //frames drained
+        volatile uint32_t overflows; //times the driver buffer filled before a drain
+
+        SemaphoreHandle_t lock;
+    };
+}
+
+#endif // _adcContinuous_H_included
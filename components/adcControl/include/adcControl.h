@@ -13,9 +13,13 @@
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
+#include "esp_timer.h"
 
 #include "driver/gpio.h"
 
+#include "adcContinuous.h"
+#include "thermistorTable.h"
+
 #include <stdio.h>
 #include <math.h>
 
@@ -48,25 +52,57 @@ namespace adcControl{
     public:
         /**
          * @brief Construct a new Sensor Core object
-         * @note Constructor sets time to time at compile
+         * @note call init() before use; the constructor does not touch the
+         * ADC units, so a global adc does not hold up start-up
          * 
          */
         adc();
         ~adc();
 
+        /**
+         * @brief Sets up both ADC units, their channels and calibration, and
+         * the thermistor power pin (off)
+         * 
+         */
+        void init();
+
+        inline bool isReady(){
+            return adc2_handle != NULL;
+        }
+
         /**
          * @brief Turn on GPIO power to thermistors
          * @note Power must be turned on for thermistors to read
          * @note Power needs to be on for at least 7 seconds for thermistor readings to stabilize.
+         * @note Starts the continuous scan if it is enabled
          */
         void powerOn();
 
         /**
          * @brief Turn off GPIO power to thermistors
+         * @note Stops the continuous scan
          * 
          */
         void powerOff();
 
+        inline bool isPowered(){
+            return powered;
+        }
+
+        /**
+         * @brief Samples sensors 0-7 from the continuous ADC1 scan instead
+         * of oneshot reads. Sensors 8-15 are always read in oneshot mode.
+         * @note the scan only runs while the thermistors are powered
+         * 
+         * @param enable if false, sensors 0-7 are read in oneshot mode again
+         * @return esp_err_t
+         */
+        esp_err_t setContinuous(bool enable);
+
+        inline adcContinuous *getContinuous(){
+            return &adc1_dma;
+        }
+
         /**
          * @brief Single read of an ADC1 channel
          * 
@@ -85,21 +121,83 @@ namespace adcControl{
 
         /**
          * @brief Samples adc at given sensor
+         * @note sensors 0-7 are the mean of the newest continuousHistory
+         * readings while the continuous scan runs, else numSamples oneshot reads
          * 
          * @param sensor integer number of sensor; 0 -> 15
-         * @return float temperature value in Kelvin
+         * @return float temperature value in Kelvin, NaN if the scan has
+         * not read the sensor yet
          */
         float sample(int sensor);
 
+        /**
+         * @brief Samples every sensor in one sweep
+         * @note each oneshot channel is read numSamples times after a single
+         * discarded read, instead of a discarded read before every sample
+         * @note sensors 0-7 come from the continuous scan while it runs
+         * 
+         * @param temperature_out array of numSensors temperatures in Kelvin,
+         * NaN if the scan has not read a sensor yet
+         * @return uint32_t duration of the sweep in microseconds
+         */
+        uint32_t sampleAll(float *temperature_out);
+
+        inline uint32_t getSweepTime(){
+            return sweep_time;
+        }
+
         float test();
 
     private:
+        /**
+         * @brief Get the channel of a sensor on its adc unit
+         * 
+         * @param sensor integer number of sensor; 0 -> 15
+         * @return int adc channel
+         */
+        int channelOf(int sensor);
+
+        /**
+         * @brief Converts a raw reading to a temperature
+         * @note uses the unit's table, or convertExact() outside of it
+         * 
+         * @param sensor integer number of sensor; 0 -> 15
+         * @param average_reading adc reading
+         * @return float temperature value in Kelvin
+         */
+        float convert(int sensor, uint32_t average_reading);
+
+        /**
+         * @brief Converts a raw reading through the calibration and the
+         * thermistor's Beta equation
+         * 
+         * @param cali_handle calibration of the reading's unit
+         * @param average_reading adc reading
+         * @return float temperature value in Kelvin
+         */
+        float convertExact(adc_cali_handle_t cali_handle, uint32_t average_reading);
+
+        /**
+         * @brief Fills a conversion table from a unit's calibration
+         * 
+         * @param table table to fill
+         * @param cali_handle calibration of the table's unit
+         */
+        void buildTable(thermistorTable *table, adc_cali_handle_t cali_handle);
+
+        adcContinuous adc1_dma; //continuous scan of sensors 0-7
+        bool continuous; //if true, sensors 0-7 are read from adc1_dma
+        bool powered; //thermistor power
+        uint32_t sweep_time; //duration of the last sampleAll() in microseconds
+
         //should have a handle for each channel, but this seems to work fine
         adc_oneshot_unit_handle_t adc1_handle;
         adc_oneshot_unit_handle_t adc2_handle;
         
         adc_cali_handle_t cali_handle_unit1 = NULL;
         adc_cali_handle_t cali_handle_unit2 = NULL;
+
+        thermistorTable tables[2]; //raw to temperature of each unit
         
         const float r_inf = thermistorNominal*exp((-bCoefficient)/(kelvin+temperatureNominal)); //thermistor's resistance at nominal temperature
 
@@ -0,0 +1,174 @@
+/**
+ * @file samplingService.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ * 
+ * @brief Single owner of thermistor sweeps, shared by every reader
+**/
+
+#ifndef _samplingService_H_included
+#define _samplingService_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "adcControl.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#include <stdint.h>
+#include <sys/time.h>
+
+namespace adcControl{
+    //service config
+    constexpr int maxSubscribers = 4; //one per log stream
+    constexpr uint32_t idleSweepInterval = 1000; //milli-seconds a snapshot is fresh for refresh() with no subscribers, and the sweep interval of subscribers with none
+    constexpr uint32_t samplingStackSize = 3072;
+    constexpr UBaseType_t samplingPriority = 3; //alongside the experiment logger
+
+    /**
+     * @brief One sweep of every sensor
+     */
+    struct snapshot{
+        uint32_t sequence; //sweeps since start, 0 before the first
+        int64_t seconds; //wall time of the sweep
+        int32_t microseconds;
+        uint32_t sweep_time; //microseconds the sweep took
+        float temperature[numSensors]; //NaN before the first sweep, and while the thermistors are unpowered
+    };
+
+    /**
+     * @brief Task that owns the adc and sweeps it for every reader
+     * @note - Sweeps run at the interval of the fastest subscriber; each subscriber
+     * is woken at its own interval, on the sweep nearest its due time, so readers
+     * with the same interval share every sweep
+     * @note - The newest sweep is double buffered: the task fills the back buffer and
+     * swaps, so latest() is a copy and never waits on the ADC
+     * @note - With no subscribers there are no sweeps; refresh() sweeps on request
+     * @note - While the thermistors are unpowered the ADC is not read; the sweep
+     * is all NaN
+     */
+    class samplingService{
+    public:
+        /**
+         * @brief Construct a new sampling Service object
+         * 
+         * @param sensor adc swept by the service; nothing else should sample it
+         */
+        samplingService(adc *sensor);
+        ~samplingService();
+
+        /**
+         * @brief Starts the sweep task
+         * @note call once the adc is initialized
+         * 
+         * @return esp_err_t
+         */
+        esp_err_t start();
+
+        /**
+         * @brief Stops the sweep task
+         * 
+         */
+        void stop();
+
+        /**
+         * @brief Wakes the calling reader at an interval
+         * @note the first sweep is right away
+         * 
+         * @param slot subscriber; 0 -> maxSubscribers - 1
+         * @param interval milli-seconds between wake ups
+         * @return true if subscribed;
+         * @return false if the slot does not exist
+         */
+        bool subscribe(int slot, uint32_t interval);
+
+        /**
+         * @brief Stops waking a subscriber
+         * @note a subscriber blocked in wait() is woken, and wait() returns false
+         * 
+         * @param slot subscriber
+         */
+        void unsubscribe(int slot);
+
+        /**
+         * @brief Changes a subscriber's interval
+         * @note takes effect from its next wake up
+         * 
+         * @param slot subscriber
+         * @param interval milli-seconds between wake ups
+         */
+        void setInterval(int slot, uint32_t interval);
+
+        /**
+         * @brief Blocks until the subscriber is due a sweep
+         * @note holds no lock while blocked
+         * 
+         * @param slot subscriber
+         * @param timeout ticks to wait
+         * @return true if a sweep is ready; read it with latest();
+         * @return false on timeout, or if the slot is not subscribed or was unsubscribed while waiting
+         */
+        bool wait(int slot, TickType_t timeout);
+
+        /**
+         * @brief Copies the newest sweep
+         * 
+         * @param snapshot_out newest sweep
+         */
+        void latest(snapshot *snapshot_out);
+
+        /**
+         * @brief Sweeps now if there are no subscribers and the newest
+         * sweep is older than idleSweepInterval
+         * @note one caller at a time; blocks for the sweep
+         * 
+         * @param timeout ticks to wait for the sweep
+         * @return true if the newest sweep is fresh; read it with latest();
+         * @return false on timeout or if the service is not running
+         */
+        bool refresh(TickType_t timeout);
+
+    private:
+        static void task(void *pvParameters);
+
+        /**
+         * @brief Sweeps into the back buffer and swaps it in
+         * @note fills the back buffer with NaN instead while the
+         * thermistors are unpowered
+         * 
+         */
+        void sweep();
+
+        /**
+         * @brief Get the fastest subscriber's interval
+         * 
+         * @return uint32_t milli-seconds, 0 with no subscribers
+         */
+        uint32_t period();
+
+        struct subscriber{
+            bool active;
+            uint32_t interval; //milli-seconds between wake ups
+            int64_t due; //esp_timer time of the next wake up
+            SemaphoreHandle_t ready; //given when due
+        };
+
+        adc *sensor;
+        TaskHandle_t handle;
+        volatile bool running; //cleared to end the task
+        portMUX_TYPE lock; //guards the subscribers and the buffer swap
+
+        subscriber subscribers[maxSubscribers];
+        snapshot buffers[2];
+        int front; //buffer returned by latest()
+        int64_t next_sweep; //esp_timer time of the next sweep
+        int64_t swept_at; //esp_timer time of the newest sweep, 0 before the first
+        bool requested; //if true, refresh() is waiting on a sweep
+        SemaphoreHandle_t swept; //given after a requested sweep
+    };
+}
+
+#endif // _samplingService_H_included
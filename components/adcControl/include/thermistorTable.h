@@ -0,0 +1,84 @@
+/**
+ * @file thermistorTable.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ * 
+ * @brief Interpolated raw-to-temperature table of one ADC unit
+**/
+
+#ifndef _thermistorTable_H_included
+#define _thermistorTable_H_included
+
+#include <stdint.h>
+#include <math.h>
+
+namespace adcControl{
+    //table config
+    constexpr int tableShift = 4; //a point every 2^tableShift raw codes
+    constexpr int tableStep = 1 << tableShift;
+    constexpr int tableMaxRaw = 4095; //12 bit readings
+    constexpr int tablePoints = (tableMaxRaw >> tableShift) + 2; //257: every tableStep codes, and the last code
+
+    /**
+     * @brief Temperatures of evenly spaced raw codes, interpolated in between
+     * @note - Built once per unit from its calibration, so a conversion is two
+     * table loads and a multiply-add instead of a calibration, a division and a log()
+     * @note - Within about 0.3 degrees of the exact conversion from -40 to 125 C; the
+     * exact path rounds to whole millivolts, which is most of the difference
+     * @note - Segments next to a code with no finite temperature (the ends of the
+     * range) are not interpolated; lookup() fails and the exact path is used
+     */
+    class thermistorTable{
+    public:
+        thermistorTable();
+
+        /**
+         * @brief Get the raw code of a point
+         * 
+         * @param point from 0 to tablePoints - 1
+         * @return int raw code
+         */
+        static inline int rawOf(int point){
+            return point * tableStep < tableMaxRaw ? point * tableStep : tableMaxRaw;
+        }
+
+        /**
+         * @brief Set the temperature of a point
+         * @note the table is used once every point is set
+         * 
+         * @param point from 0 to tablePoints - 1
+         * @param temperature exact conversion of rawOf(point)
+         */
+        void set(int point, float temperature);
+
+        /**
+         * @brief Converts a raw reading
+         * 
+         * @param raw adc reading
+         * @param temperature_out interpolated temperature
+         * @return true if converted;
+         * @return false if the table is not built or the reading is outside it
+         */
+        inline bool lookup(uint32_t raw, float *temperature_out){
+            if(points_set < tablePoints || raw > (uint32_t)tableMaxRaw){
+                return false;
+            }
+
+            int point = raw >> tableShift;
+            float low = points[point];
+            float high = points[point + 1];
+            if(!isfinite(low) || !isfinite(high)){
+                return false;
+            }
+
+            int start = point << tableShift;
+            *temperature_out = low + (high - low) * (int)(raw - start) / (rawOf(point + 1) - start);
+            return true;
+        }
+
+    private:
+        float points[tablePoints];
+        int points_set;
+    };
+}
+
+#endif // _thermistorTable_H_included
@@ -0,0 +1,290 @@
+/**
+ * @file samplingService.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ * 
+ * @brief Implementation of samplingService class
+**/
+
+#include "samplingService.h"
+static const char* TAG = "sampling";
+
+adcControl::samplingService::samplingService(adc *sensor){
+    this->sensor = sensor;
+    handle = NULL;
+    running = false;
+    lock = portMUX_INITIALIZER_UNLOCKED;
+    front = 0;
+    next_sweep = 0;
+    swept_at = 0;
+    requested = false;
+    swept = NULL;
+
+    for(int slot = 0; slot < maxSubscribers; slot++){
+        subscribers[slot].active = false;
+        subscribers[slot].interval = 0;
+        subscribers[slot].due = 0;
+        subscribers[slot].ready = NULL;
+    }
+
+    for(int i = 0; i < 2; i++){
+        buffers[i].sequence = 0;
+        buffers[i].seconds = 0;
+        buffers[i].microseconds = 0;
+        buffers[i].sweep_time = 0;
+        for(int sensor_number = 0; sensor_number < numSensors; sensor_number++){
+            buffers[i].temperature[sensor_number] = NAN;
+        }
+    }
+}
+
+adcControl::samplingService::~samplingService(){
+    stop();
+
+    for(int slot = 0; slot < maxSubscribers; slot++){
+        if(subscribers[slot].ready != NULL) vSemaphoreDelete(subscribers[slot].ready);
+    }
+    if(swept != NULL) vSemaphoreDelete(swept);
+}
+
+esp_err_t adcControl::samplingService::start(){
+    if(running){
+        return ESP_OK;
+    }
+
+    for(int slot = 0; slot < maxSubscribers; slot++){
+        if(subscribers[slot].ready == NULL) subscribers[slot].ready = xSemaphoreCreateBinary();
+        if(subscribers[slot].ready == NULL){
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if(swept == NULL) swept = xSemaphoreCreateBinary();
+    if(swept == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+
+    running = true;
+    next_sweep = esp_timer_get_time();
+    if(xTaskCreatePinnedToCore(task, "sampling", samplingStackSize, this, samplingPriority, &handle, 1) != pdPASS){
+        running = false;
+        handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Sampling service started");
+    return ESP_OK;
+}
+
+void adcControl::samplingService::stop(){
+    if(!running){
+        return;
+    }
+
+    //the task ends after its sweep
+    running = false;
+    xTaskNotifyGive(handle);
+    while(handle != NULL){
+        vTaskDelay(1);
+    }
+    ESP_LOGI(TAG, "Sampling service stopped");
+}
+
+bool adcControl::samplingService::subscribe(int slot, uint32_t interval){
+    if(slot < 0 || slot >= maxSubscribers){
+        return false;
+    }
+
+    //drop a wake up left from an earlier subscription
+    if(subscribers[slot].ready != NULL) xSemaphoreTake(subscribers[slot].ready, 0);
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    subscribers[slot].active = true;
+    subscribers[slot].interval = interval;
+    subscribers[slot].due = now;
+    next_sweep = now;
+    portEXIT_CRITICAL(&lock);
+
+    if(handle != NULL) xTaskNotifyGive(handle);
+    ESP_LOGD(TAG, "Subscriber %i every %ims", slot, (int)interval);
+    return true;
+}
+
+void adcControl::samplingService::unsubscribe(int slot){
+    if(slot < 0 || slot >= maxSubscribers){
+        return;
+    }
+
+    portENTER_CRITICAL(&lock);
+    subscribers[slot].active = false;
+    portEXIT_CRITICAL(&lock);
+
+    //wake the subscriber if it waits, wait() then returns false
+    if(subscribers[slot].ready != NULL) xSemaphoreGive(subscribers[slot].ready);
+}
+
+void adcControl::samplingService::setInterval(int slot, uint32_t interval){
+    if(slot < 0 || slot >= maxSubscribers){
+        return;
+    }
+
+    bool sooner = false;
+    portENTER_CRITICAL(&lock);
+    if(subscribers[slot].interval != interval){
+        subscribers[slot].due += ((int64_t)interval - subscribers[slot].interval) * 1000;
+        subscribers[slot].interval = interval;
+
+        //a faster subscriber needs the sweep rate now, not after the current period
+        if(subscribers[slot].active && subscribers[slot].due < next_sweep){
+            next_sweep = subscribers[slot].due;
+            sooner = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if(sooner && handle != NULL) xTaskNotifyGive(handle);
+}
+
+bool adcControl::samplingService::wait(int slot, TickType_t timeout){
+    if(slot < 0 || slot >= maxSubscribers || !subscribers[slot].active || subscribers[slot].ready == NULL){
+        return false;
+    }
+
+    return xSemaphoreTake(subscribers[slot].ready, timeout) == pdTRUE && subscribers[slot].active;
+}
+
+void adcControl::samplingService::latest(snapshot *snapshot_out){
+    portENTER_CRITICAL(&lock);
+    *snapshot_out = buffers[front];
+    portEXIT_CRITICAL(&lock);
+}
+
+bool adcControl::samplingService::refresh(TickType_t timeout){
+    if(handle == NULL || swept == NULL){
+        return false;
+    }
+
+    //subscribers keep the snapshot at most their interval old
+    if(period() != 0){
+        return true;
+    }
+
+    int64_t now = esp_timer_get_time();
+    bool fresh;
+    portENTER_CRITICAL(&lock);
+    fresh = swept_at != 0 && now - swept_at < (int64_t)idleSweepInterval * 1000;
+    portEXIT_CRITICAL(&lock);
+    if(fresh){
+        return true;
+    }
+
+    //drop a sweep given after an earlier timeout
+    xSemaphoreTake(swept, 0);
+
+    portENTER_CRITICAL(&lock);
+    requested = true;
+    next_sweep = now;
+    portEXIT_CRITICAL(&lock);
+
+    xTaskNotifyGive(handle);
+    return xSemaphoreTake(swept, timeout) == pdTRUE;
+}
+
+void adcControl::samplingService::task(void *pvParameters){
+    samplingService *service = (samplingService *) pvParameters;
+
+    while(service->running){
+        //sleep until the next sweep, or until a subscriber needs one sooner
+        int64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&service->lock);
+        int64_t next = service->next_sweep;
+        bool requested = service->requested;
+        portEXIT_CRITICAL(&service->lock);
+
+        //no subscribers; sleep until one subscribes or refresh() asks for a sweep
+        if(!requested && service->period() == 0){
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if(now < next){
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((next - now) / 1000) + 1);
+            continue;
+        }
+
+        service->sweep();
+        now = esp_timer_get_time();
+
+        //wake every subscriber due by the middle of the next period
+        uint32_t period = service->period();
+        SemaphoreHandle_t due[maxSubscribers];
+        int due_count = 0;
+
+        portENTER_CRITICAL(&service->lock);
+        for(int slot = 0; slot < maxSubscribers; slot++){
+            subscriber *sub = &service->subscribers[slot];
+            if(!sub->active || sub->due > now + (int64_t)period * 500){
+                continue;
+            }
+
+            due[due_count++] = sub->ready;
+            sub->due += (int64_t)sub->interval * 1000;
+            if(sub->due < now) sub->due = now + (int64_t)sub->interval * 1000;
+        }
+
+        service->next_sweep = next + (int64_t)period * 1000;
+        if(service->next_sweep < now) service->next_sweep = now + (int64_t)period * 1000;
+        requested = service->requested;
+        service->requested = false;
+        portEXIT_CRITICAL(&service->lock);
+
+        for(int i = 0; i < due_count; i++){
+            xSemaphoreGive(due[i]);
+        }
+        if(requested) xSemaphoreGive(service->swept);
+    }
+
+    service->handle = NULL;
+    vTaskDelete(NULL);
+}
+
+void adcControl::samplingService::sweep(){
+    snapshot *back = &buffers[front ^ 1];
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    if(sensor->isPowered()){
+        back->sweep_time = sensor->sampleAll(back->temperature);
+    }
+    else{
+        //unpowered thermistors read nothing useful; leave the ADC alone
+        back->sweep_time = 0;
+        for(int sensor_number = 0; sensor_number < numSensors; sensor_number++){
+            back->temperature[sensor_number] = NAN;
+        }
+    }
+    back->seconds = tv.tv_sec;
+    back->microseconds = tv.tv_usec;
+    back->sequence = buffers[front].sequence + 1;
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    front ^= 1;
+    swept_at = now;
+    portEXIT_CRITICAL(&lock);
+}
+
+uint32_t adcControl::samplingService::period(){
+    uint32_t fastest = 0;
+    bool subscribed = false;
+
+    portENTER_CRITICAL(&lock);
+    for(int slot = 0; slot < maxSubscribers; slot++){
+        if(!subscribers[slot].active) continue;
+        subscribed = true;
+        if(subscribers[slot].interval == 0) continue;
+        if(fastest == 0 || subscribers[slot].interval < fastest) fastest = subscribers[slot].interval;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    //subscribers with no interval are woken every idleSweepInterval
+    return subscribed && fastest == 0 ? idleSweepInterval : fastest;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file thermistorTable.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ * 
+ * @brief Implementation of thermistorTable class
+**/
+
+#include "thermistorTable.h"
+
+adcControl::thermistorTable::thermistorTable(){
+    for(int i = 0; i < tablePoints; i++){
+        points[i] = NAN;
+    }
+    points_set = 0;
+}
+
+void adcControl::thermistorTable::set(int point, float temperature){
+    if(point < 0 || point >= tablePoints){
+        return;
+    }
+
+    points[point] = temperature;
+    if(point == points_set) points_set++;
+}
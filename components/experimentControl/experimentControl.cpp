@@ -9,8 +9,12 @@
 
 experimentControl::Experiment::Experiment(){
     status = false;
+    halt_flag = false;
     logger_status = false;
     passive_logger_status = false;
+    passive_logger_busy = false;
+    log_format = LOG_CSV;
+    log_stream = LOG_STREAM_EXPERIMENT;
     pwm_duty = new uint8_t[maxStages];
     length = new uint32_t[maxStages];
 
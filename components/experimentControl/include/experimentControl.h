@@ -36,6 +36,17 @@ namespace experimentControl{
     constexpr int EXP_STARTUP = 2;
     constexpr int EXP_COOLDOWN = 3;
 
+    //log formats
+    constexpr uint8_t LOG_CSV = 0; //one .csv line per sample
+    constexpr uint8_t LOG_BINARY = 1; //one telemetryControl::Record per sample
+    constexpr uint8_t LOG_COMPRESSED = 2; //telemetryControl::Compressor blocks
+    constexpr int logFormats = 3;
+
+    //log streams
+    constexpr uint8_t LOG_STREAM_EXPERIMENT = 0; //written by the experiment logger
+    constexpr uint8_t LOG_STREAM_PASSIVE = 1; //written by the passive logger
+    constexpr int logStreams = 2;
+
     /**
      * @brief Experiment parameter structure
      * @note - Holds all parameters and settings needed to run an experiment
@@ -57,8 +68,12 @@ namespace experimentControl{
         float max_temperature; //Temperature threshold to trigger safe mode
         int status; //Indicates what stage the  experiment task is in.
         bool stop_flag; //If set to true, active experiment will exit once current PWM stage is completed
+        bool halt_flag; //If set to true, active experiment exits now, skipping its cooldown
         bool logger_status; //if true, logger is active
         bool passive_logger_status; //if true, passive logger is active
+        bool passive_logger_busy; //if true, passive logger is taking a sample
+        uint8_t log_format; //Format that loggers write telemetry in (LOG_CSV, LOG_BINARY or LOG_COMPRESSED)
+        uint8_t log_stream; //Stream read from the log (LOG_STREAM_EXPERIMENT or LOG_STREAM_PASSIVE)
 
         /* methods */
 
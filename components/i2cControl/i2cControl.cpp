@@ -26,7 +26,7 @@ i2cControl::i2cSlave::i2cSlave(gpio_num_t sda_io_pin, gpio_num_t scl_io_pin, uin
     config.clk_flags = 0;
 
     opcode_counter = -1;
-    opcode_counter = -1;
+    opcode_ignore_counter = -1;
 
     operation = new opcode_t;
     rx_param = new byte;
@@ -128,22 +128,19 @@ void i2cControl::i2cSlave::write_four_bytes(byte4 tx_data){
     i2c_slave_write_buffer(i2cPort, tx_buffer, tx_size, 0);
 }
 
-void i2cControl::i2cSlave::write_string(std::string tx_data){
-    int tx_size = tx_data.length();
+void i2cControl::i2cSlave::write_string(const std::string &tx_data){
+    write_bytes(tx_data.data(), tx_data.length());
+}
 
+void i2cControl::i2cSlave::write_bytes(const void *tx_data, size_t tx_size){
     if(tx_size > bufferSize) {
         tx_size = bufferSize;
     }
 
-    for(int i = 0; i < tx_size; i++) {
-        tx_buffer[i] = tx_data.at(i);
-        ESP_LOGV(TAG, "buffer[%i]", i);
-    }
-
-    ESP_LOGD(TAG, "writing i2c");
-    ESP_LOGD(TAG, "Data Response: %x", (int)tx_buffer);
+    //the driver copies out of tx_data, so it is not staged in tx_buffer first
+    ESP_LOGD(TAG, "writing i2c: %i bytes", (int)tx_size);
     write_one_byte_raw(startByte);
-    i2c_slave_write_buffer(i2cPort, tx_buffer, tx_size, 0);
+    i2c_slave_write_buffer(i2cPort, (const uint8_t *)tx_data, tx_size, 0);
     write_one_byte_raw(endByte);
 }
 
@@ -191,6 +188,11 @@ bool i2cControl::i2cSlave::check_for_message(){
 }
 
 void i2cControl::i2cSlave::install_handler(opcode_t opcode, void (*i2c_handler_ptr)(parameter_t)){
+    if(opcode_counter + 1 >= opcodeListSize){
+        ESP_LOGE(TAG, "%#02x not installed, handler list full (%i)", (int)opcode, opcodeListSize);
+        return;
+    }
+
     ++opcode_counter;
     opcode_list[opcode_counter] = opcode;
     handler_list[opcode_counter] = i2c_handler_ptr;
@@ -199,6 +201,11 @@ void i2cControl::i2cSlave::install_handler(opcode_t opcode, void (*i2c_handler_p
 }
 
 void i2cControl::i2cSlave::install_handler(opcode_t opcode){
+    if(opcode_ignore_counter + 1 >= opcodeListSize){
+        ESP_LOGE(TAG, "%#02x not installed, ignore list full (%i)", (int)opcode, opcodeListSize);
+        return;
+    }
+
     ++opcode_ignore_counter;
     opcode_ignore_list[opcode_ignore_counter] = opcode;
 
@@ -30,7 +30,7 @@ namespace i2cControl{
 
     //i2c buffers
     constexpr int bufferSize = 256; //Size of I2C rx and tx buffers
-    constexpr int opcodeListSize = 32;
+    constexpr int opcodeListSize = 64; //handlers installed, and opcodes installed without one
 
     //special bytes
     constexpr byte startByte = 0xAA;
@@ -70,7 +70,8 @@ namespace i2cControl{
         void write_one_byte(byte tx_data);
         void write_one_byte_raw(byte tx_data);
         void write_four_bytes(byte4 tx_data);
-        void write_string(std::string tx_data);
+        void write_string(const std::string &tx_data);
+        void write_bytes(const void *tx_data, size_t tx_size); //framed like write_string, sent straight from tx_data
         bool check_for_message();
         inline opcode_t get_opcode(){
             return *operation;
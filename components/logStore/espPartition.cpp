@@ -0,0 +1,62 @@
+/**
+ * @file espPartition.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of espPartition class
+**/
+
+#include "espPartition.h"
+
+static const char* TAG = "partition";
+
+spiffsControl::espPartition::espPartition(const char *label) : partition_label{label}{
+    partition = NULL;
+    mapped = NULL;
+}
+
+spiffsControl::espPartition::~espPartition(){
+    unmap();
+}
+
+esp_err_t spiffsControl::espPartition::open(){
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if(partition == NULL){
+        ESP_LOGE(TAG, "Failed to find partition '%s'", partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+uint32_t spiffsControl::espPartition::size(){
+    return partition != NULL ? partition->size : 0;
+}
+
+esp_err_t spiffsControl::espPartition::read(uint32_t offset, void *data_out, size_t size){
+    return esp_partition_read(partition, offset, data_out, size);
+}
+
+esp_err_t spiffsControl::espPartition::write(uint32_t offset, const void *data, size_t size){
+    return esp_partition_write(partition, offset, data, size);
+}
+
+esp_err_t spiffsControl::espPartition::erase(uint32_t offset, size_t size){
+    return esp_partition_erase_range(partition, offset, size);
+}
+
+const uint8_t *spiffsControl::espPartition::map(uint32_t offset, uint32_t size){
+    unmap();
+
+    esp_err_t ret = esp_partition_mmap(partition, offset, size, ESP_PARTITION_MMAP_DATA, &mapped, &mapped_handle);
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Failed to map 0x%lx (%s)", (unsigned long)offset, esp_err_to_name(ret));
+        mapped = NULL;
+    }
+    return (const uint8_t *)mapped;
+}
+
+void spiffsControl::espPartition::unmap(){
+    if(mapped != NULL){
+        esp_partition_munmap(mapped_handle);
+        mapped = NULL;
+    }
+}
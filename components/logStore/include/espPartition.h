@@ -0,0 +1,51 @@
+/**
+ * @file espPartition.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief storePartition on an ESP32 data partition
+**/
+
+#ifndef _espPartition_H_included
+#define _espPartition_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#include "storePartition.h"
+
+namespace spiffsControl{
+    /**
+     * @brief Data partition from partitions.csv, through esp_partition
+     * @note also runs on the linux target, where the partition table is emulated
+     * by a file-backed flash image
+     */
+    class espPartition : public storePartition{
+    public:
+        /**
+         * @brief Construct a new esp Partition object
+         * @note call open() before use
+         *
+         * @param label partition label
+         */
+        espPartition(const char *label);
+        ~espPartition();
+
+        esp_err_t open() override;
+        uint32_t size() override;
+        esp_err_t read(uint32_t offset, void *data_out, size_t size) override;
+        esp_err_t write(uint32_t offset, const void *data, size_t size) override;
+        esp_err_t erase(uint32_t offset, size_t size) override;
+        const uint8_t *map(uint32_t offset, uint32_t size) override;
+        void unmap() override;
+
+    private:
+        const char *partition_label;
+        const esp_partition_t *partition;
+
+        const void *mapped; //NULL if nothing is mapped
+        esp_partition_mmap_handle_t mapped_handle;
+    };
+}
+
+#endif // _espPartition_H_included
@@ -0,0 +1,232 @@
+/**
+ * @file logStore.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Append-only record store on a raw data partition
+ *
+ * Only reaches flash through a storePartition, so it builds and runs on a
+ * host against a partition kept in RAM.
+**/
+
+#ifndef _logStore_H_included
+#define _logStore_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+#include "storePartition.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    //store config
+    constexpr const char *storePartitionLabel = "spiffs"; //data partition in partitions.csv
+    constexpr int storeSectorSize = 4096; //flash erase unit
+    constexpr int storeSlotSize = 64; //bytes per record slot, header included
+    constexpr int storeSlotsPerSector = storeSectorSize / storeSlotSize;
+    constexpr int storeEraseAhead = 1; //erased sectors always kept in front of the write head
+    constexpr uint32_t storeMapSize = 0x10000; //bytes of the partition mapped at once by map(); one mmu page
+
+    //special values
+    constexpr uint32_t storeErased = 0xFFFFFFFF; //sequence of an erased slot
+    constexpr uint8_t storeTagClear = 0xFE; //marker written by clear(); records before it are discarded
+
+    /**
+     * @brief Header at the start of every record slot
+     *
+     */
+    struct __attribute__((packed)) StoreHeader{
+        uint32_t sequence; // record number; slot = sequence % slot count
+        uint16_t length; // payload length in bytes
+        uint8_t tag; // payload type, chosen by the writer
+        uint8_t reserved; // 0xFF
+        uint32_t crc; // esp_rom_crc32_le of the fields above and the payload
+    };
+
+    constexpr int storePayloadSize = storeSlotSize - sizeof(StoreHeader);
+
+    /**
+     * @brief Counts a completed append
+     *
+     * @param bytes flash bytes written
+     * @param latency micro-seconds the append took
+     */
+    typedef void(*store_append_t)(uint32_t bytes, uint32_t latency);
+
+    /**
+     * @brief Counts a sector erase
+     *
+     * @param sector erased sector of the partition
+     */
+    typedef void(*store_erase_t)(uint32_t sector);
+
+    /**
+     * @brief Log-structured record store on a raw flash partition
+     * @note - Records are written to fixed-size slots in sequence order and never rewritten
+     * @note - The sector in front of the write head is erased before it is reached,
+     * so an append is a single slot write no matter how full the store is
+     * @note - preErase() erases further ahead from a background task, so appends
+     * that cross into a new sector do not erase in the foreground
+     * @note - When the partition is full the oldest sector is erased and reused
+     * @note - Any record can be read back by sequence number in O(1)
+     */
+    class logStore{
+    public:
+        /**
+         * @brief Construct a new log Store object
+         * @note call mount() before use
+         *
+         * @param flash region the store is kept on, e.g. an espPartition
+         */
+        logStore(storePartition *flash);
+        ~logStore();
+
+        /**
+         * @brief Opens the partition and finds the write head
+         * @note scans the first slot of each sector and the slots of the newest sector
+         *
+         * @return esp_err_t
+         */
+        esp_err_t mount();
+
+        /**
+         * @brief Appends a record
+         *
+         * @param data payload
+         * @param size length of payload; at most storePayloadSize
+         * @param tag payload type
+         * @param sequence_out sequence number given to the record, can be NULL
+         * @return esp_err_t
+         */
+        esp_err_t append(const void *data, size_t size, uint8_t tag, uint32_t *sequence_out = NULL);
+
+        /**
+         * @brief Reads a record by sequence number
+         *
+         * @param sequence record number, from getOldest() to getNext() - 1
+         * @param data_out buffer of at least storePayloadSize bytes
+         * @param size_out length of payload, can be NULL
+         * @param tag_out payload type, can be NULL
+         * @return ESP_OK if read;
+         * @return ESP_ERR_NOT_FOUND if the record is not stored;
+         * @return ESP_ERR_INVALID_CRC if the slot does not hold a complete record
+         */
+        esp_err_t read(uint32_t sequence, void *data_out, size_t *size_out = NULL, uint8_t *tag_out = NULL);
+
+        /**
+         * @brief Maps stored slots into the address space, so they can be read
+         * without being copied
+         * @note - Slots are returned as stored, header included; the reader checks
+         * each one's sequence number and crc
+         * @note - The pointer stays valid until the next map() or unmap(). Slots
+         * past getNext() are never returned, but the oldest sector may be erased
+         * while it is read, which the crc check catches
+         * @note - Flash writes invalidate the cache of mapped regions, so mapped
+         * slots always read what is stored
+         *
+         * @param sequence first record, from getOldest() to getNext() - 1
+         * @param max_slots most slots wanted
+         * @param slots_out first slot in mapped flash
+         * @return number of consecutive slots mapped;
+         * @return 0 if the record is not stored or the partition could not be mapped
+         */
+        size_t map(uint32_t sequence, size_t max_slots, const uint8_t **slots_out);
+
+        /**
+         * @brief Releases the region mapped by map()
+         *
+         */
+        void unmap();
+
+        /**
+         * @brief Discards every stored record
+         * @note writes a marker at the start of the next sector instead of erasing
+         * the partition, so it takes one sector erase
+         *
+         * @return esp_err_t
+         */
+        esp_err_t clear();
+
+        /**
+         * @brief Erases the next sector in front of the write head, if fewer
+         * than target sectors are erased
+         * @note every erased sector holds storeSlotsPerSector fewer old records
+         *
+         * @param target erased sectors to keep in front of the write head
+         * @return true if a sector was erased
+         */
+        bool preErase(int target);
+
+        /**
+         * @brief Set the functions that every append and erase is counted by,
+         * e.g. wear counters and a latency histogram
+         * @note call before mount(), so erases done by the mount are counted
+         *
+         * @param on_append called after each successful append, can be NULL
+         * @param on_erase called after each sector erase, can be NULL
+         */
+        inline void setCounters(store_append_t on_append, store_erase_t on_erase){
+            append_counter = on_append;
+            erase_counter = on_erase;
+        }
+
+        inline bool isMounted(){
+            return mounted;
+        }
+        inline uint32_t getOldest(){
+            return oldest;
+        }
+        inline uint32_t getNext(){
+            return next;
+        }
+        inline uint32_t getCapacity(){
+            return slot_count;
+        }
+        inline int getErasedAhead(){
+            return erased_ahead;
+        }
+        inline uint32_t getForegroundErases(){
+            return foreground_erases;
+        }
+
+    private:
+        esp_err_t writeSlot(uint32_t sequence, const void *data, size_t size, uint8_t tag);
+        esp_err_t readSlot(uint32_t slot, uint8_t *slot_out);
+        esp_err_t eraseSector(uint32_t sector);
+        esp_err_t enterSector(); //lock must be held; next is at the start of a sector
+        esp_err_t eraseNext(); //erases the sector after the erased ones; lock must be held
+        uint32_t headSector(); //sector of the newest record
+        void advance(); //moves next on by one record
+        void updateOldest();
+        bool mapWindow(uint32_t offset); //maps the storeMapSize window holding offset; lock must be held
+
+        storePartition *partition;
+        bool mounted;
+        uint32_t sector_count;
+        uint32_t slot_count;
+
+        uint32_t next; //sequence of the next record
+        uint32_t oldest; //sequence of the oldest record still stored
+        uint32_t cleared; //sequence after the newest clear marker
+        int erased_ahead; //erased sectors in front of the head sector
+
+        //region mapped by map()
+        const uint8_t *mapped;
+        uint32_t mapped_offset; //partition offset of mapped
+        uint32_t mapped_size;
+
+        //metrics
+        uint32_t foreground_erases; //erases done by append()
+        store_append_t append_counter; //NULL if not counted
+        store_erase_t erase_counter; //NULL if not counted
+
+        SemaphoreHandle_t lock;
+    };
+}
+
+#endif // _logStore_H_included
@@ -0,0 +1,71 @@
+/**
+ * @file storePartition.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Flash region that a logStore is kept on
+**/
+
+#ifndef _storePartition_H_included
+#define _storePartition_H_included
+
+#include "esp_err.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace spiffsControl{
+    /**
+     * @brief NOR flash as the log store sees it
+     * @note - Erasing sets bytes to 0xFF; a write can only clear bits of erased bytes
+     * @note - espPartition is the ESP32 data partition; the host tests keep one in RAM
+     */
+    class storePartition{
+    public:
+        virtual ~storePartition(){}
+
+        /**
+         * @brief Finds the flash region
+         *
+         * @return ESP_OK if found;
+         * @return ESP_ERR_NOT_FOUND if there is no such region
+         */
+        virtual esp_err_t open() = 0;
+
+        /**
+         * @brief Get the size of the region
+         *
+         * @return uint32_t bytes, 0 before open()
+         */
+        virtual uint32_t size() = 0;
+
+        virtual esp_err_t read(uint32_t offset, void *data_out, size_t size) = 0;
+        virtual esp_err_t write(uint32_t offset, const void *data, size_t size) = 0;
+
+        /**
+         * @brief Erases whole sectors
+         *
+         * @param offset start of the first sector
+         * @param size multiple of the sector size
+         * @return esp_err_t
+         */
+        virtual esp_err_t erase(uint32_t offset, size_t size) = 0;
+
+        /**
+         * @brief Maps part of the region into the address space
+         * @note the previous mapping is released
+         *
+         * @param offset start of the mapping
+         * @param size bytes mapped
+         * @return const uint8_t* first mapped byte, NULL if it could not be mapped
+         */
+        virtual const uint8_t *map(uint32_t offset, uint32_t size) = 0;
+
+        /**
+         * @brief Releases the mapping made by map()
+         *
+         */
+        virtual void unmap() = 0;
+    };
+}
+
+#endif // _storePartition_H_included
@@ -0,0 +1,376 @@
+/**
+ * @file logStore.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logStore class
+**/
+
+#include "logStore.h"
+#include <string.h>
+
+static const char* TAG = "store";
+
+static uint32_t slotCrc(const uint8_t *slot){
+    const spiffsControl::StoreHeader *header = (const spiffsControl::StoreHeader *)slot;
+
+    uint32_t crc = esp_rom_crc32_le(0, slot, offsetof(spiffsControl::StoreHeader, crc));
+    return esp_rom_crc32_le(crc, slot + sizeof(spiffsControl::StoreHeader), header->length);
+}
+
+static bool slotValid(const uint8_t *slot){
+    const spiffsControl::StoreHeader *header = (const spiffsControl::StoreHeader *)slot;
+
+    if(header->sequence == spiffsControl::storeErased || header->length > spiffsControl::storePayloadSize){
+        return false;
+    }
+    return header->crc == slotCrc(slot);
+}
+
+static bool slotErased(const uint8_t *slot){
+    for(int i = 0; i < spiffsControl::storeSlotSize; i++){
+        if(slot[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+spiffsControl::logStore::logStore(storePartition *flash) : partition{flash}{
+    mounted = false;
+    sector_count = 0;
+    slot_count = 0;
+
+    next = 0;
+    oldest = 0;
+    cleared = 0;
+    erased_ahead = 0;
+
+    mapped = NULL;
+    mapped_offset = 0;
+    mapped_size = 0;
+
+    foreground_erases = 0;
+    append_counter = NULL;
+    erase_counter = NULL;
+
+    lock = xSemaphoreCreateMutex();
+}
+
+spiffsControl::logStore::~logStore(){
+    unmap();
+    vSemaphoreDelete(lock);
+}
+
+esp_err_t spiffsControl::logStore::readSlot(uint32_t slot, uint8_t *slot_out){
+    return partition->read(slot * storeSlotSize, slot_out, storeSlotSize);
+}
+
+esp_err_t spiffsControl::logStore::eraseSector(uint32_t sector){
+    esp_err_t ret = partition->erase(sector * storeSectorSize, storeSectorSize);
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Failed to erase sector %lu (%s)", (unsigned long)sector, esp_err_to_name(ret));
+    }
+    else if(erase_counter != NULL){
+        erase_counter(sector);
+    }
+    return ret;
+}
+
+void spiffsControl::logStore::updateOldest(){
+    //every sector except the erased sectors ahead of the head sector holds records
+    int64_t head_start = next == 0 ? 0 : (next - 1) - (next - 1) % storeSlotsPerSector;
+    int64_t first = head_start - (int64_t)(sector_count - 1 - erased_ahead) * storeSlotsPerSector;
+
+    if(first < cleared) first = cleared;
+    if(first < 0) first = 0;
+    oldest = first;
+}
+
+uint32_t spiffsControl::logStore::headSector(){
+    return ((next + slot_count - 1) % slot_count) / storeSlotsPerSector;
+}
+
+void spiffsControl::logStore::advance(){
+    next++;
+
+    //the first record of a sector uses up one erased sector
+    if(next % storeSlotsPerSector == 1 && erased_ahead > 0){
+        erased_ahead--;
+    }
+}
+
+esp_err_t spiffsControl::logStore::eraseNext(){
+    esp_err_t ret = eraseSector((headSector() + erased_ahead + 1) % sector_count);
+    if(ret == ESP_OK){
+        erased_ahead++;
+        updateOldest();
+    }
+    return ret;
+}
+
+esp_err_t spiffsControl::logStore::enterSector(){
+    //the sector being entered and storeEraseAhead more
+    while(erased_ahead < storeEraseAhead + 1){
+        foreground_erases++;
+
+        esp_err_t ret = eraseNext();
+        if(ret != ESP_OK) return ret;
+    }
+
+    updateOldest();
+    return ESP_OK;
+}
+
+bool spiffsControl::logStore::preErase(int target){
+    if(!isMounted()){
+        return false;
+    }
+
+    //at least one sector of records is kept
+    if(target > (int)sector_count - 2) target = sector_count - 2;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool erased = erased_ahead < target && eraseNext() == ESP_OK;
+    xSemaphoreGive(lock);
+
+    return erased;
+}
+
+esp_err_t spiffsControl::logStore::mount(){
+    mounted = false;
+    esp_err_t ret = partition->open();
+    if(ret != ESP_OK){
+        return ret;
+    }
+
+    sector_count = partition->size() / storeSectorSize;
+    slot_count = sector_count * storeSlotsPerSector;
+    if(sector_count < storeEraseAhead + 2){
+        ESP_LOGE(TAG, "Partition is too small");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t slot[storeSlotSize];
+    const StoreHeader *header = (const StoreHeader *)slot;
+    bool found = false;
+    uint32_t head_sector = 0;
+    uint32_t head_first = 0; //sequence of the head sector's first record
+
+    //newest sector and newest clear marker, from the first slot of each sector
+    cleared = 0;
+    for(uint32_t sector = 0; sector < sector_count; sector++){
+        if(readSlot(sector * storeSlotsPerSector, slot) != ESP_OK || !slotValid(slot)){
+            continue;
+        }
+        if(header->sequence % slot_count != sector * storeSlotsPerSector){
+            continue; //not written by this layout
+        }
+
+        if(!found || header->sequence > head_first){
+            found = true;
+            head_first = header->sequence;
+            head_sector = sector;
+        }
+        if(header->tag == storeTagClear && header->sequence + 1 > cleared){
+            cleared = header->sequence + 1;
+        }
+    }
+
+    if(!found){
+        ESP_LOGW(TAG, "No records found, starting new store");
+        next = 0;
+    }
+    else{
+        //last used slot of the head sector; torn slots still use up their sequence number
+        int last_used = 0;
+        for(int i = 1; i < storeSlotsPerSector; i++){
+            readSlot(head_sector * storeSlotsPerSector + i, slot);
+            if(!slotErased(slot)) last_used = i;
+        }
+        next = head_first + last_used + 1;
+    }
+
+    //sectors further ahead may have been pre-erased, but only these are known to be
+    erased_ahead = next % storeSlotsPerSector == 0 ? storeEraseAhead + 1 : storeEraseAhead;
+
+    //a new head sector may hold stale data if power was lost before it was erased
+    if(next % storeSlotsPerSector == 0){
+        uint32_t sector = (next % slot_count) / storeSlotsPerSector;
+
+        for(int i = 0; i <= storeEraseAhead; i++){
+            uint32_t check = (sector + i) % sector_count;
+            bool erased = true;
+
+            for(int j = 0; j < storeSlotsPerSector && erased; j++){
+                readSlot(check * storeSlotsPerSector + j, slot);
+                erased = slotErased(slot);
+            }
+
+            if(!erased && eraseSector(check) != ESP_OK){
+                return ESP_FAIL;
+            }
+        }
+    }
+
+    updateOldest();
+    mounted = true;
+    ESP_LOGI(TAG, "Mounted: %lu slots, records %lu to %lu", (unsigned long)slot_count, (unsigned long)oldest, (unsigned long)next);
+
+    return ESP_OK;
+}
+
+esp_err_t spiffsControl::logStore::writeSlot(uint32_t sequence, const void *data, size_t size, uint8_t tag){
+    uint8_t slot[storeSlotSize];
+    StoreHeader *header = (StoreHeader *)slot;
+
+    memset(slot, 0xFF, storeSlotSize);
+    header->sequence = sequence;
+    header->length = size;
+    header->tag = tag;
+    if(size > 0) memcpy(slot + sizeof(StoreHeader), data, size);
+    header->crc = slotCrc(slot);
+
+    return partition->write((sequence % slot_count) * storeSlotSize, slot, storeSlotSize);
+}
+
+esp_err_t spiffsControl::logStore::append(const void *data, size_t size, uint8_t tag, uint32_t *sequence_out){
+    if(!isMounted()){
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(size > storePayloadSize){
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+
+    esp_err_t ret = ESP_OK;
+    if(next % storeSlotsPerSector == 0){
+        ret = enterSector();
+    }
+
+    if(ret == ESP_OK){
+        ret = writeSlot(next, data, size, tag);
+    }
+
+    if(ret == ESP_OK){
+        if(sequence_out != NULL) *sequence_out = next;
+        ESP_LOGV(TAG, "Record %lu written", (unsigned long)next);
+    }
+    else{
+        ESP_LOGE(TAG, "Failed to write record %lu (%s)", (unsigned long)next, esp_err_to_name(ret));
+    }
+
+    //a failed slot is skipped rather than rewritten
+    advance();
+    uint32_t elapsed = esp_timer_get_time() - start;
+    if(append_counter != NULL && ret == ESP_OK) append_counter(storeSlotSize, elapsed);
+
+    xSemaphoreGive(lock);
+    return ret;
+}
+
+esp_err_t spiffsControl::logStore::read(uint32_t sequence, void *data_out, size_t *size_out, uint8_t *tag_out){
+    if(!isMounted()){
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t slot[storeSlotSize];
+    const StoreHeader *header = (const StoreHeader *)slot;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if(sequence >= oldest && sequence < next){
+        ret = readSlot(sequence % slot_count, slot);
+    }
+    xSemaphoreGive(lock);
+
+    if(ret != ESP_OK){
+        return ret;
+    }
+    if(!slotValid(slot) || header->sequence != sequence){
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    memcpy(data_out, slot + sizeof(StoreHeader), header->length);
+    if(size_out != NULL) *size_out = header->length;
+    if(tag_out != NULL) *tag_out = header->tag;
+
+    return ESP_OK;
+}
+
+bool spiffsControl::logStore::mapWindow(uint32_t offset){
+    uint32_t start = offset - offset % storeMapSize;
+
+    if(mapped != NULL && offset >= mapped_offset && offset < mapped_offset + mapped_size){
+        return true;
+    }
+    unmap();
+
+    uint32_t size = partition->size() - start < storeMapSize ? partition->size() - start : storeMapSize;
+    mapped = partition->map(start, size);
+    if(mapped == NULL){
+        return false;
+    }
+
+    mapped_offset = start;
+    mapped_size = size;
+    return true;
+}
+
+size_t spiffsControl::logStore::map(uint32_t sequence, size_t max_slots, const uint8_t **slots_out){
+    if(!isMounted()){
+        return 0;
+    }
+
+    size_t count = 0;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if(sequence >= oldest && sequence < next){
+        uint32_t offset = (sequence % slot_count) * storeSlotSize;
+
+        if(mapWindow(offset)){
+            //slots up to the end of the window, which is also where the partition wraps
+            count = (mapped_offset + mapped_size - offset) / storeSlotSize;
+            if(count > next - sequence) count = next - sequence;
+            if(count > max_slots) count = max_slots;
+
+            *slots_out = mapped + (offset - mapped_offset);
+        }
+    }
+    xSemaphoreGive(lock);
+
+    return count;
+}
+
+void spiffsControl::logStore::unmap(){
+    if(mapped != NULL){
+        partition->unmap();
+        mapped = NULL;
+    }
+}
+
+esp_err_t spiffsControl::logStore::clear(){
+    if(!isMounted()){
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    //the marker goes at the start of a sector so mount() finds it
+    if(next % storeSlotsPerSector != 0){
+        next += storeSlotsPerSector - next % storeSlotsPerSector;
+    }
+
+    esp_err_t ret = enterSector();
+    if(ret == ESP_OK){
+        ret = writeSlot(next, NULL, 0, storeTagClear);
+    }
+    advance();
+
+    cleared = next;
+    updateOldest();
+
+    xSemaphoreGive(lock);
+
+    ESP_LOGI(TAG, "Store cleared at record %lu", (unsigned long)next);
+    return ret;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file blockReader.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of blockReader class
+**/
+
+#include "blockReader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char* TAG = "reader";
+
+spiffsControl::blockReader::blockReader(){
+    fd = -1;
+    held = 0;
+    begin = 0;
+    end = 0;
+    eof = false;
+
+    blocks_read = 0;
+}
+
+spiffsControl::blockReader::~blockReader(){
+    close();
+}
+
+bool spiffsControl::blockReader::open(const char *path, long offset){
+    close();
+
+    fd = ::open(path, O_RDONLY);
+    if(fd < 0){
+        ESP_LOGE(TAG, "Failed to open %s (%s)", path, strerror(errno));
+        return false;
+    }
+    if(offset > 0 && lseek(fd, offset, SEEK_SET) < 0){
+        ESP_LOGE(TAG, "Failed to seek to %ld (%s)", offset, strerror(errno));
+        close();
+        return false;
+    }
+
+    held = 0;
+    begin = 0;
+    end = 0;
+    eof = false;
+    fill();
+    return true;
+}
+
+void spiffsControl::blockReader::close(){
+    if(fd >= 0){
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool spiffsControl::blockReader::fill(){
+    if(fd < 0 || eof){
+        return false;
+    }
+
+    //reads stop at the end of a block, so the buffer only wraps between reads
+    size_t at = end % readAheadSize;
+    size_t size = readAheadBlockSize - at % readAheadBlockSize;
+    if(readAheadSize - (end - held) < size){
+        return false;
+    }
+
+    ssize_t ret = ::read(fd, blocks + at, size);
+    if(ret <= 0){
+        if(ret < 0) ESP_LOGE(TAG, "Failed to read (%s)", strerror(errno));
+        eof = true;
+        return false;
+    }
+
+    end += ret;
+    blocks_read++;
+    return true;
+}
+
+void spiffsControl::blockReader::prefetch(){
+    fill();
+}
+
+void spiffsControl::blockReader::handOut(size_t size, size_t consumed, lineSpan *line_out){
+    size_t at = begin % readAheadSize;
+
+    if(at + size <= readAheadSize){
+        line_out->data = blocks + at;
+    }
+    else{
+        memcpy(line, blocks + at, readAheadSize - at);
+        memcpy(line + readAheadSize - at, blocks, size - (readAheadSize - at));
+        line_out->data = line;
+    }
+    line_out->size = size;
+
+    held = begin;
+    begin += consumed;
+}
+
+bool spiffsControl::blockReader::readLine(lineSpan *line_out){
+    if(fd < 0){
+        return false;
+    }
+
+    //the last span is no longer used
+    held = begin;
+
+    while(1){
+        size_t limit = end - begin < readerLineSize - 1 ? end - begin : readerLineSize - 1;
+        size_t at = begin % readAheadSize;
+        size_t first = readAheadSize - at < limit ? readAheadSize - at : limit;
+
+        const char *newline = (const char *)memchr(blocks + at, '\n', first);
+        if(newline != NULL){
+            size_t size = newline - (blocks + at);
+            handOut(size, size + 1, line_out);
+            return true;
+        }
+        newline = (const char *)memchr(blocks, '\n', limit - first);
+        if(newline != NULL){
+            size_t size = first + (newline - blocks);
+            handOut(size, size + 1, line_out);
+            return true;
+        }
+
+        //no newline in a whole line; split it
+        if(limit == readerLineSize - 1){
+            handOut(limit, limit, line_out);
+            return true;
+        }
+
+        if(!fill()){
+            if(end == begin){
+                return false;
+            }
+
+            //last line of the file
+            handOut(end - begin, end - begin, line_out);
+            return true;
+        }
+    }
+}
+
+bool spiffsControl::blockReader::readRecord(void *record_out, size_t size){
+    if(fd < 0 || size > readAheadSize){
+        return false;
+    }
+
+    held = begin;
+    while(end - begin < size){
+        if(!fill()){
+            return false;
+        }
+    }
+
+    size_t at = begin % readAheadSize;
+    size_t first = readAheadSize - at < size ? readAheadSize - at : size;
+
+    memcpy(record_out, blocks + at, first);
+    memcpy((char *)record_out + first, blocks, size - first);
+    begin += size;
+    return true;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file flashMaintenance.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of flashMaintenance class
+**/
+
+#include "flashMaintenance.h"
+
+static const char* TAG = "maintenance";
+
+spiffsControl::flashMaintenance::flashMaintenance(logStore *log_store) : store{log_store}{
+    wear = NULL;
+    idle = NULL;
+    handle = NULL;
+
+    steps = 0;
+    last_step_latency = 0;
+    free_bytes = 0;
+
+    setTarget(defaultFreeTarget);
+}
+
+spiffsControl::flashMaintenance::~flashMaintenance(){
+    stop();
+}
+
+void spiffsControl::flashMaintenance::setTarget(size_t free_bytes_target){
+    target = free_bytes_target;
+    gc_goal = gcStepSize < target ? gcStepSize : target;
+}
+
+void spiffsControl::flashMaintenance::start(idle_check_t idle_check){
+    if(handle != NULL){
+        return;
+    }
+
+    idle = idle_check;
+    xTaskCreatePinnedToCore(task, "maintenance", maintenanceStackSize, this, maintenancePriority, &handle, 1);
+    ESP_LOGI(TAG, "Started: keeping %u bytes ready", (unsigned)target);
+}
+
+void spiffsControl::flashMaintenance::stop(){
+    if(handle != NULL){
+        vTaskDelete(handle);
+        handle = NULL;
+    }
+}
+
+bool spiffsControl::flashMaintenance::step(){
+    int64_t start = esp_timer_get_time();
+    bool worked;
+
+    if(store != NULL){
+        //sectors ahead of the write head
+        int sectors = (target + storeSectorSize - 1) / storeSectorSize;
+
+        worked = store->preErase(sectors);
+        free_bytes = (size_t)store->getErasedAhead() * storeSectorSize;
+    }
+    else{
+        size_t total = 0, used = 0;
+        if(esp_spiffs_info(NULL, &total, &used) != ESP_OK){
+            return false;
+        }
+        free_bytes = total > used ? total - used : 0;
+
+        //esp_spiffs_gc() makes gc_goal bytes writable without collecting during a write.
+        //Raising the goal a sector at a time keeps every call short.
+        esp_err_t ret = esp_spiffs_gc(NULL, gc_goal);
+        worked = ret == ESP_OK;
+
+        if(ret == ESP_OK && gc_goal < target){
+            gc_goal += gcStepSize;
+            if(gc_goal > target) gc_goal = target;
+        }
+        else if(ret != ESP_OK){
+            //partition too full for the goal; try again from one sector
+            ESP_LOGD(TAG, "GC for %u bytes not finished (%s)", (unsigned)gc_goal, esp_err_to_name(ret));
+            gc_goal = gcStepSize < target ? gcStepSize : target;
+        }
+    }
+
+    steps++;
+    last_step_latency = esp_timer_get_time() - start;
+    ESP_LOGD(TAG, "Step took %lu us", (unsigned long)last_step_latency);
+
+    return worked;
+}
+
+void spiffsControl::flashMaintenance::task(void *pvParameters){
+    flashMaintenance *self = (flashMaintenance *)pvParameters;
+    const TickType_t xDelay = maintenanceInterval / portTICK_PERIOD_MS;
+
+    while(1){
+        if(self->idle == NULL || self->idle()){
+            self->step();
+
+            //at most once per wearSaveInterval, so NVS is not worn instead
+            if(self->wear != NULL) self->wear->save();
+        }
+        vTaskDelay(xDelay);
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file blockReader.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Allocation-free block read-ahead for log downloads
+**/
+
+#ifndef _blockReader_H_included
+#define _blockReader_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace spiffsControl{
+    //reader config
+    constexpr size_t readAheadBlockSize = 4096; //bytes read from flash at once; one SPIFFS block
+    constexpr size_t readAheadBlocks = 2; //one block is read while the other is handed out
+    constexpr size_t readAheadSize = readAheadBlocks * readAheadBlockSize;
+    constexpr size_t readerLineSize = 256; //longest line returned whole; longer lines are split, like fgets
+
+    /**
+     * @brief Line handed out by a reader without being copied
+     * @note valid until the next read from the same reader
+     *
+     */
+    struct lineSpan{
+        const char *data; // not null terminated
+        size_t size; // without the newline
+    };
+
+    /**
+     * @brief Sequential file reader over a fixed double buffer
+     * @note - Reads whole blocks of readAheadBlockSize bytes, and hands lines
+     * out as spans into the block they were read into
+     * @note - Only a line that wraps from the last block to the first is
+     * copied, into a line buffer of its own
+     * @note - A span stays valid until the next readLine() or readRecord();
+     * prefetch() never reads over it
+     * @note - Uses a file descriptor instead of a FILE, so opening a file does
+     * not allocate a stdio buffer; nothing is allocated after construction
+     */
+    class blockReader{
+    public:
+        blockReader();
+        ~blockReader();
+
+        /**
+         * @brief Opens a file and reads its first block
+         * @note closes the file being read
+         *
+         * @param path file location
+         * @param offset byte offset to start reading at
+         * @return true if the file was opened
+         */
+        bool open(const char *path, long offset = 0);
+
+        /**
+         * @brief Closes the file being read
+         *
+         */
+        void close();
+
+        /**
+         * @brief Reads the next line
+         * @note a last line with no newline is returned as it is
+         *
+         * @param line_out span of the line, without the newline
+         * @return true if a line was read;
+         * @return false at the end of the file
+         */
+        bool readLine(lineSpan *line_out);
+
+        /**
+         * @brief Reads the next fixed-size record
+         * @note a partial record at the end of the file is not read
+         *
+         * @param record_out buffer to write record data to
+         * @param size length of record in bytes
+         * @return true if a record was read;
+         * @return false at the end of the file
+         */
+        bool readRecord(void *record_out, size_t size);
+
+        /**
+         * @brief Reads the next block if one is free
+         * @note call once a line has been handed on, e.g. while the bus sends
+         * it, so the next lines are already in memory when they are asked for
+         *
+         */
+        void prefetch();
+
+        inline bool isOpen(){
+            return fd >= 0;
+        }
+        inline uint32_t getBlocksRead(){
+            return blocks_read;
+        }
+
+    private:
+        bool fill(); //reads up to the end of the free block; false if there is none or at the end of the file
+        void handOut(size_t size, size_t consumed, lineSpan *line_out);
+
+        int fd;
+        char blocks[readAheadSize];
+        char line[readerLineSize]; //a line that wrapped around blocks
+        size_t held; //start of the span last handed out, which is not read over
+        size_t begin; //bytes handed out since open()
+        size_t end; //bytes read since open()
+        bool eof; //the last read reached the end of the file
+
+        //metrics
+        uint32_t blocks_read; //blocks read from flash since boot
+    };
+}
+
+#endif // _blockReader_H_included
@@ -0,0 +1,124 @@
+/**
+ * @file flashMaintenance.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Background garbage collection and sector pre-erase
+**/
+
+#ifndef _flashMaintenance_H_included
+#define _flashMaintenance_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_spiffs.h"
+
+#include "logStore.h"
+#include "wearStats.h"
+#include "esp_timer.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    //maintenance config
+    constexpr size_t defaultFreeTarget = 32768; //bytes kept erased and ready to write
+    constexpr size_t gcStepSize = 4096; //bytes the gc target grows by per step, one flash sector
+    constexpr uint32_t maintenanceInterval = 500; //milli-seconds between steps
+    constexpr uint32_t maintenanceStackSize = 3072;
+    constexpr UBaseType_t maintenancePriority = 1; //below both loggers and the experiment
+
+    /**
+     * @brief Reports whether flash can be maintained without delaying a write
+     *
+     * @return true if no logger is writing
+     */
+    typedef bool(*idle_check_t)();
+
+    /**
+     * @brief Low-priority task that keeps erased flash ready for the log
+     * @note - With SPIFFS, runs esp_spiffs_gc() so appends do not garbage collect
+     * @note - With the log store, erases sectors ahead of the write head
+     * @note - Only works while the idle check passes, one step of at most about one
+     * sector erase at a time, so a write that arrives during a step waits no longer
+     * than that
+     * @note - Also saves the wear counters given to setWear() when they are due
+     */
+    class flashMaintenance{
+    public:
+        /**
+         * @brief Construct a new flash Maintenance object
+         *
+         * @param log_store store to pre-erase, NULL to maintain SPIFFS
+         */
+        flashMaintenance(logStore *log_store = NULL);
+        ~flashMaintenance();
+
+        /**
+         * @brief Starts the maintenance task
+         *
+         * @param idle_check called before every step
+         */
+        void start(idle_check_t idle_check);
+
+        /**
+         * @brief Stops the maintenance task
+         *
+         */
+        void stop();
+
+        /**
+         * @brief Set how much flash is kept ready to write
+         *
+         * @param free_bytes target in bytes
+         */
+        void setTarget(size_t free_bytes);
+
+        /**
+         * @brief Set the wear counters saved between steps
+         *
+         * @param wear_stats flash wear counters, can be NULL
+         */
+        inline void setWear(wearStats *wear_stats){
+            wear = wear_stats;
+        }
+
+        /**
+         * @brief Does one bounded step of maintenance
+         *
+         * @return true if the target is being met: a sector was erased, or SPIFFS
+         * has gc goal bytes ready to write
+         */
+        bool step();
+
+        /* metrics */
+        inline uint32_t getSteps(){
+            return steps;
+        }
+        inline uint32_t getLastStepLatency(){
+            return last_step_latency;
+        }
+        inline size_t getFreeBytes(){
+            return free_bytes;
+        }
+
+    private:
+        static void task(void *pvParameters);
+
+        logStore *store;
+        wearStats *wear;
+        idle_check_t idle;
+        TaskHandle_t handle;
+
+        size_t target;
+        size_t gc_goal; //current esp_spiffs_gc() goal, grows to target a step at a time
+
+        //metrics
+        uint32_t steps; //steps run
+        uint32_t last_step_latency; //micro-seconds
+        size_t free_bytes; //unused bytes at the last step
+    };
+}
+
+#endif // _flashMaintenance_H_included
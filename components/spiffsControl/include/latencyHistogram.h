@@ -0,0 +1,59 @@
+/**
+ * @file latencyHistogram.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Fixed-size histogram of operation latencies
+**/
+
+#ifndef _latencyHistogram_H_included
+#define _latencyHistogram_H_included
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    //histogram config
+    constexpr int latencyBuckets = 16; //bucket 0 is under latencyFirstBucket, each next bucket is twice as wide
+    constexpr uint32_t latencyFirstBucket = 64; //micro-seconds
+
+    /**
+     * @brief Counts latencies in power-of-two buckets
+     * @note - Constant memory and time, safe to update on every write
+     * @note - Percentiles are the upper edge of a bucket, so within a factor of 2
+     */
+    class latencyHistogram{
+    public:
+        latencyHistogram();
+
+        /**
+         * @brief Counts one latency
+         *
+         * @param latency micro-seconds
+         */
+        void add(uint32_t latency);
+
+        /**
+         * @brief Get a percentile of the latencies counted
+         *
+         * @param percent from 1 to 100
+         * @return uint32_t - upper edge of the bucket holding the percentile
+         * (micro-seconds), 0 if nothing was counted
+         */
+        uint32_t percentile(int percent);
+
+        /**
+         * @brief Sets every bucket to 0
+         *
+         */
+        void clear();
+
+        inline uint32_t getCount(){
+            return count;
+        }
+
+    private:
+        uint32_t buckets[latencyBuckets];
+        uint32_t count;
+    };
+}
+
+#endif // _latencyHistogram_H_included
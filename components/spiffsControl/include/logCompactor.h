@@ -0,0 +1,153 @@
+/**
+ * @file logCompactor.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Background compaction of closed log segments into compressed archives
+**/
+
+#ifndef _logCompactor_H_included
+#define _logCompactor_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+#include "ringBuffer.h"
+#include "logSegments.h"
+#include "flashMaintenance.h"
+#include "wearStats.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace spiffsControl{
+    //compactor config
+    constexpr int maxCompactedLogs = 4; //logs served by one compactor
+    constexpr uint32_t compactorInterval = 5000; //milli-seconds between looks for a closed segment
+    constexpr int compactorLinesPerYield = 32; //lines encoded between idle checks
+    constexpr uint32_t compactorStackSize = 4096;
+    constexpr UBaseType_t compactorPriority = tskIDLE_PRIORITY; //only runs when nothing else wants the cpu
+
+    /**
+     * @brief Encodes one line of a log into the archive being written
+     * @note hands every sealed block to logCompactor::write(); called with
+     * NULL once the segment is read, to seal the last block
+     *
+     * @param line line without the newline, or NULL
+     * @param size length of line in bytes
+     * @return true if the line was encoded;
+     * @return false if it is not a sample, e.g. the header
+     */
+    typedef bool(*line_encoder_t)(const char *line, size_t size);
+
+    /**
+     * @brief Idle-priority task that replaces closed segments of line logs
+     * with compressed archives
+     * @note - An archive is written to a partial file, read back and checked
+     * against its crc, and only then renamed and the segment removed. A reset
+     * at any point loses no records: logSegments::scan() removes a partial
+     * archive, or the segment of a whole one, and compaction carries on from
+     * the next closed segment.
+     * @note - Works while the idle check passes; a logger that starts during a
+     * compaction abandons it, and the segment is compacted again later
+     */
+    class logCompactor{
+    public:
+        logCompactor();
+        ~logCompactor();
+
+        /**
+         * @brief Adds a log to compact
+         * @note call before start()
+         *
+         * @param ring ring that writes the log
+         * @return true if added;
+         * @return false if maxCompactedLogs are already compacted
+         */
+        bool add(ringBuffer *ring);
+
+        /**
+         * @brief Starts the compactor task
+         *
+         * @param line_encoder encodes the lines of every log
+         * @param idle_check called before every segment and every compactorLinesPerYield lines
+         */
+        void start(line_encoder_t line_encoder, idle_check_t idle_check);
+
+        /**
+         * @brief Stops the compactor task
+         *
+         */
+        void stop();
+
+        /**
+         * @brief Compacts the oldest closed segment of the first log that has one
+         *
+         * @return true if a segment was compacted
+         */
+        bool step();
+
+        /**
+         * @brief Writes encoded data to the archive being written
+         * @note only called by the line encoder
+         *
+         * @param data encoded data, e.g. a compressed block
+         * @param size length of data in bytes
+         * @return true if written
+         */
+        bool write(const void *data, size_t size);
+
+        /**
+         * @brief Set the counters that every archive written is added to
+         *
+         * @param wear_stats flash wear counters, can be NULL
+         */
+        inline void setWear(wearStats *wear_stats){
+            wear = wear_stats;
+        }
+
+        /* metrics */
+        inline uint32_t getCompacted(){
+            return compacted;
+        }
+        inline uint32_t getBytesSaved(){
+            return bytes_saved;
+        }
+        inline uint32_t getFailures(){
+            return failures;
+        }
+        inline uint32_t getLastLatency(){
+            return last_latency;
+        }
+
+    private:
+        static void task(void *pvParameters);
+        bool compact(ringBuffer *ring, const Segment *segment, const char *path); //writes and checks the archive of a segment
+        bool check(const char *path, const ArchiveHeader *header); //reads an archive back and checks its crc
+
+        ringBuffer *rings[maxCompactedLogs];
+        int count;
+        line_encoder_t encode;
+        idle_check_t idle;
+        TaskHandle_t handle;
+
+        //archive being written
+        FILE *archive;
+        uint32_t archive_size; //bytes after the header
+        uint32_t archive_crc;
+        bool archive_error;
+
+        //metrics
+        uint32_t compacted; //segments compacted since boot
+        uint32_t bytes_saved; //segment bytes minus archive bytes, since boot
+        uint32_t failures; //archives that could not be written or failed their check
+        uint32_t last_latency; //micro-seconds to compact the last segment
+        wearStats *wear; //lifetime flash counters, NULL if not counted
+    };
+}
+
+#endif // _logCompactor_H_included
@@ -0,0 +1,169 @@
+/**
+ * @file logIndex.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Sparse record offset and timestamp index for a log file
+**/
+
+#ifndef _logIndex_H_included
+#define _logIndex_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace spiffsControl{
+    //index config
+    constexpr int indexStride = 32; //records between index entries
+    constexpr int indexMaxEntries = 512; //entries kept in RAM; the stride doubles when full
+    constexpr int indexLineSize = 256; //bytes of each line given to the time source on a rebuild
+
+    /**
+     * @brief Gets the timestamps held by a log record
+     *
+     * @param record record data; a .csv line is not null terminated
+     * @param size length of record in bytes
+     * @param first_out earliest timestamp in the record (seconds)
+     * @param last_out latest timestamp in the record (seconds)
+     * @return true if the record holds a timestamp
+     */
+    typedef bool(*record_time_t)(const void *record, size_t size, uint32_t *first_out, uint32_t *last_out);
+
+    /**
+     * @brief Index entry for one stride of records
+     *
+     */
+    struct IndexEntry{
+        uint32_t offset; // byte offset of the first record
+        uint32_t first; // earliest timestamp of the records, UINT32_MAX if none
+        uint32_t last; // latest timestamp of the records, 0 if none
+    };
+
+    /**
+     * @brief Byte offset and timestamp range of every indexStride-th record in a log file
+     * @note - Kept up to date as records are appended, rebuilt from the file
+     * with one pass when it is not
+     * @note - Records are either .csv lines (record size 0) or fixed-size binary records
+     * @note - A seek lands at most one stride before the requested record
+     * @note - Strides with no timestamps in a time window are skipped by query()
+     */
+    class logIndex{
+    public:
+        /**
+         * @brief Construct a new log Index object
+         * @note starts invalid; the file is scanned on the first rebuild()
+         *
+         * @param size length of every record in bytes, 0 if records are lines
+         */
+        logIndex(size_t size = 0);
+
+        /**
+         * @brief Adds a record appended to the end of the file
+         * @note ignored while the index is invalid
+         *
+         * @param data record
+         * @param size length of record in bytes
+         */
+        void add(const void *data, size_t size);
+
+        /**
+         * @brief Finds where to start reading for a record
+         *
+         * @param record record number, starting from 0
+         * @param start_out number of the record at offset_out, at most record
+         * @param offset_out byte offset of record start_out in the file
+         * @return true if found;
+         * @return false if the index is invalid or record is past the end of the file
+         */
+        bool locate(uint32_t record, uint32_t *start_out, uint32_t *offset_out);
+
+        /**
+         * @brief Finds the next stride of records with timestamps in a window
+         * @note the stride may begin before record from; skip records up to it
+         *
+         * @param first window start (seconds)
+         * @param last window end (seconds), inclusive
+         * @param from record to search from
+         * @param start_out number of the first record of the stride
+         * @param offset_out byte offset of record start_out in the file
+         * @param end_out number of the record after the stride
+         * @return true if found;
+         * @return false if no record from record from on can be in the window
+         */
+        bool query(uint32_t first, uint32_t last, uint32_t from, uint32_t *start_out, uint32_t *offset_out, uint32_t *end_out);
+
+        /**
+         * @brief Rebuilds the index by scanning the file
+         * @note a missing file is indexed as empty
+         *
+         * @param path file location
+         * @return true if the index is valid
+         */
+        bool rebuild(const char *path);
+
+        /**
+         * @brief Marks the index out of date, e.g. when the file is changed
+         * by another handle or records were lost on a failed write
+         */
+        void invalidate();
+
+        /**
+         * @brief Marks the index valid for an empty file, e.g. a new log segment
+         *
+         */
+        void clear();
+
+        /**
+         * @brief Get the timestamp range of every record indexed
+         *
+         * @param first_out earliest timestamp (seconds)
+         * @param last_out latest timestamp (seconds)
+         * @return true if the index is valid and a record holds a timestamp
+         */
+        bool range(uint32_t *first_out, uint32_t *last_out);
+
+        /**
+         * @brief Set the record size, e.g. when the index is moved to another file
+         * @note invalidates the index
+         *
+         * @param size length of every record in bytes, 0 if records are lines
+         */
+        void setRecordSize(size_t size);
+
+        /**
+         * @brief Set the function that reads timestamps from records
+         * @note invalidates the index. Without one, query() finds nothing.
+         *
+         * @param source time source, can be NULL
+         */
+        void setTimeSource(record_time_t source);
+
+        inline bool isValid(){
+            return valid;
+        }
+        inline uint32_t getCount(){
+            return count;
+        }
+        inline size_t getRecordSize(){
+            return record_size;
+        }
+
+    private:
+        void mark(const void *data, size_t size, size_t available); //adds a record starting at bytes; available bytes of it are in data
+        void compact(); //merges pairs of entries and doubles the stride
+
+        size_t record_size;
+        record_time_t time_source;
+        bool valid;
+
+        uint32_t count; //records in the file
+        uint32_t bytes; //size of the file
+        uint32_t stride; //records between entries
+        int entry_count;
+        IndexEntry entries[indexMaxEntries]; //entries[i] covers records i * stride to (i + 1) * stride - 1
+    };
+}
+
+#endif // _logIndex_H_included
@@ -0,0 +1,160 @@
+/**
+ * @file logReader.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Log downloads and time-range queries with a read position of their own
+**/
+
+#ifndef _logReader_H_included
+#define _logReader_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "logStream.h"
+#include "logSegments.h"
+#include "blockReader.h"
+#include "logStore.h"
+#include "spiffsControl.h"
+
+#include "telemetryControl.h"
+#include "telemetryCompression.h"
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    /**
+     * @brief Reads the samples of one log stream as .csv lines
+     * @note - Each reader has its own file, position, decompressor and line
+     * buffer, so get_log and a time-range query can be read at the same time
+     * @note - The log format is the record size of the stream's ring: .csv lines
+     * are returned as read, binary records and compressed blocks are returned
+     * one sample at a time as .csv lines without the journal columns.
+     * Records and blocks that fail their crc check are skipped.
+     * @note - Samples of compacted segments are decoded from their archive
+     * @note - With useLogStore, records of the stream's tag are read from the
+     * log store instead of the log files
+     * @note - A reader is used either for readNext() or for readRange(); use one
+     * reader for each
+     */
+    class logReader{
+    public:
+        /**
+         * @brief Construct a new log Reader object
+         *
+         * @param log_stream stream whose log is read
+         * @param log_store store read with useLogStore, can be NULL
+         */
+        logReader(logStream *log_stream, logStore *log_store = NULL);
+
+        /**
+         * @brief Set the stream read
+         * @note restarts the reader
+         *
+         * @param log_stream stream whose log is read
+         */
+        void setStream(logStream *log_stream);
+
+        /**
+         * @brief Starts over from the start of the log, e.g. when the log
+         * is cleared or its format changes
+         *
+         */
+        void restart();
+
+        /**
+         * @brief Reads the next sample of the log, carrying on into the next
+         * segment at the end of each one
+         * @note Starts from the oldest record kept. A .csv download that no longer
+         * starts at the header gets one first.
+         *
+         * @param line_out span of a .csv line, without the newline; valid until
+         * the next read
+         * @return true if a line was read;
+         * @return false if there are no more lines, the next call starts from
+         * the oldest record again
+         */
+        bool readNext(lineSpan *line_out);
+
+        /**
+         * @brief Moves the readNext() position to a record, walking forward
+         * from the indexed record
+         * @note a compressed log can not be sought; its samples can only be
+         * found by decoding blocks
+         *
+         * @param record record number, starting from 0 at the last clear; with
+         * useLogStore, counted from the oldest record stored
+         * @return true if the next readNext() returns the record
+         */
+        bool seek(uint32_t record);
+
+        /**
+         * @brief Set the time window of readRange()
+         * @note restarts the reader
+         *
+         * @param first window start (seconds)
+         * @param last window end (seconds), inclusive
+         */
+        void setWindow(uint32_t first, uint32_t last);
+
+        /**
+         * @brief Reads the next sample with a time in the window. Index strides
+         * with no samples in the window are skipped without being read.
+         *
+         * @param line_out span of a .csv line, without the newline; valid until
+         * the next read
+         * @return true if a line was read;
+         * @return false if there are no more samples in the window, the next
+         * call starts from the start of the log again
+         */
+        bool readRange(lineSpan *line_out);
+
+        /**
+         * @brief Reads ahead in the segment being read
+         * @note call once a line has been sent on
+         *
+         */
+        inline void prefetch(){
+            reader.prefetch();
+        }
+        inline uint32_t getFirst(){
+            return window_first;
+        }
+        inline uint32_t getLast(){
+            return window_last;
+        }
+        inline uint32_t getBlocksRead(){
+            return reader.getBlocksRead();
+        }
+
+    private:
+        bool open(uint32_t record, uint32_t *start_out); //opens the segment holding record at its index stride
+        bool openArchive(); //reads the archive header once cursor is the first record of a segment
+        int readLine(lineSpan *line_out); //number of the line read, -1 at the end of the segment
+        int readRecord(void *record_out, size_t size); //number of the record read, -1 at the end of the segment
+        bool archiveNext(telemetryControl::Telemetry *capture); //next sample of a compacted segment
+        bool storeNext(telemetryControl::Telemetry *capture); //next sample of the stream in the log store
+        void format(telemetryControl::Telemetry *capture, lineSpan *line_out); //sample as a .csv line in line
+
+        logStream *stream;
+        logStore *store;
+
+        char path[segmentPathSize]; //segment being read
+        blockReader reader;
+        uint32_t number; //number of the next record of the segment being read
+        uint32_t cursor; //next log record to read
+        bool reading; //if true, cursor is positioned
+        bool archive; //if true, the segment being read is compacted
+        uint32_t archive_end; //record after the compacted segment being read
+        telemetryControl::Decompressor decoder;
+        bool decoding; //if true, decoder holds samples not yet read
+        char line[buffer_size]; //samples that are not read from a .csv log are formatted here
+
+        //readRange() window
+        uint32_t window_first; //seconds
+        uint32_t window_last; //seconds, inclusive
+        uint32_t stride_end; //record after the index stride being read
+    };
+}
+
+#endif // _logReader_H_included
@@ -0,0 +1,267 @@
+/**
+ * @file logSegments.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Splits a log into segment files and evicts the oldest ones
+**/
+
+#ifndef _logSegments_H_included
+#define _logSegments_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_spiffs.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+namespace spiffsControl{
+    //segment config
+    constexpr int maxSegments = 48; //segment files of one log kept track of
+    constexpr int segmentPathSize = 48; //bytes of a segment file path
+    constexpr uint32_t segmentSize = 32768; //bytes; a new segment starts once the active one reaches this
+
+    //default retention policy
+    constexpr uint32_t defaultRetentionBytes = 0; //bytes kept of one log, 0 for a share of the partition budget
+    constexpr int partitionBudgetShare = 3; //partition budget: 3/4 of the partition, shared by every log
+    constexpr int partitionBudgetParts = 4;
+    constexpr int maxLogs = 12; //logs sharing the partition budget
+    constexpr uint32_t defaultRetentionAge = 0; //seconds a segment is kept after its last write, 0 for no limit
+    constexpr uint32_t segmentFreeReserve = 65536; //bytes always left free in the partition
+
+    //compacted segments
+    constexpr const char *archiveSuffix = ".arc"; //added to the segment file name, e.g. "exp_log.0000004a.csv.arc"
+    constexpr const char *partialSuffix = ".tmp"; //archive being written, removed by scan()
+    constexpr uint32_t archiveMagic = 0x4352414C; //"LARC"
+
+    //time ranges of closed segments, kept over a reset
+    constexpr const char *timesSuffix = ".times"; //added to the log name, e.g. "exp_log.csv.times"
+
+    /**
+     * @brief Segment file of a log
+     *
+     */
+    struct Segment{
+        uint32_t first_record; // number of the first record, also in the file name
+        uint32_t bytes; // size of the file
+        time_t modified; // time of the last write, 0 if unknown
+        uint32_t first_time; // earliest record timestamp (seconds); 0 if unknown, UINT32_MAX if none
+        uint32_t last_time; // latest record timestamp (seconds); UINT32_MAX if unknown, 0 if none
+        bool compacted; // if true, the file is a compressed archive of the segment (archiveSuffix)
+    };
+
+    /**
+     * @brief Header at the start of a segment archive
+     * @note followed by size bytes of encoded records, see logCompactor
+     */
+    struct __attribute__((packed)) ArchiveHeader{
+        uint32_t magic; // always archiveMagic
+        uint32_t records; // records in the segment the archive replaces
+        uint32_t samples; // records encoded; the others were not samples, e.g. the header
+        uint32_t first_time; // timestamps of the segment, as in Segment
+        uint32_t last_time;
+        uint32_t size; // bytes after the header
+        uint32_t crc; // esp_rom_crc32_le of the bytes after the header
+    };
+
+    /**
+     * @brief Time range of a closed segment, as kept in the log's times file
+     *
+     */
+    struct __attribute__((packed)) SegmentTimes{
+        uint32_t first_record; // segment the range is of
+        uint32_t first_time; // as in Segment
+        uint32_t last_time;
+    };
+
+    /**
+     * @brief Log kept as a sequence of segment files
+     * @note - "/spiffs/exp_log.csv" is kept as "/spiffs/exp_log.<first record>.csv"
+     * files, numbered in hex. Records are numbered from the last clear(), so record
+     * numbers do not change when old segments are removed.
+     * @note - Only the newest (active) segment is written; the others are never changed
+     * @note - evict() removes the oldest segments over a byte budget or age,
+     * or when the partition runs low, so a long log runs at a constant cost
+     * @note - A closed segment can be replaced by a compressed archive, see logCompactor
+     * @note - The time range of every closed segment is appended to the times file
+     * when it is closed, so a ranged query still skips it after a reset
+     * @note - Every log registers itself when constructed. Logs without a byte budget of
+     * their own split the partition budget, less the budgets of the others, between
+     * those that hold data, so together they never plan for more than the partition.
+     */
+    class logSegments{
+    public:
+        /**
+         * @brief Construct a new log Segments object
+         * @note starts with an empty segment 0; call scan() once SPIFFS is mounted
+         *
+         * @param name file location of the log, segments are named after it
+         */
+        logSegments(const char *name);
+
+        /**
+         * @brief Finds the segment files of the log
+         * @note - a log file written before segments were used becomes segment 0
+         * @note - finishes a compaction cut short by a reset: a partial archive is
+         * removed, and a segment with a whole archive keeps only the archive
+         * @note - closed segments get their time ranges back from the times file or
+         * their archive; a segment closed by older firmware keeps an unknown range
+         *
+         */
+        void scan();
+
+        /**
+         * @brief Removes every segment file and starts over at segment 0
+         *
+         */
+        void clear();
+
+        /**
+         * @brief Counts bytes appended to the active segment
+         *
+         * @param size length of data in bytes
+         */
+        void add(size_t size);
+
+        /**
+         * @brief Closes the active segment and starts a new one after it
+         * @note the writer of the active segment must be closed first
+         *
+         * @param records number of records in the active segment
+         * @param first_time earliest timestamp in the active segment (seconds)
+         * @param last_time latest timestamp in the active segment (seconds)
+         * @return true if a new segment was started
+         */
+        bool roll(uint32_t records, uint32_t first_time, uint32_t last_time);
+
+        /**
+         * @brief Removes the oldest segments while the log is over its budget, the
+         * oldest segment is too old, or the partition is nearly full
+         * @note never removes the active segment
+         *
+         * @param max_bytes bytes kept of the log, 0 for a share of the partition budget
+         * @param max_age seconds a segment is kept after its last write, 0 for no limit
+         * @return int - number of segments removed
+         */
+        int evict(uint32_t max_bytes, uint32_t max_age);
+
+        /**
+         * @brief Set the bytes the log keeps, so the other logs leave them out of their share
+         * @note call whenever the budget given to evict() changes
+         *
+         * @param max_bytes bytes kept of the log, 0 for a share of the partition budget
+         */
+        inline void setBudget(uint32_t max_bytes){
+            budget = max_bytes;
+        }
+
+        /**
+         * @brief Removes the oldest segment, e.g. when a write fails because the partition is full
+         *
+         * @return true if a segment was removed
+         */
+        bool evictOldest();
+
+        /**
+         * @brief Replaces a closed segment with its archive
+         * @note the archive must already be at the segment's path with archiveSuffix
+         *
+         * @param first_record number of the first record of the segment
+         * @param bytes size of the archive
+         * @return true if the segment file was removed;
+         * @return false if the segment is active, compacted or was evicted
+         */
+        bool compact(uint32_t first_record, uint32_t bytes);
+
+        /**
+         * @brief Finds the oldest closed segment that is not compacted
+         *
+         * @return int - segment, counted from the oldest; -1 if there is none
+         */
+        int findUncompacted();
+
+        /**
+         * @brief Checks if a segment path is an archive
+         *
+         * @param path segment file location, from getPath()
+         * @return true if the segment is compacted
+         */
+        static bool isArchive(const char *path);
+
+        /**
+         * @brief Finds the segment holding a record
+         *
+         * @param record record number
+         * @return int - segment, counted from the oldest; -1 if the record was removed
+         */
+        int find(uint32_t record);
+
+        /**
+         * @brief Get the file location of a segment
+         *
+         * @param segment segment, counted from the oldest
+         * @param path_out segmentPathSize bytes
+         */
+        void getPath(int segment, char *path_out);
+
+        /**
+         * @brief Get a segment
+         *
+         * @param segment segment, counted from the oldest
+         * @return const Segment*
+         */
+        inline const Segment *get(int segment){
+            return &segments[segment];
+        }
+        inline const Segment *getActive(){
+            return &segments[count - 1];
+        }
+        inline const char *getActivePath(){
+            return active_path;
+        }
+        inline int getCount(){
+            return count;
+        }
+        inline uint32_t getOldest(){
+            return segments[0].first_record;
+        }
+        inline uint32_t getEvicted(){
+            return evicted;
+        }
+        inline uint32_t getCompactions(){
+            return compactions;
+        }
+        uint32_t getBytes(); //bytes in every segment
+
+    private:
+        bool parse(const char *file_name, uint32_t *first_out, const char **suffix_out); //gets the first record and suffix ("", archiveSuffix or partialSuffix) from a segment file name
+        void remove(int segment);
+        void activate(); //sets active_path to the newest segment
+        bool readHeader(int segment, ArchiveHeader *header_out); //reads the header of a compacted segment
+        void getTimesPath(char *path_out); //segmentPathSize bytes
+        void saveTimes(const Segment *segment); //appends the range of a closed segment to the times file
+        void loadTimes(); //sets the ranges of closed segments from the times file, then rewrites it with only those
+        uint32_t share(size_t total); //this log's part of the partition budget, for a partition of total bytes
+
+        char dir[segmentPathSize]; //directory of the log, e.g. "/spiffs"
+        char stem[segmentPathSize]; //file name before the extension, e.g. "exp_log"
+        const char *extension; //e.g. ".csv"
+        const char *name;
+
+        Segment segments[maxSegments]; //oldest first
+        int count;
+        char active_path[segmentPathSize]; //written by the log's ringBuffer
+
+        uint32_t budget; //bytes kept of the log, 0 for a share of the partition budget
+        bool holding; //if true, the log holds data and takes a share of the partition budget
+
+        static logSegments *logs[maxLogs]; //every log constructed
+        static int log_count;
+
+        uint32_t evicted; //segments removed since boot
+        uint32_t compactions; //segments replaced by their archive since boot
+    };
+}
+
+#endif // _logSegments_H_included
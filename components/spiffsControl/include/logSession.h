@@ -0,0 +1,158 @@
+/**
+ * @file logSession.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Independent log read sessions with watermarks kept in NVS
+**/
+
+#ifndef _logSession_H_included
+#define _logSession_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+#include "logSegments.h"
+#include "blockReader.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace spiffsControl{
+    //session config
+    constexpr int maxSessions = 4; //consumers with their own watermark
+    constexpr const char *sessionNamespace = "logsync"; //NVS namespace of the watermarks
+
+    /**
+     * @brief Read session over a log file for one consumer
+     * @note - Each session has its own file handle and position, so sessions
+     * and spiffs::readLine() can be used at the same time
+     * @note - The watermark is the number of records the consumer has acknowledged.
+     * It is kept in NVS and survives a reset.
+     * @note - After a reset or rewind() the session must be moved to its
+     * position with seek() before reading
+     */
+    class logSession{
+    public:
+        /**
+         * @brief Construct a new log Session object
+         * @note call load() before use
+         *
+         */
+        logSession();
+        ~logSession();
+
+        /**
+         * @brief Initializes the NVS partition
+         * @note erases NVS if it is full or from a newer IDF version
+         *
+         * @return esp_err_t
+         */
+        static esp_err_t init();
+
+        /**
+         * @brief Loads the session's watermark from NVS and rewinds to it
+         *
+         * @param session_id session number, from 0 to maxSessions - 1
+         * @param stream number of the log stream read, each stream has its own watermarks
+         * @return esp_err_t
+         */
+        esp_err_t load(uint8_t session_id, uint8_t stream = 0);
+
+        /**
+         * @brief Moves the read position to a record
+         *
+         * @param path file location
+         * @param record number of the record at offset
+         * @param offset byte offset of the record
+         * @return true if the position was moved
+         */
+        bool seek(const char *path, uint32_t record, uint32_t offset);
+
+        /**
+         * @brief Reads the next line
+         * @note a line still being written (no newline yet) is not read
+         * @note a line longer than readerLineSize - 1 bytes is returned cut
+         * short, and the rest of it is skipped, so the position still advances
+         *
+         * @param line_out span of the line, without the newline; valid until
+         * the next readLine()
+         * @return int - if -1, there are no more lines to read, else returns
+         * the number of the line returned.
+         */
+        int readLine(lineSpan *line_out);
+
+        /**
+         * @brief Reads the next fixed-size record
+         * @note a partial record at the end of the file is not read
+         *
+         * @param record_out buffer to write record data to
+         * @param size length of record in bytes
+         * @return int - if -1, there are no more records to read, else returns
+         * the number of the record returned.
+         */
+        int readRecord(void *record_out, size_t size);
+
+        /**
+         * @brief Sets the watermark and writes it to NVS
+         *
+         * @param record number of records acknowledged
+         * @return esp_err_t
+         */
+        esp_err_t commit(uint32_t record);
+
+        /**
+         * @brief Moves the read position back to the watermark
+         * @note records read since the last commit() will be read again
+         *
+         */
+        void rewind();
+
+        /**
+         * @brief Sets the watermark and position to 0, e.g. when the log is cleared
+         *
+         * @return esp_err_t
+         */
+        esp_err_t reset();
+
+        /**
+         * @brief Sets the read position without a file, for stores read by record number
+         *
+         * @param record next record to read
+         */
+        inline void setPosition(uint32_t record){
+            position = record;
+        }
+        inline uint32_t getPosition(){
+            return position;
+        }
+        inline uint32_t getWatermark(){
+            return watermark;
+        }
+        inline bool isPositioned(){
+            return positioned;
+        }
+        inline const char *getPath(){
+            return file_path;
+        }
+
+    private:
+        bool open(); //reopens the file at offset
+        void close();
+
+        uint8_t id;
+        char key[8]; //NVS key of the watermark
+
+        char file_path[segmentPathSize];
+        FILE *file;
+        char line[readerLineSize]; //last line read
+        bool positioned; //if true, offset is the byte offset of record position
+        uint32_t position; //next record to read
+        uint32_t offset;
+
+        uint32_t watermark;
+    };
+}
+
+#endif // _logSession_H_included
@@ -0,0 +1,84 @@
+/**
+ * @file logStream.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Tagged, rate-limited log stream with its own log files
+**/
+
+#ifndef _logStream_H_included
+#define _logStream_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "ringBuffer.h"
+#include "logSegments.h"
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    /**
+     * @brief One producer's log, e.g. the experiment or the passive logger
+     * @note - Each stream has its own ring, segment files and index, so a reader
+     * of one stream never reads past another's records
+     * @note - The tag tells the streams apart where they share storage (log store records)
+     * @note - admit() limits how often the producer may log a sample
+     */
+    class logStream{
+    public:
+        /**
+         * @brief Construct a new log Stream object
+         *
+         * @param stream_tag tag of the stream's records
+         * @param log segmented log the stream is written to
+         * @param record_size length of every record in bytes, 0 if records are lines
+         */
+        logStream(uint8_t stream_tag, logSegments *log, size_t record_size = 0);
+
+        /**
+         * @brief Checks the rate limit before a sample is logged
+         *
+         * @return true if the sample may be logged;
+         * @return false if it comes less than the minimum interval after the last one
+         */
+        bool admit();
+
+        /**
+         * @brief Set the rate limit
+         *
+         * @param min_interval milli-seconds between samples, 0 for no limit
+         */
+        void setInterval(uint32_t min_interval);
+
+        inline ringBuffer *getRing(){
+            return &ring;
+        }
+        inline uint8_t getTag(){
+            return tag;
+        }
+        inline uint32_t getInterval(){
+            return (uint32_t)(interval / 1000);
+        }
+        inline uint32_t getAdmitted(){
+            return admitted;
+        }
+        inline uint32_t getLimited(){
+            return limited;
+        }
+
+    private:
+        uint8_t tag;
+        ringBuffer ring;
+
+        //rate limit
+        int64_t interval; //micro-seconds
+        int64_t last; //time (micro-seconds) the last sample was admitted, 0 if none
+
+        //metrics
+        uint32_t admitted; //samples admitted since boot
+        uint32_t limited; //samples refused by the rate limit since boot
+    };
+}
+
+#endif // _logStream_H_included
@@ -0,0 +1,111 @@
+/**
+ * @file logWriter.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Appends to a log file through a handle that stays open
+**/
+
+#ifndef _logWriter_H_included
+#define _logWriter_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace spiffsControl{
+    //writer config
+    constexpr uint32_t defaultSyncInterval = 0; //milli-seconds between fsync calls; 0 syncs every write
+
+    /**
+     * @brief Append-only file writer
+     * @note - Opens the file once and keeps the descriptor open between writes
+     * @note - Unbuffered: the ring already groups records, so each write() is one
+     * file system write and its error (e.g. ENOSPC) is returned by that write
+     * @note - Counts bytes written and write errors
+     */
+    class logWriter{
+    public:
+        /**
+         * @brief Construct a new log Writer object
+         * @note the file is opened on the first write
+         *
+         * @param path file location
+         */
+        logWriter(const char *path);
+        ~logWriter();
+
+        /**
+         * @brief Appends data to the file
+         * @note opens the file if needed and fsyncs if the sync interval has passed.
+         * On an error the handle is closed so the next write reopens it.
+         *
+         * @param data data to append
+         * @param size length of data in bytes
+         * @return size_t - number of bytes written
+         */
+        size_t write(const void *data, size_t size);
+
+        /**
+         * @brief Fsyncs the file, flushing the file system's cache of it
+         *
+         * @return true if the data reached flash
+         */
+        bool sync();
+
+        /**
+         * @brief Syncs and closes the handle
+         * @note Call before another handle truncates or removes the file
+         */
+        void close();
+
+        /**
+         * @brief Change the file being written to
+         * @note closes the current file first
+         *
+         * @param path file location
+         */
+        void setPath(const char *path);
+
+        /**
+         * @brief Set the time between automatic fsync calls
+         *
+         * @param interval milli-seconds; 0 syncs after every write
+         */
+        void setSyncInterval(uint32_t interval);
+
+        inline const char *getPath(){
+            return file_path;
+        }
+        inline bool isOpen(){
+            return fd >= 0;
+        }
+        inline uint32_t getBytesWritten(){
+            return bytes_written;
+        }
+        inline uint32_t getErrors(){
+            return errors;
+        }
+        inline int getLastError(){
+            return last_error;
+        }
+
+    private:
+        bool open();
+        void fail(const char *operation);
+
+        const char *file_path;
+        int fd; //-1 while closed
+
+        int64_t sync_interval; //micro-seconds
+        int64_t last_sync; //time (micro-seconds) of the last fsync
+
+        uint32_t bytes_written; //bytes accepted since boot
+        uint32_t errors; //failed opens, writes and syncs since boot
+        int last_error; //errno of the most recent error
+    };
+}
+
+#endif // _logWriter_H_included
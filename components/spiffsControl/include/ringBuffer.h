@@ -0,0 +1,329 @@
+/**
+ * @file ringBuffer.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Buffers log writes in RAM and commits them to flash in groups
+**/
+
+#ifndef _ringBuffer_H_included
+#define _ringBuffer_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "logWriter.h"
+#include "logIndex.h"
+#include "logSegments.h"
+#include "latencyHistogram.h"
+#include "wearStats.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace spiffsControl{
+    //ring config
+    constexpr int ringSize = 8192; //bytes held in RAM between flushes
+    constexpr int flashPageSize = 256; //SPIFFS logical page size (CONFIG_SPIFFS_PAGE_SIZE)
+
+    //default flush policy
+    constexpr int defaultFlushRecords = 64; //records
+    constexpr uint32_t defaultFlushAge = 60000; //milli-seconds
+    constexpr int defaultFlushPages = 4; //pages
+
+    /**
+     * @brief Bounded in-RAM ring of log records in front of a file
+     * @note - Records are appended to RAM and written to the file in one group
+     * @note - Flushes when a record count, record age or page count is reached
+     * @note - Flushes in the appending task, or in a writer task given to defer()
+     * @note - Tracks occupancy and flush latency
+     * @note - Keeps a sparse offset index of the records in the file
+     * @note - The file is the active segment of a logSegments log. A new segment
+     * is started once it reaches segmentSize, and the oldest segments are evicted
+     * under the retention policy.
+     * @note - Appends, flushes and rolls hold the ring's mutex, and a flush or
+     * roll also takes the SPIFFS lock. A task that appends must never be deleted
+     * by another task: it would end holding the locks, and every later append or
+     * read of the ring would block. Stop such a task cooperatively, so it deletes
+     * itself between appends (see logger_stop() in main.cpp).
+     */
+    class ringBuffer{
+    public:
+        /**
+         * @brief Construct a new ring Buffer object
+         * @note records are written through a logWriter that keeps the file open
+         *
+         * @param log segmented log that flushed records are appended to
+         * @param record_size length of every record in bytes, 0 if records are lines
+         */
+        ringBuffer(logSegments *log, size_t record_size = 0);
+        ~ringBuffer();
+
+        /**
+         * @brief Set when the ring is flushed. A limit of 0 turns that policy off.
+         *
+         * @param max_records flush everything once this many records are buffered
+         * @param max_age flush everything once the oldest record is this old (milli-seconds)
+         * @param page_count flush whole flash pages once this many pages are buffered.
+         * The remainder stays in RAM so the write ends on a page boundary of the
+         * file, also after a record count or age flush of a partial page.
+         */
+        void setPolicy(int max_records, uint32_t max_age, int page_count);
+
+        /**
+         * @brief Set how much of the log is kept. The oldest segments are
+         * evicted when a segment is started or the partition is full.
+         *
+         * @param max_bytes bytes kept, 0 for a share of the partition budget, see logSegments
+         * @param max_age seconds a segment is kept after its last write, 0 for no limit
+         */
+        void setRetention(uint32_t max_bytes, uint32_t max_age);
+
+        /**
+         * @brief Change the log that records are flushed to
+         * @note buffered records are flushed to the previous log first
+         *
+         * @param log segmented log
+         * @param record_size length of every record in bytes, 0 if records are lines
+         */
+        void setLog(logSegments *log, size_t record_size = 0);
+
+        /**
+         * @brief Leaves flushes to a writer task, so appends only copy to RAM.
+         * append() notifies the task when a policy is met and the task calls service().
+         * @note a record that does not fit is still flushed in the appending task
+         *
+         * @param writer_task task that calls service(), NULL to flush in append() again
+         */
+        void defer(TaskHandle_t writer_task);
+
+        /**
+         * @brief Flushes if a policy is met and starts a new segment if the active
+         * one is full. Called by the writer task given to defer().
+         *
+         */
+        void service();
+
+        /**
+         * @brief Adds a record to the ring, flushing if a policy is met
+         * @note flushes first if the record does not fit
+         *
+         * @param data record
+         * @param size length of record in bytes
+         * @return true if the record was buffered;
+         * @return false if the record was dropped
+         */
+        bool append(const void *data, size_t size);
+
+        /**
+         * @brief Writes every buffered record to the file and fsyncs it
+         * @note Call before stopping a logger, sleeping or restarting
+         *
+         * @return true if every record reached flash
+         */
+        bool flush();
+
+        /**
+         * @brief Flushes and closes the file
+         * @note Call before the file is cleared or removed. The next
+         * flush reopens it.
+         */
+        void close();
+
+        /**
+         * @brief Drops buffered records and removes every segment of the log
+         * @note record numbers start from 0 again
+         *
+         */
+        void clear();
+
+        /**
+         * @brief Flushes and closes the active segment, so every record
+         * logged so far is in a closed segment, e.g. once an experiment ends
+         * @note does nothing if the active segment is empty
+         *
+         */
+        void seal();
+
+        /**
+         * @brief Finds the oldest closed segment of a line log that is not compacted
+         * @note logs of fixed-size records are not compacted
+         *
+         * @param segment_out copy of the segment
+         * @param path_out segment file, segmentPathSize bytes
+         * @return true if found
+         */
+        bool nextCompaction(Segment *segment_out, char *path_out);
+
+        /**
+         * @brief Replaces a segment found by nextCompaction() with its archive
+         *
+         * @param segment copy of the segment from nextCompaction()
+         * @param bytes size of the archive
+         * @return true if the segment file was removed;
+         * @return false if the segment was evicted or cleared since; the archive is not used
+         */
+        bool compacted(const Segment *segment, uint32_t bytes);
+
+        /**
+         * @brief Finds where a record starts in the log, so a reader can
+         * seek to it instead of reading from the start
+         * @note flushes first. The index is rebuilt from the file if it is out
+         * of date (after close(), setLog() or a failed write).
+         * @note the active segment is indexed; a line in an older segment is
+         * found from the start of its segment
+         * @note a compacted segment is found at the start of its archive
+         *
+         * @param record record number, starting from 0 at the last clear()
+         * @param start_out number of the record at offset_out, at most one
+         * index stride or segment before record
+         * @param offset_out byte offset of record start_out in the segment
+         * @param path_out segment file holding the record, segmentPathSize bytes
+         * @return true if found;
+         * @return false if record is past the end of the log or was evicted
+         */
+        bool locate(uint32_t record, uint32_t *start_out, uint32_t *offset_out, char *path_out);
+
+        /**
+         * @brief Finds the next stride of records in the log that may have
+         * timestamps in a window
+         * @note flushes first and rebuilds the index if it is out of date, like locate()
+         * @note an older segment is one stride; it is skipped if the time range
+         * seen when it was closed is outside the window
+         *
+         * @param first window start (seconds)
+         * @param last window end (seconds), inclusive
+         * @param from record to search from
+         * @param start_out number of the first record of the stride; may be before from
+         * @param offset_out byte offset of record start_out in the segment
+         * @param end_out number of the record after the stride
+         * @param path_out segment file holding the stride, segmentPathSize bytes
+         * @return true if found;
+         * @return false if no record from record from on can be in the window
+         */
+        bool query(uint32_t first, uint32_t last, uint32_t from, uint32_t *start_out, uint32_t *offset_out, uint32_t *end_out, char *path_out);
+
+        /**
+         * @brief Get the number of the oldest record not evicted
+         *
+         * @return uint32_t
+         */
+        uint32_t getOldest();
+
+        /**
+         * @brief Get the bytes kept in every segment of the log
+         *
+         * @return uint32_t
+         */
+        uint32_t getRetainedBytes();
+
+        /**
+         * @brief Set the function that reads timestamps from records for query()
+         * @note called with every appended record and, on a rebuild, every record in the file
+         *
+         * @param source time source, can be NULL
+         */
+        void setTimeSource(record_time_t source);
+
+        /**
+         * @brief Set the counters that every flush is added to
+         *
+         * @param wear_stats flash wear counters, can be NULL
+         */
+        void setWear(wearStats *wear_stats);
+
+        /* metrics */
+        inline int getOccupancy(){
+            return used;
+        }
+        inline int getPeakOccupancy(){
+            return peak_used;
+        }
+        inline uint32_t getFlushCount(){
+            return flush_count;
+        }
+        inline uint32_t getLastFlushLatency(){
+            return last_flush_latency;
+        }
+        inline uint32_t getMaxFlushLatency(){
+            return max_flush_latency;
+        }
+        inline uint32_t getDropped(){
+            return dropped;
+        }
+        inline uint32_t getForegroundFlushes(){
+            return foreground_flushes;
+        }
+        inline uint32_t getBytesWritten(){
+            return writer.getBytesWritten();
+        }
+        inline uint32_t getWriteErrors(){
+            return writer.getErrors();
+        }
+        inline latencyHistogram *getLatency(){
+            return &latency;
+        }
+        inline size_t getRecordSize(){
+            return index.getRecordSize();
+        }
+        inline uint32_t getRetentionBytes(){
+            return retention_bytes;
+        }
+        inline uint32_t getRetentionAge(){
+            return retention_age;
+        }
+        inline int getSegmentCount(){
+            return segments->getCount();
+        }
+        inline uint32_t getEvicted(){
+            return segments->getEvicted();
+        }
+        inline uint32_t getCompactions(){
+            return segments->getCompactions();
+        }
+
+    private:
+        bool write(int length); //lock must be held
+        void prepareIndex(); //flushes and rebuilds the index if needed; lock must be held
+        void roll(); //starts a new segment and evicts old ones; lock must be held
+        int due(); //bytes a flush policy wants written, 0 if none; lock must be held
+
+        logSegments *segments;
+        logWriter writer;
+        logIndex index;
+        uint8_t *buffer;
+        int head; //next byte to write
+        int used; //bytes buffered
+        int records; //records appended since the last flush
+        int64_t oldest; //time (micro-seconds) the oldest unflushed record was appended
+
+        //policy
+        int flush_records;
+        int64_t flush_age; //micro-seconds
+        int flush_bytes;
+
+        //retention
+        uint32_t retention_bytes;
+        uint32_t retention_age; //seconds
+
+        //metrics
+        int peak_used;
+        uint32_t flush_count;
+        uint32_t last_flush_latency; //micro-seconds
+        uint32_t max_flush_latency; //micro-seconds
+        uint32_t dropped;
+        latencyHistogram latency; //flush latency
+        wearStats *wear; //lifetime flash counters, NULL if not counted
+
+        TaskHandle_t writer_task; //flushes for append(), NULL if append() flushes
+        uint32_t foreground_flushes; //flushes in append() to make room while deferred
+
+        SemaphoreHandle_t lock; //never held across the deletion of a task, see class notes
+    };
+}
+
+#endif // _ringBuffer_H_included
@@ -0,0 +1,107 @@
+/**
+ * @file sessionReader.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Samples of a log stream read through a session with a watermark
+**/
+
+#ifndef _sessionReader_H_included
+#define _sessionReader_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "logSession.h"
+#include "logStream.h"
+#include "logSegments.h"
+#include "logStore.h"
+#include "spiffsControl.h"
+
+#include "telemetryControl.h"
+#include "telemetryCompression.h"
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    /**
+     * @brief Reads the samples of one log stream for one consumer, as .csv lines
+     * @note - Reads through a logSession, so the consumer only gets what was logged
+     * since its watermark, and keeps its position across a reset
+     * @note - Has its own decompressor and line buffer; sessions do not share a
+     * position with each other or with a logReader
+     * @note - After a reset or rewind() the log index finds the session's position
+     * in the log. Records evicted by the retention policy are skipped.
+     * @note - Positions count records of the log (.csv lines, binary records or
+     * compressed blocks), samples in a compacted segment, or store sequence
+     * numbers with useLogStore
+     */
+    class sessionReader{
+    public:
+        sessionReader();
+
+        /**
+         * @brief Loads the session's watermark from NVS and rewinds to it
+         *
+         * @param session_id session number, from 0 to maxSessions - 1
+         * @param stream_id number of the log stream read
+         * @param log_stream stream whose log is read
+         * @param log_store store read with useLogStore, can be NULL
+         * @return esp_err_t
+         */
+        esp_err_t load(uint8_t session_id, uint8_t stream_id, logStream *log_stream, logStore *log_store = NULL);
+
+        /**
+         * @brief Reads the next sample after the session's position
+         *
+         * @param line_out span of a .csv line, without the newline; valid until
+         * the next read
+         * @return true if a sample was read;
+         * @return false if the session has read every sample
+         */
+        bool readNext(lineSpan *line_out);
+
+        /**
+         * @brief Acknowledges every sample returned, moving the watermark up to them
+         * @note a compressed block is acknowledged once all of its samples have been returned
+         *
+         * @return esp_err_t
+         */
+        esp_err_t commit();
+
+        /**
+         * @brief Moves the read position back to the watermark
+         * @note samples read since the last commit() will be read again
+         *
+         */
+        void rewind();
+
+        /**
+         * @brief Sets the watermark and position to 0, e.g. when the log is cleared
+         * or its format changes
+         *
+         * @return esp_err_t
+         */
+        esp_err_t reset();
+
+        inline uint32_t getWatermark(){
+            return session.getWatermark();
+        }
+
+    private:
+        bool seek(bool next); //moves the session to its position in the log files
+        bool archiveNext(telemetryControl::Telemetry *capture); //next sample of a compacted segment
+        void format(telemetryControl::Telemetry *capture, lineSpan *line_out); //sample as a .csv line in line
+
+        logSession session;
+        logStream *stream;
+        logStore *store;
+
+        telemetryControl::Decompressor decoder;
+        bool decoding; //if true, decoder holds samples not yet read
+        bool archive; //if true, the session is reading a compacted segment
+        uint32_t archive_end; //record after the compacted segment being read
+        char line[buffer_size]; //samples that are not read from a .csv log are formatted here
+    };
+}
+
+#endif // _sessionReader_H_included
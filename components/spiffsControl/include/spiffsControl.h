@@ -10,6 +10,7 @@
 
 #include "esp_log.h"
 #include "esp_err.h"
+#include "sdkconfig.h"
 
 #include <string.h>
 #include <sys/unistd.h>
@@ -22,6 +23,38 @@
 namespace spiffsControl{
     constexpr int buffer_size = 256;
 
+    //storage engine for telemetry, see Kconfig
+#ifdef CONFIG_SPIFFSCONTROL_LOG_STORE
+    constexpr bool useLogStore = true; //records on the raw partition; SPIFFS is not mounted
+#else
+    constexpr bool useLogStore = false; //log files on SPIFFS
+#endif
+
+    //power loss recovery, see Kconfig
+#ifdef CONFIG_SPIFFSCONTROL_BOOT_CHECK
+    constexpr bool bootCheck = true; //SPIFFS_check() at boot if the partition is inconsistent
+#else
+    constexpr bool bootCheck = false;
+#endif
+    constexpr long recoveryScanSize = 16384; //bytes at the end of a log checked by recover(); more than one ring flush and the writer buffer
+
+    //files open at once, worst case; SPIFFS refuses to open more than maxOpenFiles
+    constexpr int openLogWriters = 4; //kept open by the logWriter of every ring: 2 log streams, 2 rollup tiers
+    constexpr int openBlockReaders = 2; //get_log and get_log_range
+    constexpr int openSessions = 10; //logSessions left open between reads: 4 read sessions of 2 streams, 2 rollup readers
+    constexpr int openCompactor = 2; //segment being compacted and its archive
+    constexpr int openTransient = 3; //opened and closed in one call: index rebuild, archive header, recovery or clear
+    constexpr int maxOpenFiles = openLogWriters + openBlockReaders + openSessions + openCompactor + openTransient;
+
+    /**
+     * @brief Checks a log record
+     * 
+     * @param record record data; a .csv line is not null terminated
+     * @param size length of record in bytes
+     * @return true if the record is complete and not corrupt
+     */
+    typedef bool(*record_check_t)(const void *record, size_t size);
+
     /**
      * @brief Flash storage core driver:
      * @note - mount FAT flash storage
@@ -32,11 +65,21 @@ namespace spiffsControl{
     public:
         /**
          * @brief Construct a new File Core object
-         * @note constructor calls mount() to access file storage
+         * @note call init() before use; the constructor does not touch flash,
+         * so a global spiffs does not hold up start-up
          */
         spiffs();
         ~spiffs();
 
+        /**
+         * @brief Calls mount() to access file storage, unless the partition
+         * belongs to the log store (useLogStore)
+         * @note SPIFFS_check() only runs if bootCheck is set, and can take seconds;
+         * call from a task that nothing urgent waits on
+         * 
+         */
+        void init();
+
         /**
          * @brief mounts the SPIFFS flash storage device over SPI
          * 
@@ -45,40 +88,47 @@ namespace spiffsControl{
 
         /**
          * @brief Checks the SPIFFS partition
+         * @note Never formats. Runs SPIFFS_check() if the partition is inconsistent,
+         * which can take seconds.
          * 
+         * @param repair if false, only reports whether the partition is inconsistent
+         * @return true if the partition is consistent or was repaired
          */
-        void checkSPIFFS();
+        bool checkSPIFFS(bool repair = true);
 
         /**
-         * @brief Overwrites with a blank file
+         * @brief Drops a record torn by a power loss from the end of a log file
+         * @note - Call at boot, before the file is appended to
+         * @note - Checks records from the end of the file backwards until one passes
+         * check, and truncates the file after it. Reads at most recoveryScanSize bytes,
+         * so boot time does not depend on the size of the log.
+         * @note - If no record in that range passes, only a partial record at the
+         * end is dropped; complete records are never removed by a failed scan
          * 
          * @param path file location
+         * @param record_size length of every record in bytes, 0 if records are lines
+         * @param check function that checks a record
+         * @return long - number of bytes dropped, -1 on error
          */
-        void clearLog(const char *path);
+        long recover(const char *path, size_t record_size, record_check_t check);
 
         /**
-         * @brief Adds a line to the end of a file
+         * @brief Overwrites with a blank file
          * 
          * @param path file location
-         * @param message data to append
          */
-        void addLine(const char *path, const char *message);
+        void clearLog(const char *path);
 
         /**
-         * @brief Reads a line from the file in consecutive order.
-         * Starting from the first line. Call again to read the next line
+         * @brief Adds a line to the end of a file
          * 
          * @param path file location
-         * @param string_out string to write line data to
-         * @return int - if -1, there are no more lines to read, else returns
-         * the number of the line returned.
+         * @param message data to append
          */
-        int readLine(const char *path, std::string *string_out);
+        void addLine(const char *path, const char *message);
 
     private:
         esp_vfs_spiffs_conf_t conf; //config data for SPIFFS
-        int line_number; //number of line last read by readLine()
-        FILE *open_file; //File object being read by readLine()
     };
 }
 
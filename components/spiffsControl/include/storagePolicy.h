@@ -0,0 +1,121 @@
+/**
+ * @file storagePolicy.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Tiers of sampling throttle chosen by the free flash left
+**/
+
+#ifndef _storagePolicy_H_included
+#define _storagePolicy_H_included
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    //policy config
+    constexpr int maxPolicyTiers = 4;
+    constexpr uint32_t policyHysteresis = 16384; //free bytes above a tier's threshold before it is left
+    constexpr uint32_t policyCheckInterval = 5000; //milli-seconds between checks of the free flash
+    constexpr uint8_t policyMaxStretch = 31; //largest interval multiplier
+    constexpr uint8_t defaultPolicyStreams = 0x02; //passive logger stream
+
+    /**
+     * @brief One step of the throttle
+     *
+     */
+    struct PolicyTier{
+        uint32_t free_bytes; // tier applies below this much free flash, 0 if unused
+        uint8_t stretch; // sample interval multiplier
+    };
+
+    /**
+     * @brief Stretches logger sample intervals as the log partition fills, so a
+     * long campaign keeps logging at a lower rate instead of running out of flash
+     * @note - The tier with the least free_bytes that is above the free flash applies
+     * @note - A tier is entered below its threshold and only left policyHysteresis
+     * bytes above it, so eviction or compaction near a threshold does not flap
+     * @note - Only loggers in the stream mask are throttled
+     * @note - The log format is never changed by the policy: a switch would
+     * restart the readers and sessions of the stream from the loggers' task.
+     * Compressed blocks are set over i2c, or left to the log compactor.
+     */
+    class storagePolicy{
+    public:
+        /**
+         * @brief Construct a new storage Policy object
+         * @note starts with the default tiers, throttling the passive stream
+         *
+         */
+        storagePolicy();
+
+        /**
+         * @brief Set one tier
+         *
+         * @param tier from 0 to maxPolicyTiers - 1
+         * @param free_bytes tier applies below this much free flash, 0 to remove it
+         * @param stretch sample interval multiplier, from 1 to policyMaxStretch
+         * @return true if set
+         */
+        bool setTier(int tier, uint32_t free_bytes, uint8_t stretch);
+
+        /**
+         * @brief Set the log streams that are throttled
+         *
+         * @param mask bit n set to throttle stream n
+         */
+        inline void setStreams(uint8_t mask){
+            streams = mask;
+        }
+
+        /**
+         * @brief Checks if the free flash should be measured again
+         *
+         * @return true once every policyCheckInterval
+         */
+        bool due();
+
+        /**
+         * @brief Chooses the tier for the free flash left
+         *
+         * @param free_bytes unused bytes of the log partition
+         * @return int - tier that applies, -1 if none
+         */
+        int update(uint32_t free_bytes);
+
+        /**
+         * @brief Get the sample interval of a logger under the tier that applies
+         *
+         * @param stream log stream of the logger
+         * @param interval sample interval set for the logger (milli-seconds)
+         * @return uint32_t - interval to sample at (milli-seconds)
+         */
+        uint32_t stretch(uint8_t stream, uint32_t interval);
+
+        inline int getActive(){
+            return active;
+        }
+        inline uint8_t getStreams(){
+            return streams;
+        }
+        inline uint32_t getFreeBytes(){
+            return last_free;
+        }
+        inline uint32_t getChanges(){
+            return changes;
+        }
+
+    private:
+        PolicyTier tiers[maxPolicyTiers];
+        uint8_t streams; //bit n set if stream n is throttled
+        volatile int active; //tier that applies, -1 if none
+        int64_t last_check; //micro-seconds
+
+        //metrics
+        uint32_t last_free; //free bytes at the last update
+        uint32_t changes; //tier changes since boot
+    };
+}
+
+#endif // _storagePolicy_H_included
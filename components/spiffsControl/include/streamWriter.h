@@ -0,0 +1,77 @@
+/**
+ * @file streamWriter.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Single task that writes every log stream to flash
+**/
+
+#ifndef _streamWriter_H_included
+#define _streamWriter_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "logStream.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    //writer config
+    constexpr int maxStreams = 4; //streams served by one writer
+    constexpr uint32_t writerPassInterval = 1000; //milli-seconds between passes when no stream asks, for the age policy
+    constexpr uint32_t writerStackSize = 4096;
+    constexpr UBaseType_t writerPriority = 2; //below the experiment logger, above the passive logger and maintenance
+
+    /**
+     * @brief Serialized writer for log streams
+     * @note - Loggers only copy records into their stream's ring; this task does
+     * every policy flush and segment change, one stream at a time
+     * @note - A stream whose ring fills before the task runs still flushes in the logger
+     */
+    class streamWriter{
+    public:
+        streamWriter();
+        ~streamWriter();
+
+        /**
+         * @brief Adds a stream to be written
+         * @note call before start()
+         *
+         * @param stream log stream
+         * @return true if added;
+         * @return false if maxStreams are already written
+         */
+        bool add(logStream *stream);
+
+        /**
+         * @brief Starts the writer task and hands it the flushes of every stream
+         *
+         */
+        void start();
+
+        /**
+         * @brief Stops the writer task; streams flush in their loggers again
+         *
+         */
+        void stop();
+
+        inline uint32_t getPasses(){
+            return passes;
+        }
+
+    private:
+        static void task(void *pvParameters);
+
+        logStream *streams[maxStreams];
+        int count;
+        TaskHandle_t handle;
+        volatile bool running; //cleared to end the task
+
+        uint32_t passes; //passes over the streams since start
+    };
+}
+
+#endif // _streamWriter_H_included
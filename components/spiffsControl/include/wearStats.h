@@ -0,0 +1,152 @@
+/**
+ * @file wearStats.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Flash write and wear accounting kept in NVS across resets
+**/
+
+#ifndef _wearStats_H_included
+#define _wearStats_H_included
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <stdint.h>
+
+namespace spiffsControl{
+    //wear config
+    constexpr const char *wearNamespace = "wear"; //NVS namespace of the counters
+    constexpr int wearMaxSectors = 512; //sectors with their own erase count; the spiffs partition has 352
+    constexpr uint32_t wearSaveInterval = 600000; //milli-seconds between saves to NVS, so the counters do not wear NVS
+    constexpr uint32_t wearSaveBytes = 262144; //bytes written that also trigger a save
+    constexpr uint32_t wearVersion = 1; //increment when WearTotals changes
+
+    /**
+     * @brief Lifetime counters, as kept in NVS
+     *
+     */
+    struct WearTotals{
+        uint32_t version; // wearVersion
+        uint32_t boots; // times the counters were loaded
+        uint64_t bytes_written; // bytes written to the log partition
+        uint64_t appends; // log writes timed, ring flushes or store appends
+        uint64_t append_time; // micro-seconds spent in those writes
+        uint32_t max_latency; // slowest of those writes (micro-seconds)
+        uint32_t erases; // sector erases counted
+    };
+
+    /**
+     * @brief Counts what is written to the log partition and how often each
+     * sector is erased, for the life of the flash
+     * @note - Counters are kept in RAM and saved to NVS by save(), at most once
+     * per wearSaveInterval unless wearSaveBytes were written, so a reset loses
+     * at most that much
+     * @note - Erases are only counted where the firmware does them, i.e. by the
+     * log store; SPIFFS erases inside its own garbage collection
+     * @note - Safe to update from every task that writes the log
+     */
+    class wearStats{
+    public:
+        wearStats();
+        ~wearStats();
+
+        /**
+         * @brief Loads the counters from NVS and counts a boot
+         * @note call after logSession::init(), which initializes NVS
+         *
+         * @return esp_err_t
+         */
+        esp_err_t load();
+
+        /**
+         * @brief Writes the counters to NVS if they changed and one is due
+         *
+         * @param force save even if not due, e.g. before a restart
+         * @return true if saved
+         */
+        bool save(bool force = false);
+
+        /**
+         * @brief Counts a timed write to the log
+         *
+         * @param bytes length written
+         * @param latency micro-seconds the write took
+         */
+        void addAppend(size_t bytes, uint32_t latency);
+
+        /**
+         * @brief Counts bytes written outside the timed log writes, e.g. archives
+         *
+         * @param bytes length written
+         */
+        void addBytes(size_t bytes);
+
+        /**
+         * @brief Counts a sector erase
+         *
+         * @param sector sector number in the partition
+         */
+        void addErase(uint32_t sector);
+
+        /**
+         * @brief Get the erase count of one sector
+         *
+         * @param sector sector number in the partition
+         * @return uint32_t erases counted, 0 if out of range
+         */
+        uint32_t getSectorErases(uint32_t sector);
+
+        /**
+         * @brief Get the most erases of any one sector
+         *
+         * @return uint32_t
+         */
+        uint32_t getMaxSectorErases();
+
+        inline uint64_t getBytesWritten(){
+            return totals.bytes_written;
+        }
+        inline uint64_t getAppends(){
+            return totals.appends;
+        }
+        inline uint32_t getMeanLatency(){
+            return totals.appends > 0 ? totals.append_time / totals.appends : 0;
+        }
+        inline uint32_t getMaxLatency(){
+            return totals.max_latency;
+        }
+        inline uint32_t getErases(){
+            return totals.erases;
+        }
+        inline uint32_t getBoots(){
+            return totals.boots;
+        }
+        inline uint32_t getSaves(){
+            return saves;
+        }
+
+    private:
+        WearTotals totals;
+        uint16_t sector_erases[wearMaxSectors]; //saturate at UINT16_MAX, past the rated endurance of the flash
+        bool loaded; //counters are only saved once they were loaded, so a failed load never overwrites them
+
+        //save policy
+        bool dirty; //totals changed since the last save
+        bool sectors_dirty; //sector_erases changed since the last save
+        uint64_t saved_bytes; //bytes_written at the last save
+        int64_t saved_time; //micro-seconds
+
+        //metrics
+        uint32_t saves; //saves since boot
+
+        SemaphoreHandle_t lock;
+    };
+}
+
+#endif // _wearStats_H_included
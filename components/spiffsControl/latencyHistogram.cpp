@@ -0,0 +1,47 @@
+/**
+ * @file latencyHistogram.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of latencyHistogram class
+**/
+
+#include "latencyHistogram.h"
+
+spiffsControl::latencyHistogram::latencyHistogram(){
+    clear();
+}
+
+void spiffsControl::latencyHistogram::clear(){
+    for(int i = 0; i < latencyBuckets; i++){
+        buckets[i] = 0;
+    }
+    count = 0;
+}
+
+void spiffsControl::latencyHistogram::add(uint32_t latency){
+    int bucket = 0;
+    for(uint32_t edge = latencyFirstBucket; latency >= edge && bucket < latencyBuckets - 1; edge <<= 1){
+        bucket++;
+    }
+
+    buckets[bucket]++;
+    count++;
+}
+
+uint32_t spiffsControl::latencyHistogram::percentile(int percent){
+    if(count == 0){
+        return 0;
+    }
+
+    //rank of the percentile, rounded up
+    uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+    uint64_t seen = 0;
+    int bucket = 0;
+
+    for(; bucket < latencyBuckets - 1; bucket++){
+        seen += buckets[bucket];
+        if(seen >= rank) break;
+    }
+
+    return latencyFirstBucket << bucket;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file logCompactor.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logCompactor class
+**/
+
+#include "logCompactor.h"
+#include "spiffsControl.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char* TAG = "compactor";
+
+spiffsControl::logCompactor::logCompactor(){
+    count = 0;
+    encode = NULL;
+    idle = NULL;
+    handle = NULL;
+
+    archive = NULL;
+    archive_size = 0;
+    archive_crc = 0;
+    archive_error = false;
+
+    compacted = 0;
+    bytes_saved = 0;
+    failures = 0;
+    last_latency = 0;
+    wear = NULL;
+}
+
+spiffsControl::logCompactor::~logCompactor(){
+    stop();
+}
+
+bool spiffsControl::logCompactor::add(ringBuffer *ring){
+    if(count == maxCompactedLogs){
+        ESP_LOGE(TAG, "Too many logs");
+        return false;
+    }
+
+    rings[count++] = ring;
+    return true;
+}
+
+void spiffsControl::logCompactor::start(line_encoder_t line_encoder, idle_check_t idle_check){
+    if(handle != NULL){
+        return;
+    }
+
+    encode = line_encoder;
+    idle = idle_check;
+    xTaskCreatePinnedToCore(task, "compactor", compactorStackSize, this, compactorPriority, &handle, 1);
+    ESP_LOGI(TAG, "Started: compacting %i logs", count);
+}
+
+void spiffsControl::logCompactor::stop(){
+    if(handle != NULL){
+        vTaskDelete(handle);
+        handle = NULL;
+    }
+}
+
+bool spiffsControl::logCompactor::write(const void *data, size_t size){
+    if(archive == NULL || archive_error){
+        return false;
+    }
+
+    if(fwrite(data, 1, size, archive) != size){
+        ESP_LOGE(TAG, "Failed to write archive (%s)", strerror(errno));
+        archive_error = true;
+        return false;
+    }
+
+    archive_crc = esp_rom_crc32_le(archive_crc, (const uint8_t *)data, size);
+    archive_size += size;
+    return true;
+}
+
+bool spiffsControl::logCompactor::check(const char *path, const ArchiveHeader *header){
+    ArchiveHeader stored;
+    uint8_t buffer[buffer_size];
+    uint32_t crc = 0, size = 0;
+    size_t length;
+
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return false;
+    }
+
+    bool ret = fread(&stored, 1, sizeof(stored), file) == sizeof(stored) && memcmp(&stored, header, sizeof(stored)) == 0;
+    while(ret && (length = fread(buffer, 1, sizeof(buffer), file)) > 0){
+        crc = esp_rom_crc32_le(crc, buffer, length);
+        size += length;
+    }
+    ret = ret && !ferror(file) && size == header->size && crc == header->crc;
+    fclose(file);
+
+    if(!ret){
+        ESP_LOGE(TAG, "%s failed its check", path);
+    }
+    return ret;
+}
+
+bool spiffsControl::logCompactor::compact(ringBuffer *ring, const Segment *segment, const char *path){
+    char partial[segmentPathSize], archive_path[segmentPathSize];
+    char line[buffer_size];
+    bool abandoned = false;
+
+    snprintf(partial, sizeof(partial), "%s%s", path, partialSuffix);
+    snprintf(archive_path, sizeof(archive_path), "%s%s", path, archiveSuffix);
+
+    FILE *source = fopen(path, "r");
+    if(source == NULL){
+        return false; //evicted since it was found
+    }
+
+    archive = fopen(partial, "wb");
+    if(archive == NULL){
+        ESP_LOGE(TAG, "Failed to open %s", partial);
+        fclose(source);
+        failures++;
+        return false;
+    }
+
+    //header is written again once the archive is whole
+    ArchiveHeader header = {archiveMagic, 0, 0, segment->first_time, segment->last_time, 0, 0};
+    archive_error = fwrite(&header, 1, sizeof(header), archive) != sizeof(header);
+    archive_size = 0;
+    archive_crc = 0;
+
+    while(!archive_error && fgets(line, sizeof(line), source) != NULL){
+        size_t length = strcspn(line, "\n");
+        line[length] = '\0';
+
+        header.records++;
+        if(encode(line, length)){
+            header.samples++;
+        }
+
+        //a logger started; give the flash back to it
+        if(header.records % compactorLinesPerYield == 0 && idle != NULL && !idle()){
+            abandoned = true;
+            break;
+        }
+    }
+    archive_error = ferror(source) || archive_error;
+    fclose(source);
+
+    //seals the last block, and leaves the encoder empty for the next segment
+    encode(NULL, 0);
+
+    header.size = archive_size;
+    header.crc = archive_crc;
+    archive_error = fseek(archive, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), archive) != sizeof(header)
+        || fflush(archive) != 0 || fsync(fileno(archive)) != 0 || archive_error;
+    archive_error = fclose(archive) != 0 || archive_error;
+    archive = NULL;
+    if(wear != NULL) wear->addBytes(sizeof(header) + archive_size);
+
+    if(abandoned){
+        ESP_LOGI(TAG, "%s: abandoned, the log is in use", path);
+        unlink(partial);
+        return false;
+    }
+    if(archive_error || !check(partial, &header) || rename(partial, archive_path) != 0){
+        ESP_LOGE(TAG, "%s: failed to write archive", path);
+        unlink(partial);
+        failures++;
+        return false;
+    }
+
+    //the segment is only removed once its archive is whole
+    uint32_t bytes = sizeof(header) + header.size;
+    if(!ring->compacted(segment, bytes)){
+        ESP_LOGW(TAG, "%s: changed while it was compacted", path);
+        unlink(archive_path);
+        return false;
+    }
+
+    compacted++;
+    if(segment->bytes > bytes){
+        bytes_saved += segment->bytes - bytes;
+    }
+    ESP_LOGI(TAG, "%s: %lu records, %lu samples, %lu to %lu bytes", archive_path, (unsigned long)header.records,
+        (unsigned long)header.samples, (unsigned long)segment->bytes, (unsigned long)bytes);
+    return true;
+}
+
+bool spiffsControl::logCompactor::step(){
+    char path[segmentPathSize];
+    Segment segment;
+
+    for(int i = 0; i < count; i++){
+        if(rings[i]->nextCompaction(&segment, path)){
+            int64_t start = esp_timer_get_time();
+            bool ret = compact(rings[i], &segment, path);
+
+            last_latency = esp_timer_get_time() - start;
+            return ret;
+        }
+    }
+    return false;
+}
+
+void spiffsControl::logCompactor::task(void *pvParameters){
+    logCompactor *self = (logCompactor *)pvParameters;
+    const TickType_t xDelay = compactorInterval / portTICK_PERIOD_MS;
+
+    while(1){
+        //every closed segment, one at a time, while the loggers are idle
+        while((self->idle == NULL || self->idle()) && self->step()){
+            vTaskDelay(1);
+        }
+        vTaskDelay(xDelay);
+    }
+}
@@ -0,0 +1,187 @@
+/**
+ * @file logIndex.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logIndex class
+**/
+
+#include "logIndex.h"
+
+static const char* TAG = "index";
+
+spiffsControl::logIndex::logIndex(size_t size){
+    time_source = NULL;
+    setRecordSize(size);
+}
+
+void spiffsControl::logIndex::setRecordSize(size_t size){
+    record_size = size;
+    invalidate();
+}
+
+void spiffsControl::logIndex::setTimeSource(record_time_t source){
+    time_source = source;
+    invalidate();
+}
+
+void spiffsControl::logIndex::invalidate(){
+    valid = false;
+
+    count = 0;
+    bytes = 0;
+    stride = indexStride;
+    entry_count = 0;
+}
+
+void spiffsControl::logIndex::clear(){
+    invalidate();
+    valid = true;
+}
+
+bool spiffsControl::logIndex::range(uint32_t *first_out, uint32_t *last_out){
+    bool found = false;
+
+    for(int i = 0; valid && i < entry_count; i++){
+        if(entries[i].first > entries[i].last){
+            continue; //no timestamps in the stride
+        }
+        if(!found || entries[i].first < *first_out) *first_out = entries[i].first;
+        if(!found || entries[i].last > *last_out) *last_out = entries[i].last;
+        found = true;
+    }
+
+    return found;
+}
+
+void spiffsControl::logIndex::compact(){
+    for(int i = 0; i < entry_count / 2; i++){
+        IndexEntry *a = &entries[i * 2];
+        IndexEntry *b = &entries[i * 2 + 1];
+
+        entries[i].offset = a->offset;
+        entries[i].first = a->first < b->first ? a->first : b->first;
+        entries[i].last = a->last > b->last ? a->last : b->last;
+    }
+    entry_count = (entry_count + 1) / 2;
+    stride *= 2;
+
+    ESP_LOGI(TAG, "Index full, stride now %lu records", (unsigned long)stride);
+}
+
+void spiffsControl::logIndex::mark(const void *data, size_t size, size_t available){
+    if(count % stride == 0 && entry_count == indexMaxEntries){
+        compact();
+    }
+    if(count % stride == 0){
+        entries[entry_count].offset = bytes;
+        entries[entry_count].first = UINT32_MAX;
+        entries[entry_count].last = 0;
+        entry_count++;
+    }
+
+    uint32_t first, last;
+    if(time_source != NULL && time_source(data, available, &first, &last)){
+        IndexEntry *entry = &entries[entry_count - 1];
+
+        if(first < entry->first) entry->first = first;
+        if(last > entry->last) entry->last = last;
+    }
+
+    count++;
+    bytes += size;
+}
+
+void spiffsControl::logIndex::add(const void *data, size_t size){
+    if(!valid){
+        return;
+    }
+    mark(data, size, size);
+}
+
+bool spiffsControl::logIndex::locate(uint32_t record, uint32_t *start_out, uint32_t *offset_out){
+    if(!valid || record >= count){
+        return false;
+    }
+
+    //fixed-size records are at a known offset
+    if(record_size != 0){
+        *start_out = record;
+        *offset_out = record * record_size;
+        return true;
+    }
+
+    uint32_t entry = record / stride;
+    *start_out = entry * stride;
+    *offset_out = entries[entry].offset;
+    return true;
+}
+
+bool spiffsControl::logIndex::query(uint32_t first, uint32_t last, uint32_t from, uint32_t *start_out, uint32_t *offset_out, uint32_t *end_out){
+    if(!valid || from >= count){
+        return false;
+    }
+
+    for(uint32_t entry = from / stride; entry < (uint32_t)entry_count; entry++){
+        if(entries[entry].first <= last && entries[entry].last >= first){
+            *start_out = entry * stride;
+            *offset_out = entries[entry].offset;
+            *end_out = *start_out + stride < count ? *start_out + stride : count;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool spiffsControl::logIndex::rebuild(const char *path){
+    clear();
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "%s not found, indexed as empty", path);
+        return true;
+    }
+
+    if(record_size != 0){
+        //a partial record at the end is ignored
+        uint8_t *record = new uint8_t[record_size];
+
+        while(fread(record, 1, record_size, file) == record_size){
+            mark(record, record_size, record_size);
+        }
+        delete[] record;
+    }
+    else{
+        //a line ends after a newline or at the end of the file
+        char chunk[512];
+        char line[indexLineSize];
+        size_t line_length = 0; //bytes of the current line
+        size_t length;
+
+        while((length = fread(chunk, 1, sizeof(chunk), file)) > 0){
+            for(size_t i = 0; i < length; i++){
+                if(line_length < (size_t)indexLineSize){
+                    line[line_length] = chunk[i];
+                }
+                line_length++;
+
+                if(chunk[i] == '\n'){
+                    mark(line, line_length, line_length < (size_t)indexLineSize ? line_length : indexLineSize);
+                    line_length = 0;
+                }
+            }
+        }
+        if(line_length > 0){
+            mark(line, line_length, line_length < (size_t)indexLineSize ? line_length : indexLineSize);
+        }
+    }
+
+    if(ferror(file)){
+        ESP_LOGE(TAG, "Failed to read %s", path);
+        valid = false;
+    }
+    fclose(file);
+
+    ESP_LOGI(TAG, "%s indexed: %lu records, %i entries", path, (unsigned long)count, entry_count);
+    return valid;
+}
@@ -0,0 +1,401 @@
+/**
+ * @file logReader.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logReader class
+**/
+
+#include "logReader.h"
+
+#include <string.h>
+
+static const char* TAG = "reader";
+
+//blocks are copied into the decompressor, so readers share one; readers are only used by the i2c task
+static uint8_t block[telemetryControl::blockSize]; //too large for the i2c task stack
+
+/**
+ * @brief Reads the seconds cell at the start of a .csv line
+ *
+ * @param line .csv line
+ * @param seconds_out time of the sample (seconds)
+ * @return true if the line is a sample; the header is not
+ */
+static bool lineTime(const spiffsControl::lineSpan *line, uint32_t *seconds_out){
+    uint32_t seconds = 0;
+    size_t i = 0;
+
+    while(i < line->size && line->data[i] >= '0' && line->data[i] <= '9'){
+        seconds = seconds * 10 + (line->data[i++] - '0');
+    }
+    if(i == 0 || i == line->size || line->data[i] != ','){
+        return false;
+    }
+
+    *seconds_out = seconds;
+    return true;
+}
+
+spiffsControl::logReader::logReader(logStream *log_stream, logStore *log_store){
+    stream = log_stream;
+    store = log_store;
+
+    path[0] = '\0';
+    window_first = 0;
+    window_last = UINT32_MAX;
+    restart();
+}
+
+void spiffsControl::logReader::setStream(logStream *log_stream){
+    stream = log_stream;
+    restart();
+}
+
+void spiffsControl::logReader::restart(){
+    reader.close();
+    number = 0;
+    cursor = 0;
+    reading = false;
+    archive = false;
+    archive_end = 0;
+    decoding = false;
+    stride_end = 0;
+}
+
+void spiffsControl::logReader::setWindow(uint32_t first, uint32_t last){
+    window_first = first;
+    window_last = last;
+    restart();
+}
+
+bool spiffsControl::logReader::open(uint32_t record, uint32_t *start_out){
+    uint32_t offset;
+
+    if(!stream->getRing()->locate(record, start_out, &offset, path) || !reader.open(path, offset)){
+        return false;
+    }
+    number = *start_out;
+    cursor = *start_out;
+    return openArchive();
+}
+
+bool spiffsControl::logReader::openArchive(){
+    ArchiveHeader header;
+
+    archive = logSegments::isArchive(path);
+    decoding = false;
+    if(!archive){
+        return true;
+    }
+
+    //the records before the first sample (the header) were not archived
+    if(!reader.readRecord(&header, sizeof(header)) || header.magic != archiveMagic){
+        return false;
+    }
+    archive_end = cursor + header.records;
+    cursor = archive_end - header.samples;
+    return true;
+}
+
+int spiffsControl::logReader::readLine(lineSpan *line_out){
+    if(!reader.isOpen()){
+        return -1;
+    }
+    if(!reader.readLine(line_out)){
+        reader.close();
+        return -1;
+    }
+    return number++;
+}
+
+int spiffsControl::logReader::readRecord(void *record_out, size_t size){
+    if(!reader.isOpen()){
+        return -1;
+    }
+    if(!reader.readRecord(record_out, size)){
+        reader.close();
+        return -1;
+    }
+    return number++;
+}
+
+bool spiffsControl::logReader::archiveNext(telemetryControl::Telemetry *capture){
+    while(!decoding || !decoder.next(capture)){
+        int read = readRecord(block, sizeof(block));
+        if(read == -1){
+            decoding = false;
+            return false;
+        }
+
+        decoding = decoder.load(block);
+        if(!decoding) ESP_LOGW(TAG, "Skipping corrupt archive block %i", read);
+    }
+    return true;
+}
+
+bool spiffsControl::logReader::storeNext(telemetryControl::Telemetry *capture){
+    telemetryControl::Record record;
+    size_t size;
+    uint8_t tag;
+
+    if(!reading){
+        cursor = store->getOldest();
+        reading = true;
+    }
+
+    while(cursor < store->getNext()){
+        if(cursor < store->getOldest()) cursor = store->getOldest();
+
+        esp_err_t ret = store->read(cursor++, &record, &size, &tag);
+        if(ret == ESP_OK && tag == stream->getTag() && size == sizeof(record) && capture->FromRecord(&record)){
+            return true;
+        }
+    }
+
+    reading = false;
+    return false;
+}
+
+void spiffsControl::logReader::format(telemetryControl::Telemetry *capture, lineSpan *line_out){
+    capture->ToCSV(line);
+    line_out->data = line;
+    line_out->size = strcspn(line, "\n");
+}
+
+bool spiffsControl::logReader::readNext(lineSpan *line_out){
+    ringBuffer *ring = stream->getRing();
+    size_t record_size = ring->getRecordSize();
+    telemetryControl::Telemetry capture;
+    uint32_t start;
+    int read;
+
+    if(useLogStore){
+        if(store == NULL || !storeNext(&capture)){
+            return false;
+        }
+        format(&capture, line_out);
+        return true;
+    }
+
+    if(!reading){
+        if(!open(ring->getOldest(), &start)){
+            return false;
+        }
+        reading = true;
+
+        //the header was evicted with the first segment
+        if(record_size == 0 && cursor > 0){
+            capture.headerCSV(line);
+            line_out->data = line;
+            line_out->size = strcspn(line, "\n");
+            return true;
+        }
+    }
+
+    while(1){
+        //compacted segments hold samples
+        if(archive){
+            if(archiveNext(&capture)){
+                cursor++;
+                format(&capture, line_out);
+                return true;
+            }
+            cursor = archive_end;
+        }
+        else if(record_size == 0){
+            read = readLine(line_out);
+            if(read != -1){
+                cursor = read + 1;
+                return true;
+            }
+        }
+        else if(record_size == telemetryControl::sizeRecord){
+            telemetryControl::Record record;
+
+            while((read = readRecord(&record, sizeof(record))) != -1){
+                cursor = read + 1;
+                if(capture.FromRecord(&record)){
+                    format(&capture, line_out);
+                    return true;
+                }
+            }
+        }
+        else{
+            if(decoding && decoder.next(&capture)){
+                format(&capture, line_out);
+                return true;
+            }
+            decoding = false;
+
+            read = readRecord(block, sizeof(block));
+            if(read != -1){
+                cursor = read + 1;
+                decoding = decoder.load(block);
+                if(!decoding) ESP_LOGW(TAG, "Skipping corrupt log block %i", read);
+                continue;
+            }
+        }
+
+        //end of a segment, or the segment was evicted or compacted while being read
+        uint32_t next = cursor < ring->getOldest() ? ring->getOldest() : cursor;
+        if(!open(next, &start) || (!archive && start != next)){
+            break;
+        }
+
+        //samples of a segment compacted while it was read are not read again
+        telemetryControl::Telemetry skipped;
+        while(archive && cursor < next && archiveNext(&skipped)){
+            cursor++;
+        }
+    }
+
+    restart();
+    return false;
+}
+
+bool spiffsControl::logReader::seek(uint32_t record){
+    size_t record_size = stream->getRing()->getRecordSize();
+    uint32_t start;
+    bool found;
+
+    if(useLogStore){
+        found = store != NULL && record < store->getNext() - store->getOldest();
+        if(found){
+            cursor = store->getOldest() + record;
+            reading = true;
+        }
+        return found;
+    }
+
+    if(record_size != 0 && record_size != telemetryControl::sizeRecord){
+        return false;
+    }
+
+    //walk forward from the indexed record, at most one index stride or segment
+    found = open(record, &start);
+    if(archive){
+        telemetryControl::Telemetry capture;
+        while(found && cursor < record){
+            found = archiveNext(&capture);
+            cursor++;
+        }
+        record = cursor;
+    }
+    else if(record_size != 0){
+        telemetryControl::Record skipped;
+        while(found && start++ < record){
+            found = readRecord(&skipped, sizeof(skipped)) != -1;
+        }
+    }
+    else{
+        lineSpan skipped;
+        while(found && start++ < record){
+            found = readLine(&skipped) != -1;
+        }
+    }
+
+    //readNext() carries on from the record
+    cursor = record;
+    reading = found;
+    if(!found) restart();
+    return found;
+}
+
+bool spiffsControl::logReader::readRange(lineSpan *line_out){
+    ringBuffer *ring = stream->getRing();
+    size_t record_size = ring->getRecordSize();
+    telemetryControl::Telemetry capture;
+    bool found = false;
+    bool decoded = false; //if true, the sample was decoded from a block
+
+    //no log index in the log store; check every record
+    if(useLogStore){
+        while(!found && store != NULL && storeNext(&capture)){
+            found = capture.Seconds >= window_first && capture.Seconds <= window_last;
+        }
+        if(!found){
+            restart();
+            return false;
+        }
+        format(&capture, line_out);
+        return true;
+    }
+
+    while(!found){
+        //samples left in the last block read
+        while(!found && decoding && decoder.next(&capture)){
+            found = capture.Seconds >= window_first && capture.Seconds <= window_last;
+            decoded = found;
+        }
+        if(found) break;
+        decoding = false;
+
+        //move to the next index stride that overlaps the window
+        if(!reading || cursor >= stride_end){
+            uint32_t start, offset;
+            ArchiveHeader header;
+
+            if(!ring->query(window_first, window_last, cursor, &start, &offset, &stride_end, path) || !reader.open(path, offset)){
+                break;
+            }
+            number = start;
+            archive = logSegments::isArchive(path);
+            if(archive && (!reader.readRecord(&header, sizeof(header)) || header.magic != archiveMagic)){
+                break;
+            }
+            reading = true;
+        }
+
+        //read the next record of the stride
+        int read;
+        if(archive){
+            //the whole archive is one stride
+            if(readRecord(block, sizeof(block)) == -1){
+                cursor = stride_end;
+                archive = false;
+            }
+            else{
+                decoding = decoder.load(block);
+            }
+            continue;
+        }
+        else if(record_size == 0){
+            uint32_t seconds;
+
+            read = readLine(line_out);
+            if(read >= (int)cursor){
+                found = lineTime(line_out, &seconds) && seconds >= window_first && seconds <= window_last;
+            }
+        }
+        else if(record_size == telemetryControl::sizeRecord){
+            telemetryControl::Record record;
+
+            read = readRecord(&record, sizeof(record));
+            if(read >= (int)cursor){
+                found = capture.FromRecord(&record) && capture.Seconds >= window_first && capture.Seconds <= window_last;
+            }
+        }
+        else{
+            read = readRecord(block, sizeof(block));
+            if(read >= (int)cursor){
+                decoding = decoder.load(block);
+            }
+        }
+
+        if(read == -1) break;
+        if(read >= (int)cursor) cursor = read + 1;
+    }
+
+    if(!found){
+        restart();
+        return false;
+    }
+
+    //.csv lines are returned as read
+    if(record_size == 0 && !decoded){
+        return true;
+    }
+
+    format(&capture, line_out);
+    return true;
+}
@@ -0,0 +1,471 @@
+/**
+ * @file logSegments.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logSegments class
+**/
+
+#include "logSegments.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char* TAG = "segments";
+
+spiffsControl::logSegments *spiffsControl::logSegments::logs[maxLogs];
+int spiffsControl::logSegments::log_count = 0;
+
+spiffsControl::logSegments::logSegments(const char *name) : name{name}{
+    //split "/spiffs/exp_log.csv" into directory, stem and extension
+    const char *file_name = strrchr(name, '/');
+    file_name = file_name != NULL ? file_name + 1 : name;
+
+    extension = strrchr(file_name, '.');
+    if(extension == NULL) extension = file_name + strlen(file_name);
+
+    snprintf(dir, sizeof(dir), "%.*s", file_name > name ? (int)(file_name - name - 1) : 0, name);
+    snprintf(stem, sizeof(stem), "%.*s", (int)(extension - file_name), file_name);
+
+    count = 1;
+    segments[0] = {0, 0, 0, 0, UINT32_MAX, false};
+    budget = 0;
+    holding = false;
+    evicted = 0;
+    compactions = 0;
+    activate();
+
+    //logs are constructed before any task runs
+    if(log_count < maxLogs){
+        logs[log_count++] = this;
+    }
+    else{
+        ESP_LOGE(TAG, "%s: more than %i logs, not given a share of the partition", name, maxLogs);
+    }
+}
+
+bool spiffsControl::logSegments::parse(const char *file_name, uint32_t *first_out, const char **suffix_out){
+    size_t stem_length = strlen(stem);
+
+    if(file_name[0] == '/') file_name++;
+    if(strncmp(file_name, stem, stem_length) != 0 || file_name[stem_length] != '.'){
+        return false;
+    }
+
+    //8 hex digits, the extension, then the suffix of an archive
+    const char *number = file_name + stem_length + 1;
+    char *end;
+    unsigned long first = strtoul(number, &end, 16);
+    size_t extension_length = strlen(extension);
+
+    if(end - number != 8 || strncmp(end, extension, extension_length) != 0){
+        return false;
+    }
+
+    const char *suffix = end + extension_length;
+    if(suffix[0] != '\0' && strcmp(suffix, archiveSuffix) != 0 && strcmp(suffix, partialSuffix) != 0){
+        return false;
+    }
+
+    *first_out = first;
+    *suffix_out = suffix;
+    return true;
+}
+
+void spiffsControl::logSegments::getPath(int segment, char *path_out){
+    snprintf(path_out, segmentPathSize, "%s/%s.%08lx%s%s", dir, stem, (unsigned long)segments[segment].first_record, extension,
+        segments[segment].compacted ? archiveSuffix : "");
+}
+
+bool spiffsControl::logSegments::isArchive(const char *path){
+    size_t length = strlen(path), suffix_length = strlen(archiveSuffix);
+    return length > suffix_length && strcmp(path + length - suffix_length, archiveSuffix) == 0;
+}
+
+void spiffsControl::logSegments::activate(){
+    getPath(count - 1, active_path);
+}
+
+void spiffsControl::logSegments::scan(){
+    char path[segmentPathSize];
+    struct stat st;
+
+    count = 0;
+
+    DIR *directory = opendir(dir);
+    if (directory == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", dir);
+    }
+
+    struct dirent *entry;
+    while(directory != NULL && (entry = readdir(directory)) != NULL){
+        uint32_t first;
+        const char *suffix;
+        if(!parse(entry->d_name, &first, &suffix)){
+            continue;
+        }
+        bool archive = strcmp(suffix, archiveSuffix) == 0;
+
+        //compaction was cut short before the archive was whole; it starts over
+        if(strcmp(suffix, partialSuffix) == 0){
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+            ESP_LOGW(TAG, "%s: removed partial archive %s", name, path);
+            continue;
+        }
+
+        //keep the table sorted, oldest first
+        int i = count;
+        while(i > 0 && segments[i - 1].first_record > first){
+            i--;
+        }
+
+        //compaction was cut short after the archive was whole; only the archive is kept
+        if(i > 0 && segments[i - 1].first_record == first){
+            Segment *segment = &segments[i - 1];
+
+            segment->compacted = false;
+            getPath(i - 1, path);
+            unlink(path);
+            segment->compacted = true;
+            ESP_LOGW(TAG, "%s: removed compacted segment %s", name, path);
+            continue;
+        }
+
+        //too many to keep track of; the oldest is removed, as evict() would
+        if(count == maxSegments){
+            ESP_LOGW(TAG, "%s: more than %i segments", name, maxSegments);
+            if(i == 0){
+                snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+                unlink(path);
+                continue;
+            }
+            remove(0);
+            i--;
+        }
+
+        memmove(&segments[i + 1], &segments[i], (count - i) * sizeof(Segment));
+        segments[i] = {first, 0, 0, 0, UINT32_MAX, archive};
+        count++;
+    }
+    if(directory != NULL){
+        closedir(directory);
+    }
+
+    //a log written before segments were used becomes segment 0
+    if(stat(name, &st) == 0){
+        if(count == 0){
+            segments[0] = {0, 0, 0, 0, UINT32_MAX, false};
+            getPath(0, path);
+
+            if(rename(name, path) == 0){
+                count = 1;
+                ESP_LOGI(TAG, "%s moved to %s", name, path);
+            }
+            else{
+                ESP_LOGE(TAG, "Failed to move %s to %s", name, path);
+            }
+        }
+        else{
+            ESP_LOGW(TAG, "%s ignored, log already has segments", name);
+        }
+    }
+
+    if(count == 0){
+        segments[0] = {0, 0, 0, 0, UINT32_MAX, false};
+        count = 1;
+    }
+
+    for(int i = 0; i < count; i++){
+        getPath(i, path);
+        if(stat(path, &st) == 0){
+            segments[i].bytes = st.st_size;
+            segments[i].modified = st.st_mtime;
+        }
+    }
+
+    //closed segments keep their timestamps in the times file, archives in their header
+    loadTimes();
+    for(int i = 0; i < count; i++){
+        ArchiveHeader header;
+        if(segments[i].compacted && readHeader(i, &header)){
+            segments[i].first_time = header.first_time;
+            segments[i].last_time = header.last_time;
+        }
+    }
+
+    //the segment after the newest archive was never written; it is the active one
+    if(segments[count - 1].compacted){
+        ArchiveHeader header;
+        uint32_t next = segments[count - 1].first_record;
+
+        if(readHeader(count - 1, &header)){
+            next += header.records;
+            if(count == maxSegments) remove(0);
+        }
+        else{
+            ESP_LOGE(TAG, "%s: newest archive is unreadable", name);
+            remove(count - 1);
+        }
+
+        segments[count] = {next, 0, 0, 0, UINT32_MAX, false};
+        count++;
+    }
+    activate();
+
+    holding = getBytes() > 0;
+    ESP_LOGI(TAG, "%s: %i segments, %lu bytes, records from %lu", name, count, (unsigned long)getBytes(), (unsigned long)getOldest());
+}
+
+void spiffsControl::logSegments::clear(){
+    char path[segmentPathSize];
+
+    for(int i = 0; i < count; i++){
+        getPath(i, path);
+        if(unlink(path) != 0 && errno != ENOENT){
+            ESP_LOGE(TAG, "Failed to remove %s (%s)", path, strerror(errno));
+        }
+    }
+
+    getTimesPath(path);
+    if(unlink(path) != 0 && errno != ENOENT){
+        ESP_LOGE(TAG, "Failed to remove %s (%s)", path, strerror(errno));
+    }
+
+    count = 1;
+    segments[0] = {0, 0, 0, 0, UINT32_MAX, false};
+    holding = false;
+    activate();
+
+    ESP_LOGI(TAG, "%s - Segments cleared", name);
+}
+
+void spiffsControl::logSegments::add(size_t size){
+    segments[count - 1].bytes += size;
+    if(size > 0) holding = true;
+}
+
+bool spiffsControl::logSegments::roll(uint32_t records, uint32_t first_time, uint32_t last_time){
+    Segment *active = &segments[count - 1];
+
+    active->first_time = first_time;
+    active->last_time = last_time;
+    active->modified = time(NULL);
+
+    if(records == 0){
+        return false; //nothing to close
+    }
+    uint32_t next = active->first_record + records;
+    saveTimes(active);
+
+    if(count == maxSegments){
+        remove(0);
+    }
+
+    segments[count] = {next, 0, 0, 0, UINT32_MAX, false};
+    count++;
+    activate();
+
+    ESP_LOGI(TAG, "%s started", active_path);
+    return true;
+}
+
+void spiffsControl::logSegments::remove(int segment){
+    char path[segmentPathSize];
+    getPath(segment, path);
+
+    //dropped from the table even if it could not be removed, so eviction can't wedge
+    if(unlink(path) != 0 && errno != ENOENT){
+        ESP_LOGE(TAG, "Failed to remove %s (%s)", path, strerror(errno));
+    }
+
+    memmove(&segments[segment], &segments[segment + 1], (count - segment - 1) * sizeof(Segment));
+    count--;
+    evicted++;
+}
+
+uint32_t spiffsControl::logSegments::share(size_t total){
+    uint32_t shared = total / partitionBudgetParts * partitionBudgetShare;
+    int sharing = 0;
+
+    //only written by their own log; a stale value only moves the share until the next evict()
+    for(int i = 0; i < log_count; i++){
+        if(logs[i]->budget != 0){
+            shared -= logs[i]->budget < shared ? logs[i]->budget : shared;
+        }
+        else if(logs[i]->holding || logs[i] == this){
+            sharing++;
+        }
+    }
+
+    return shared / (sharing > 0 ? sharing : 1);
+}
+
+int spiffsControl::logSegments::evict(uint32_t max_bytes, uint32_t max_age){
+    size_t total = 0, used = 0;
+    bool info = esp_spiffs_info(NULL, &total, &used) == ESP_OK;
+
+    if(max_bytes == 0){
+        max_bytes = info ? share(total) : UINT32_MAX;
+    }
+
+    uint32_t bytes = getBytes();
+    uint32_t free_bytes = info && used < total ? total - used : UINT32_MAX; //unknown; not evicted for space
+    time_t now = time(NULL);
+    int removed = 0;
+
+    while(count > 1){
+        const Segment *oldest = &segments[0];
+        const char *reason;
+
+        if(bytes > max_bytes){
+            reason = "over budget";
+        }
+        else if(max_age > 0 && oldest->modified > 0 && now - oldest->modified > (time_t)max_age){
+            reason = "expired";
+        }
+        else if(free_bytes < segmentFreeReserve){
+            reason = "partition full";
+        }
+        else{
+            break;
+        }
+
+        ESP_LOGI(TAG, "%s: evicting records %lu to %lu (%s)", name, (unsigned long)oldest->first_record,
+            (unsigned long)segments[1].first_record - 1, reason);
+
+        bytes -= oldest->bytes;
+        free_bytes += oldest->bytes;
+        remove(0);
+        removed++;
+    }
+
+    return removed;
+}
+
+bool spiffsControl::logSegments::evictOldest(){
+    if(count <= 1){
+        return false;
+    }
+
+    ESP_LOGW(TAG, "%s: evicting records %lu to %lu", name, (unsigned long)segments[0].first_record,
+        (unsigned long)segments[1].first_record - 1);
+    remove(0);
+    return true;
+}
+
+bool spiffsControl::logSegments::readHeader(int segment, ArchiveHeader *header_out){
+    char path[segmentPathSize];
+    getPath(segment, path);
+
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){
+        return false;
+    }
+
+    bool ret = fread(header_out, 1, sizeof(ArchiveHeader), file) == sizeof(ArchiveHeader) && header_out->magic == archiveMagic;
+    fclose(file);
+
+    return ret;
+}
+
+void spiffsControl::logSegments::getTimesPath(char *path_out){
+    snprintf(path_out, segmentPathSize, "%s%s", name, timesSuffix);
+}
+
+void spiffsControl::logSegments::saveTimes(const Segment *segment){
+    char path[segmentPathSize];
+    SegmentTimes times = {segment->first_record, segment->first_time, segment->last_time};
+
+    getTimesPath(path);
+    FILE *file = fopen(path, "ab");
+    if(file == NULL || fwrite(&times, 1, sizeof(times), file) != sizeof(times)){
+        ESP_LOGE(TAG, "Failed to write %s", path);
+    }
+    if(file != NULL){
+        fclose(file);
+    }
+}
+
+void spiffsControl::logSegments::loadTimes(){
+    char path[segmentPathSize];
+    SegmentTimes times;
+
+    getTimesPath(path);
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){
+        return; //no segment closed yet
+    }
+
+    //a range cut short by a reset is ignored
+    while(fread(&times, 1, sizeof(times), file) == sizeof(times)){
+        int segment = find(times.first_record);
+        if(segment >= 0 && segment < count - 1 && segments[segment].first_record == times.first_record){
+            segments[segment].first_time = times.first_time;
+            segments[segment].last_time = times.last_time;
+        }
+    }
+    fclose(file);
+
+    //ranges of evicted segments are dropped, so the file stays at most maxSegments ranges
+    unlink(path);
+    for(int i = 0; i < count - 1; i++){
+        if(segments[i].first_time != 0 || segments[i].last_time != UINT32_MAX){
+            saveTimes(&segments[i]);
+        }
+    }
+}
+
+bool spiffsControl::logSegments::compact(uint32_t first_record, uint32_t bytes){
+    char path[segmentPathSize];
+    int segment = find(first_record);
+
+    if(segment < 0 || segment == count - 1 || segments[segment].first_record != first_record || segments[segment].compacted){
+        return false;
+    }
+
+    getPath(segment, path);
+    if(unlink(path) != 0){
+        ESP_LOGE(TAG, "Failed to remove %s (%s)", path, strerror(errno));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "%s: compacted %lu to %lu bytes", name, (unsigned long)segments[segment].bytes, (unsigned long)bytes);
+    segments[segment].compacted = true;
+    segments[segment].bytes = bytes;
+    compactions++;
+    return true;
+}
+
+int spiffsControl::logSegments::findUncompacted(){
+    for(int i = 0; i < count - 1; i++){
+        if(!segments[i].compacted){
+            return i;
+        }
+    }
+    return -1;
+}
+
+int spiffsControl::logSegments::find(uint32_t record){
+    if(record < segments[0].first_record){
+        return -1;
+    }
+
+    int segment = count - 1;
+    while(segments[segment].first_record > record){
+        segment--;
+    }
+    return segment;
+}
+
+uint32_t spiffsControl::logSegments::getBytes(){
+    uint32_t bytes = 0;
+
+    for(int i = 0; i < count; i++){
+        bytes += segments[i].bytes;
+    }
+    return bytes;
+}
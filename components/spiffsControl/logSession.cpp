@@ -0,0 +1,195 @@
+/**
+ * @file logSession.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logSession class
+**/
+
+#include "logSession.h"
+#include "spiffsControl.h"
+
+static const char* TAG = "session";
+
+spiffsControl::logSession::logSession(){
+    id = 0;
+    key[0] = '\0';
+
+    file_path[0] = '\0';
+    file = NULL;
+    positioned = false;
+    position = 0;
+    offset = 0;
+
+    watermark = 0;
+}
+
+spiffsControl::logSession::~logSession(){
+    close();
+}
+
+esp_err_t spiffsControl::logSession::init(){
+    esp_err_t ret = nvs_flash_init();
+
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "NVS partition unusable (%s), erasing", esp_err_to_name(ret));
+        nvs_flash_erase();
+        ret = nvs_flash_init();
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize NVS (%s)", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t spiffsControl::logSession::load(uint8_t session_id, uint8_t stream){
+    nvs_handle_t handle;
+
+    id = session_id;
+    //the first stream keeps the keys from before there were streams
+    if (stream == 0) {
+        snprintf(key, sizeof(key), "wm%u", (unsigned)id);
+    }
+    else {
+        snprintf(key, sizeof(key), "wm%u.%u", (unsigned)id, (unsigned)stream);
+    }
+    watermark = 0;
+
+    esp_err_t ret = nvs_open(sessionNamespace, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_u32(handle, key, &watermark);
+        nvs_close(handle);
+    }
+
+    //no watermark yet; start from the first record
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_OK;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read watermark %u (%s)", (unsigned)id, esp_err_to_name(ret));
+    }
+
+    rewind();
+    ESP_LOGI(TAG, "Session %u watermark %lu", (unsigned)id, (unsigned long)watermark);
+    return ret;
+}
+
+bool spiffsControl::logSession::open(){
+    file = fopen(file_path, "rb");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", file_path);
+        return false;
+    }
+
+    if (fseek(file, offset, SEEK_SET) != 0) {
+        ESP_LOGE(TAG, "Failed to seek to %lu", (unsigned long)offset);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void spiffsControl::logSession::close(){
+    if(file != NULL){
+        fclose(file);
+        file = NULL;
+    }
+}
+
+bool spiffsControl::logSession::seek(const char *path, uint32_t record, uint32_t record_offset){
+    close();
+
+    snprintf(file_path, sizeof(file_path), "%s", path);
+    offset = record_offset;
+    position = record;
+    positioned = open();
+
+    return positioned;
+}
+
+int spiffsControl::logSession::readLine(lineSpan *line_out){
+    if(!positioned || (file == NULL && !open())){
+        return -1;
+    }
+
+    if(fgets(line, sizeof(line), file) == NULL){
+        close();
+        return -1;
+    }
+
+    size_t length = strlen(line);
+    size_t consumed = length;
+    line_out->data = line;
+    line_out->size = length - 1;
+
+    //a line longer than the buffer is returned cut short; the rest of it is skipped
+    if(line[length - 1] != '\n'){
+        int c;
+        while((c = fgetc(file)) != EOF && c != '\n'){
+            consumed++;
+        }
+
+        //only whole lines; the rest of the file is read again next time
+        if(c == EOF){
+            close();
+            return -1;
+        }
+
+        ESP_LOGW(TAG, "Line %lu longer than %u bytes, cut short", (unsigned long)position, (unsigned)sizeof(line) - 1);
+        consumed++;
+        line_out->size = length;
+    }
+
+    offset += consumed;
+    return position++;
+}
+
+int spiffsControl::logSession::readRecord(void *record_out, size_t size){
+    if(!positioned || (file == NULL && !open())){
+        return -1;
+    }
+
+    //only whole records; the rest of the file is read again next time
+    if(fread(record_out, 1, size, file) != size){
+        close();
+        return -1;
+    }
+
+    offset += size;
+    return position++;
+}
+
+esp_err_t spiffsControl::logSession::commit(uint32_t record){
+    nvs_handle_t handle;
+
+    esp_err_t ret = nvs_open(sessionNamespace, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_u32(handle, key, record);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write watermark %u (%s)", (unsigned)id, esp_err_to_name(ret));
+        return ret;
+    }
+
+    watermark = record;
+    ESP_LOGI(TAG, "Session %u acknowledged %lu records", (unsigned)id, (unsigned long)watermark);
+    return ESP_OK;
+}
+
+void spiffsControl::logSession::rewind(){
+    close();
+    positioned = false;
+    position = watermark;
+}
+
+esp_err_t spiffsControl::logSession::reset(){
+    esp_err_t ret = commit(0);
+    watermark = 0; //even if it could not be written
+    rewind();
+    return ret;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file logStream.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logStream class
+**/
+
+#include "logStream.h"
+
+static const char* TAG = "stream";
+
+spiffsControl::logStream::logStream(uint8_t stream_tag, logSegments *log, size_t record_size) : tag{stream_tag}, ring{log, record_size}{
+    interval = 0;
+    last = 0;
+
+    admitted = 0;
+    limited = 0;
+}
+
+void spiffsControl::logStream::setInterval(uint32_t min_interval){
+    interval = (int64_t)min_interval * 1000;
+    ESP_LOGI(TAG, "Stream 0x%02X limited to one sample per %lu ms", tag, (unsigned long)min_interval);
+}
+
+bool spiffsControl::logStream::admit(){
+    int64_t now = esp_timer_get_time();
+
+    if(interval > 0 && last != 0 && now - last < interval){
+        limited++;
+        return false;
+    }
+
+    last = now;
+    admitted++;
+    return true;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file logWriter.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of logWriter class
+**/
+
+#include "logWriter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char* TAG = "writer";
+
+spiffsControl::logWriter::logWriter(const char *path) : file_path{path}{
+    fd = -1;
+
+    last_sync = 0;
+    bytes_written = 0;
+    errors = 0;
+    last_error = 0;
+
+    setSyncInterval(defaultSyncInterval);
+}
+
+spiffsControl::logWriter::~logWriter(){
+    close();
+}
+
+void spiffsControl::logWriter::setSyncInterval(uint32_t interval){
+    sync_interval = (int64_t)interval * 1000;
+}
+
+void spiffsControl::logWriter::fail(const char *operation){
+    errors++;
+    last_error = errno;
+    ESP_LOGE(TAG, "%s: %s failed (%s)", file_path, operation, strerror(last_error));
+
+    //drop the handle; the next write reopens the file
+    if(fd >= 0){
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool spiffsControl::logWriter::open(){
+    fd = ::open(file_path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd < 0) {
+        fail("open");
+        return false;
+    }
+
+    last_sync = esp_timer_get_time();
+
+    ESP_LOGI(TAG, "%s opened", file_path);
+    return true;
+}
+
+size_t spiffsControl::logWriter::write(const void *data, size_t size){
+    if(fd < 0 && !open()){
+        return 0;
+    }
+
+    //unbuffered; the group the ring hands over is one write to the file system
+    size_t written = 0;
+    while(written < size){
+        ssize_t ret = ::write(fd, (const uint8_t *)data + written, size - written);
+        if(ret <= 0){
+            if(ret == 0) errno = ENOSPC; //no progress; SPIFFS only returns short when full
+            bytes_written += written;
+            fail("write");
+            return written;
+        }
+        written += ret;
+    }
+    bytes_written += written;
+
+    if(esp_timer_get_time() - last_sync >= sync_interval){
+        sync();
+    }
+
+    return written;
+}
+
+bool spiffsControl::logWriter::sync(){
+    if(fd < 0){
+        return true; //nothing written since the last sync
+    }
+
+    if(fsync(fd) != 0){
+        fail("fsync");
+        return false;
+    }
+
+    last_sync = esp_timer_get_time();
+    return true;
+}
+
+void spiffsControl::logWriter::close(){
+    if(fd < 0){
+        return;
+    }
+
+    sync();
+
+    if(fd >= 0 && ::close(fd) != 0){
+        fd = -1;
+        fail("close");
+        return;
+    }
+
+    fd = -1;
+    ESP_LOGI(TAG, "%s closed", file_path);
+}
+
+void spiffsControl::logWriter::setPath(const char *path){
+    if(path != file_path){
+        close();
+        file_path = path;
+    }
+}
@@ -0,0 +1,385 @@
+/**
+ * @file ringBuffer.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of ringBuffer class
+**/
+
+#include "ringBuffer.h"
+
+#include <errno.h>
+#include <string.h>
+
+static const char* TAG = "ring";
+
+spiffsControl::ringBuffer::ringBuffer(logSegments *log, size_t record_size) : segments{log}, writer{log->getActivePath()}, index{record_size}{
+    buffer = new uint8_t[ringSize];
+    head = 0;
+    used = 0;
+    records = 0;
+    oldest = 0;
+
+    peak_used = 0;
+    flush_count = 0;
+    last_flush_latency = 0;
+    max_flush_latency = 0;
+    dropped = 0;
+    wear = NULL;
+
+    writer_task = NULL;
+    foreground_flushes = 0;
+
+    setPolicy(defaultFlushRecords, defaultFlushAge, defaultFlushPages);
+    setRetention(defaultRetentionBytes, defaultRetentionAge);
+
+    lock = xSemaphoreCreateMutex();
+}
+
+spiffsControl::ringBuffer::~ringBuffer(){
+    flush();
+
+    vSemaphoreDelete(lock);
+    delete[] buffer;
+}
+
+void spiffsControl::ringBuffer::setPolicy(int max_records, uint32_t max_age, int page_count){
+    flush_records = max_records;
+    flush_age = (int64_t)max_age * 1000;
+    flush_bytes = page_count * flashPageSize;
+
+    if(flush_bytes > ringSize) flush_bytes = ringSize;
+    ESP_LOGI(TAG, "Flush policy: %i records, %lu ms, %i bytes", flush_records, (unsigned long)max_age, flush_bytes);
+}
+
+void spiffsControl::ringBuffer::setRetention(uint32_t max_bytes, uint32_t max_age){
+    retention_bytes = max_bytes;
+    retention_age = max_age;
+    segments->setBudget(max_bytes);
+    ESP_LOGI(TAG, "Retention policy: %lu bytes, %lu s", (unsigned long)max_bytes, (unsigned long)max_age);
+}
+
+void spiffsControl::ringBuffer::setLog(logSegments *log, size_t record_size){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if(log != segments){
+        write(used);
+        segments = log;
+        segments->setBudget(retention_bytes);
+        writer.setPath(segments->getActivePath());
+        index.setRecordSize(record_size);
+    }
+    xSemaphoreGive(lock);
+}
+
+void spiffsControl::ringBuffer::defer(TaskHandle_t task){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    writer_task = task;
+    xSemaphoreGive(lock);
+}
+
+int spiffsControl::ringBuffer::due(){
+    if(flush_records > 0 && records >= flush_records){
+        return used;
+    }
+    if(flush_age > 0 && oldest != 0 && esp_timer_get_time() - oldest >= flush_age){
+        return used;
+    }
+    if(flush_bytes > 0 && used >= flush_bytes){
+        //end the write on a page boundary of the file, not of the group; an
+        //earlier partial-page flush left the file mid-page
+        uint32_t end = segments->getActive()->bytes; //file offset after the last buffered byte
+        return used - end % flashPageSize;
+    }
+    return 0;
+}
+
+bool spiffsControl::ringBuffer::write(int length){
+    if(length == 0){
+        return true;
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    //oldest byte; the group may wrap around the end of the ring
+    int tail = (head + ringSize - used) % ringSize;
+    int first = length < ringSize - tail ? length : ringSize - tail;
+
+    size_t written = writer.write(buffer + tail, first);
+    if(written == (size_t)first && first < length){
+        written += writer.write(buffer, length - first);
+    }
+
+    //partition full; make room for the next attempt
+    if(written != (size_t)length && writer.getLastError() == ENOSPC){
+        segments->evictOldest();
+    }
+
+    if(written == 0){
+        //nothing reached the file; keep the records for the next attempt
+        return false;
+    }
+    if(written != (size_t)length){
+        ESP_LOGE(TAG, "Failed to write %i bytes (%i written)", length, (int)written);
+        index.invalidate(); //records were lost
+    }
+
+    //the whole group leaves the ring, even if partially written, so a bad file can't wedge the logger
+    used -= length;
+    records = 0;
+    oldest = used > 0 ? esp_timer_get_time() : 0;
+
+    last_flush_latency = esp_timer_get_time() - start;
+    if(last_flush_latency > max_flush_latency) max_flush_latency = last_flush_latency;
+    latency.add(last_flush_latency);
+    if(wear != NULL) wear->addAppend(written, last_flush_latency);
+    flush_count++;
+
+    ESP_LOGD(TAG, "Flushed %i bytes in %lu us, %i buffered", length, (unsigned long)last_flush_latency, used);
+    return written == (size_t)length;
+}
+
+void spiffsControl::ringBuffer::roll(){
+    prepareIndex();
+
+    //only at a record boundary, with the records of the segment counted
+    if(used > 0 || !index.isValid()){
+        return;
+    }
+
+    uint32_t first = UINT32_MAX, last = 0;
+    index.range(&first, &last);
+
+    //the writer reopens the active path once it holds the new segment
+    writer.close();
+    if(segments->roll(index.getCount(), first, last)){
+        writer.setPath(segments->getActivePath());
+        index.clear();
+    }
+
+    segments->evict(retention_bytes, retention_age);
+}
+
+bool spiffsControl::ringBuffer::append(const void *data, size_t size){
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    //start a new segment before the record, so records do not span segments
+    if(segments->getActive()->bytes >= segmentSize && writer_task == NULL){
+        roll();
+    }
+
+    //make room
+    if(used + size > (size_t)ringSize){
+        if(writer_task != NULL) foreground_flushes++;
+        write(used);
+    }
+
+    if(used + size > (size_t)ringSize){
+        dropped++;
+        xSemaphoreGive(lock);
+        ESP_LOGE(TAG, "Ring full, record dropped");
+        return false;
+    }
+
+    //copy record, wrapping around the end of the ring
+    int first = size < (size_t)(ringSize - head) ? size : ringSize - head;
+    memcpy(buffer + head, data, first);
+    memcpy(buffer, (const uint8_t *)data + first, size - first);
+
+    head = (head + size) % ringSize;
+    used += size;
+    records++;
+    index.add(data, size);
+    segments->add(size);
+
+    if(oldest == 0) oldest = esp_timer_get_time();
+    if(used > peak_used) peak_used = used;
+
+    //flush policies
+    int length = due();
+    if(writer_task != NULL){
+        if(length > 0 || segments->getActive()->bytes >= segmentSize) xTaskNotifyGive(writer_task);
+    }
+    else if(length > 0){
+        write(length);
+    }
+
+    xSemaphoreGive(lock);
+    return true;
+}
+
+void spiffsControl::ringBuffer::service(){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if(segments->getActive()->bytes >= segmentSize){
+        roll();
+    }
+
+    int length = due();
+    if(length > 0){
+        write(length);
+    }
+    xSemaphoreGive(lock);
+}
+
+bool spiffsControl::ringBuffer::flush(){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ret = write(used);
+    ret = writer.sync() && ret;
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+void spiffsControl::ringBuffer::close(){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    write(used);
+    writer.close();
+    index.invalidate(); //the file may be changed before it is reopened
+    xSemaphoreGive(lock);
+}
+
+void spiffsControl::ringBuffer::clear(){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    head = 0;
+    used = 0;
+    records = 0;
+    oldest = 0;
+
+    writer.close();
+    segments->clear();
+    index.invalidate(); //a header may be added by another handle
+    xSemaphoreGive(lock);
+}
+
+void spiffsControl::ringBuffer::seal(){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    roll();
+    xSemaphoreGive(lock);
+}
+
+bool spiffsControl::ringBuffer::nextCompaction(Segment *segment_out, char *path_out){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int segment = index.getRecordSize() == 0 ? segments->findUncompacted() : -1;
+
+    if(segment >= 0){
+        *segment_out = *segments->get(segment);
+        segments->getPath(segment, path_out);
+    }
+    xSemaphoreGive(lock);
+
+    return segment >= 0;
+}
+
+bool spiffsControl::ringBuffer::compacted(const Segment *segment, uint32_t bytes){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int current = segments->find(segment->first_record);
+
+    //the same segment; after a clear() another segment may start at the same record
+    bool ret = current >= 0 && segments->get(current)->first_record == segment->first_record
+        && segments->get(current)->bytes == segment->bytes && segments->get(current)->modified == segment->modified
+        && segments->compact(segment->first_record, bytes);
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+void spiffsControl::ringBuffer::prepareIndex(){
+    write(used);
+    writer.sync();
+
+    if(!index.isValid()){
+        index.rebuild(writer.getPath());
+    }
+}
+
+bool spiffsControl::ringBuffer::locate(uint32_t record, uint32_t *start_out, uint32_t *offset_out, char *path_out){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    prepareIndex();
+
+    bool ret = false;
+    int segment = segments->find(record);
+    uint32_t base = segment >= 0 ? segments->get(segment)->first_record : 0;
+
+    if(segment == segments->getCount() - 1){
+        ret = index.locate(record - base, start_out, offset_out);
+        if(ret) *start_out += base;
+    }
+    else if(segment >= 0){
+        //older segments are not indexed; fixed-size records are at a known offset
+        size_t record_size = index.getRecordSize();
+
+        *start_out = record_size != 0 ? record : base;
+        *offset_out = (*start_out - base) * record_size;
+        ret = true;
+    }
+
+    if(ret){
+        segments->getPath(segment, path_out);
+    }
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+bool spiffsControl::ringBuffer::query(uint32_t first, uint32_t last, uint32_t from, uint32_t *start_out, uint32_t *offset_out, uint32_t *end_out, char *path_out){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    prepareIndex();
+
+    bool ret = false;
+    int active = segments->getCount() - 1;
+    if(from < segments->getOldest()) from = segments->getOldest();
+
+    //older segments, as one stride each
+    for(int segment = segments->find(from); !ret && segment < active; segment++){
+        const Segment *stride = segments->get(segment);
+
+        if(stride->first_time <= last && stride->last_time >= first){
+            *start_out = stride->first_record;
+            *offset_out = 0;
+            *end_out = segments->get(segment + 1)->first_record;
+            segments->getPath(segment, path_out);
+            ret = true;
+        }
+    }
+
+    //active segment, through the index
+    if(!ret){
+        uint32_t base = segments->getActive()->first_record;
+
+        ret = index.query(first, last, from > base ? from - base : 0, start_out, offset_out, end_out);
+        if(ret){
+            *start_out += base;
+            *end_out += base;
+            segments->getPath(active, path_out);
+        }
+    }
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+uint32_t spiffsControl::ringBuffer::getOldest(){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t ret = segments->getOldest();
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+uint32_t spiffsControl::ringBuffer::getRetainedBytes(){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t ret = segments->getBytes();
+    xSemaphoreGive(lock);
+
+    return ret;
+}
+
+void spiffsControl::ringBuffer::setTimeSource(record_time_t source){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    index.setTimeSource(source);
+    xSemaphoreGive(lock);
+}
+
+void spiffsControl::ringBuffer::setWear(wearStats *wear_stats){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    wear = wear_stats;
+    xSemaphoreGive(lock);
+}
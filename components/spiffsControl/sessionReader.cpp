@@ -0,0 +1,201 @@
+/**
+ * @file sessionReader.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of sessionReader class
+**/
+
+#include "sessionReader.h"
+
+#include <string.h>
+
+static const char* TAG = "session";
+
+//blocks are copied into the decompressor, so sessions share one; sessions are only read by the i2c task
+static uint8_t block[telemetryControl::blockSize]; //too large for the i2c task stack
+
+spiffsControl::sessionReader::sessionReader(){
+    stream = NULL;
+    store = NULL;
+
+    decoding = false;
+    archive = false;
+    archive_end = 0;
+}
+
+esp_err_t spiffsControl::sessionReader::load(uint8_t session_id, uint8_t stream_id, logStream *log_stream, logStore *log_store){
+    stream = log_stream;
+    store = log_store;
+    decoding = false;
+    return session.load(session_id, stream_id);
+}
+
+void spiffsControl::sessionReader::rewind(){
+    session.rewind();
+    decoding = false;
+}
+
+esp_err_t spiffsControl::sessionReader::reset(){
+    decoding = false;
+    return session.reset();
+}
+
+esp_err_t spiffsControl::sessionReader::commit(){
+    //a block being decoded is not done yet; archive positions count samples
+    uint32_t position = session.getPosition();
+    if(decoding && !archive) position--;
+
+    return session.commit(position);
+}
+
+bool spiffsControl::sessionReader::archiveNext(telemetryControl::Telemetry *capture){
+    uint32_t position = session.getPosition();
+
+    while(!decoding || !decoder.next(capture)){
+        int read = session.readRecord(block, sizeof(block));
+        if(read == -1){
+            decoding = false;
+            session.setPosition(archive_end);
+            return false;
+        }
+
+        decoding = decoder.load(block);
+        if(!decoding) ESP_LOGW(TAG, "Skipping corrupt archive block %i", read);
+    }
+
+    //positions count samples, not blocks
+    session.setPosition(position + 1);
+    return true;
+}
+
+bool spiffsControl::sessionReader::seek(bool next){
+    ringBuffer *ring = stream->getRing();
+    size_t record_size = ring->getRecordSize();
+    char path[segmentPathSize];
+    uint32_t position = session.getPosition();
+    uint32_t start, offset;
+    lineSpan skipped;
+
+    if(position < ring->getOldest()) position = ring->getOldest();
+
+    if(!ring->locate(position, &start, &offset, path)){
+        return false;
+    }
+    if(next && (start != position || strcmp(path, session.getPath()) == 0)){
+        return false;
+    }
+    if(!session.seek(path, start, offset)){
+        return false;
+    }
+    decoding = false;
+
+    //a compacted segment is read from its first sample
+    archive = logSegments::isArchive(path);
+    if(archive){
+        ArchiveHeader header;
+        telemetryControl::Telemetry capture;
+
+        if(session.readRecord(&header, sizeof(header)) == -1 || header.magic != archiveMagic){
+            session.rewind();
+            return false;
+        }
+        archive_end = start + header.records;
+        session.setPosition(archive_end - header.samples);
+
+        while(session.getPosition() < position){
+            if(!archiveNext(&capture)){
+                session.rewind();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    while(session.getPosition() < position){
+        int record = record_size == 0 ? session.readLine(&skipped) : session.readRecord(block, record_size);
+        if(record == -1){
+            session.rewind();
+            return false;
+        }
+    }
+    return true;
+}
+
+void spiffsControl::sessionReader::format(telemetryControl::Telemetry *capture, lineSpan *line_out){
+    capture->ToCSV(line);
+    line_out->data = line;
+    line_out->size = strcspn(line, "\n");
+}
+
+bool spiffsControl::sessionReader::readNext(lineSpan *line_out){
+    size_t record_size = stream->getRing()->getRecordSize();
+    telemetryControl::Telemetry capture;
+    bool found = false;
+
+    //the store is read by sequence number
+    if(useLogStore){
+        telemetryControl::Record record;
+        size_t size;
+        uint8_t tag;
+        uint32_t position = session.getPosition();
+
+        if(store == NULL){
+            return false;
+        }
+
+        if(position < store->getOldest()) position = store->getOldest();
+        while(!found && position < store->getNext()){
+            found = store->read(position++, &record, &size, &tag) == ESP_OK && tag == stream->getTag()
+                && size == sizeof(record) && capture.FromRecord(&record);
+        }
+        session.setPosition(position);
+    }
+    else{
+        if(!session.isPositioned() && !seek(false)){
+            return false;
+        }
+
+        //at the end of a segment, carry on in the next one
+        do{
+            if(archive){
+                found = archiveNext(&capture);
+            }
+            else if(record_size == telemetryControl::sizeRecord){
+                telemetryControl::Record record;
+
+                while(!found && session.readRecord(&record, sizeof(record)) != -1){
+                    found = capture.FromRecord(&record);
+                }
+            }
+            else if(record_size != 0){
+                while(!found){
+                    if(decoding && decoder.next(&capture)){
+                        found = true;
+                    }
+                    else if(session.readRecord(block, sizeof(block)) != -1){
+                        decoding = decoder.load(block);
+                    }
+                    else{
+                        break;
+                    }
+                }
+                if(decoder.getRemaining() == 0) decoding = false;
+            }
+            else{
+                found = session.readLine(line_out) != -1;
+            }
+        } while(!found && seek(true));
+
+        //.csv lines are returned as read
+        if(found && record_size == 0 && !archive){
+            return true;
+        }
+    }
+
+    if(!found){
+        return false;
+    }
+
+    format(&capture, line_out);
+    return true;
+}
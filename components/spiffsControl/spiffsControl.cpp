@@ -10,14 +10,21 @@ static const char* TAG = "spiffs";
 
 
 spiffsControl::spiffs::spiffs(){
-    mount();
-    checkSPIFFS();
-
-    line_number = 0;
+    conf = {};
 }
 
 spiffsControl::spiffs::~spiffs(){
-    esp_vfs_spiffs_unregister(conf.partition_label);
+    if(!useLogStore){
+        esp_vfs_spiffs_unregister(conf.partition_label);
+    }
+}
+
+void spiffsControl::spiffs::init(){
+    //mounting would format the log store's partition
+    if(!useLogStore){
+        mount();
+        checkSPIFFS(bootCheck);
+    }
 }
 
 void spiffsControl::spiffs::mount(){
@@ -26,7 +33,7 @@ void spiffsControl::spiffs::mount(){
     conf = {
       .base_path = "/spiffs",
       .partition_label = NULL,
-      .max_files = 5,
+      .max_files = maxOpenFiles,
       .format_if_mount_failed = true
     };
 
@@ -46,30 +53,110 @@ void spiffsControl::spiffs::mount(){
     }
 }
 
-void spiffsControl::spiffs::checkSPIFFS(){
+bool spiffsControl::spiffs::checkSPIFFS(bool repair){
     size_t total = 0, used = 0;
     esp_err_t ret = esp_spiffs_info(conf.partition_label, &total, &used);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get SPIFFS partition information (%s). Formatting...", esp_err_to_name(ret));
-        esp_spiffs_format(conf.partition_label);
-        return;
+        //formatting here would wipe a log that may only need a check
+        ESP_LOGE(TAG, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
+        return false;
     } else {
         ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
     }
 
     // Check consistency of reported partiton size info.
     if (used > total) {
+        if (!repair) {
+            ESP_LOGW(TAG, "Number of used bytes cannot be larger than total. SPIFFS_check() needed.");
+            return false;
+        }
+
         ESP_LOGW(TAG, "Number of used bytes cannot be larger than total. Performing SPIFFS_check().");
         ret = esp_spiffs_check(conf.partition_label);
         // Could be also used to mend broken files, to clean unreferenced pages, etc.
         // More info at https://github.com/pellepl/spiffs/wiki/FAQ#powerlosses-contd-when-should-i-run-spiffs_check
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "SPIFFS_check() failed (%s)", esp_err_to_name(ret));
-            return;
+            return false;
         } else {
             ESP_LOGI(TAG, "SPIFFS_check() successful");
         }
     }
+    return true;
+}
+
+long spiffsControl::spiffs::recover(const char *path, size_t record_size, record_check_t check){
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0; //nothing logged yet
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    long start = size > recoveryScanSize ? size - recoveryScanSize : 0;
+    long valid_end = size; //end of the last record kept
+
+    char *buffer = new char[record_size != 0 ? record_size : size - start];
+
+    if(record_size != 0){
+        //records start at multiples of record_size
+        long end = size - size % record_size;
+        valid_end = end;
+
+        for(long pos = end - record_size; pos >= start; pos -= record_size){
+            if(fseek(file, pos, SEEK_SET) != 0 || fread(buffer, 1, record_size, file) != record_size){
+                break;
+            }
+            if(check(buffer, record_size)){
+                valid_end = pos + record_size;
+                break;
+            }
+        }
+    }
+    else if(size > start && fseek(file, start, SEEK_SET) == 0 && fread(buffer, 1, size - start, file) == (size_t)(size - start)){
+        long last_newline = size - start - 1;
+        while(last_newline >= 0 && buffer[last_newline] != '\n'){
+            last_newline--;
+        }
+
+        //without a newline in range nothing can be checked, so nothing is dropped
+        if(last_newline >= 0){
+            valid_end = start + last_newline + 1;
+
+            //a line before the scanned range may start in it; it is not checked
+            for(long line_end = last_newline; line_end >= 0;){
+                long line_start = line_end - 1;
+                while(line_start >= 0 && buffer[line_start] != '\n'){
+                    line_start--;
+                }
+                line_start++;
+
+                if(line_start == 0 && start != 0){
+                    break;
+                }
+                if(check(buffer + line_start, line_end - line_start + 1)){
+                    valid_end = start + line_end + 1;
+                    break;
+                }
+                line_end = line_start - 1;
+            }
+        }
+    }
+
+    delete[] buffer;
+    fclose(file);
+
+    if(valid_end >= size){
+        return 0;
+    }
+
+    if(truncate(path, valid_end) != 0){
+        ESP_LOGE(TAG, "%s - Failed to drop torn record", path);
+        return -1;
+    }
+
+    ESP_LOGW(TAG, "%s - Dropped %ld bytes after the last valid record", path, size - valid_end);
+    return size - valid_end;
 }
 
 void spiffsControl::spiffs::clearLog(const char *path){
@@ -78,6 +165,7 @@ void spiffsControl::spiffs::clearLog(const char *path){
         ESP_LOGE(TAG, "Failed to open file for writing");
         return;
     }
+    fclose(file);
 
     ESP_LOGI(TAG, "%s - File cleared", path);
 }
@@ -91,49 +179,14 @@ void spiffsControl::spiffs::addLine(const char *path, const char *message){
     }
 
     //add line
-    fprintf(file, message);
-
-    //close line
-    fclose(file);
-    ESP_LOGI(TAG, "Line written");
-}
-
-int spiffsControl::spiffs::readLine(const char *path, std::string *string_out){
-    //open file if first request
-    if(line_number == 0){
-        open_file = fopen(path, "r");
-        if (open_file == NULL) {
-            ESP_LOGE(TAG, "Failed to open file for writing");
-            return -1;
-        }
+    if(fputs(message, file) < 0){
+        ESP_LOGE(TAG, "Failed to write line");
     }
 
-    char line_buffer[buffer_size];
-
-    // read line
-    if(fgets(line_buffer, buffer_size, open_file) != NULL){
-        // strip newline
-        char *pos = strchr(line_buffer, '\n');
-        if (pos) {
-            *pos = '\0';
-        }
-        ESP_LOGI(TAG, "Read from file: '%s'", line_buffer);
-
-        //copy line to string_out
-        *string_out = std::string(line_buffer);
-
-        //return fn and increment line count
-        ESP_LOGI(TAG, "Line read %i", line_number);
-        return line_number++;
-    }
-    else{
-        //close file
-        fclose(open_file);
-
-        //reset line count
-        line_number = 0;
-
-        ESP_LOGW(TAG, "End of File");
-        return -1;
+    //close file
+    if(fclose(file) != 0){
+        ESP_LOGE(TAG, "Failed to close file");
+        return;
     }
-}
\ No newline at end of file
+    ESP_LOGI(TAG, "Line written");
+}
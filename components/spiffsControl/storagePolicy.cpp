@@ -0,0 +1,90 @@
+/**
+ * @file storagePolicy.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of storagePolicy class
+**/
+
+#include "storagePolicy.h"
+
+static const char* TAG = "policy";
+
+spiffsControl::storagePolicy::storagePolicy(){
+    //the partition is 0x160000 bytes; thin out the last fifth of it
+    setTier(0, 262144, 2);
+    setTier(1, 131072, 4);
+    setTier(2, 65536, 8);
+    setTier(3, 0, 1);
+
+    streams = defaultPolicyStreams;
+    active = -1;
+    last_check = 0;
+
+    last_free = 0;
+    changes = 0;
+}
+
+bool spiffsControl::storagePolicy::setTier(int tier, uint32_t free_bytes, uint8_t stretch){
+    if(tier < 0 || tier >= maxPolicyTiers || stretch < 1 || stretch > policyMaxStretch){
+        return false;
+    }
+
+    tiers[tier].free_bytes = free_bytes;
+    tiers[tier].stretch = stretch;
+    last_check = 0; //checked again on the next sample
+    return true;
+}
+
+bool spiffsControl::storagePolicy::due(){
+    int64_t now = esp_timer_get_time();
+
+    if(last_check != 0 && now - last_check < (int64_t)policyCheckInterval * 1000){
+        return false;
+    }
+    last_check = now;
+    return true;
+}
+
+int spiffsControl::storagePolicy::update(uint32_t free_bytes){
+    int chosen = -1;
+
+    for(int i = 0; i < maxPolicyTiers; i++){
+        uint32_t threshold = tiers[i].free_bytes;
+        if(threshold == 0){
+            continue;
+        }
+
+        //the current tier and the ones above it are held until well clear of their threshold
+        if(active != -1 && threshold >= tiers[active].free_bytes){
+            threshold += policyHysteresis;
+        }
+
+        if(free_bytes < threshold && (chosen == -1 || tiers[i].free_bytes < tiers[chosen].free_bytes)){
+            chosen = i;
+        }
+    }
+
+    if(chosen != active){
+        if(chosen == -1){
+            ESP_LOGI(TAG, "%lu bytes free, sampling at the set intervals", (unsigned long)free_bytes);
+        }
+        else{
+            ESP_LOGW(TAG, "%lu bytes free, sampling %i times slower", (unsigned long)free_bytes, (int)tiers[chosen].stretch);
+        }
+        active = chosen;
+        changes++;
+    }
+
+    last_free = free_bytes;
+    return active;
+}
+
+uint32_t spiffsControl::storagePolicy::stretch(uint8_t stream, uint32_t interval){
+    int tier = active;
+
+    if(tier == -1 || !(streams & (1 << stream))){
+        return interval;
+    }
+    return interval * tiers[tier].stretch;
+}
+
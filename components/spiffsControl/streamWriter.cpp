@@ -0,0 +1,80 @@
+/**
+ * @file streamWriter.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of streamWriter class
+**/
+
+#include "streamWriter.h"
+
+static const char* TAG = "stream_writer";
+
+spiffsControl::streamWriter::streamWriter(){
+    count = 0;
+    handle = NULL;
+    running = false;
+    passes = 0;
+}
+
+spiffsControl::streamWriter::~streamWriter(){
+    stop();
+}
+
+bool spiffsControl::streamWriter::add(logStream *stream){
+    if(count == maxStreams){
+        ESP_LOGE(TAG, "Too many streams");
+        return false;
+    }
+
+    streams[count++] = stream;
+    return true;
+}
+
+void spiffsControl::streamWriter::start(){
+    if(handle != NULL){
+        return;
+    }
+
+    running = true;
+    xTaskCreatePinnedToCore(task, "stream_writer", writerStackSize, this, writerPriority, &handle, 1);
+
+    for(int i = 0; i < count; i++){
+        streams[i]->getRing()->defer(handle);
+    }
+    ESP_LOGI(TAG, "Started: writing %i streams", count);
+}
+
+void spiffsControl::streamWriter::stop(){
+    if(handle == NULL){
+        return;
+    }
+
+    for(int i = 0; i < count; i++){
+        streams[i]->getRing()->defer(NULL);
+    }
+
+    //the task ends after its pass, so it never stops holding a ring's lock
+    running = false;
+    xTaskNotifyGive(handle);
+    handle = NULL;
+}
+
+void spiffsControl::streamWriter::task(void *pvParameters){
+    streamWriter *self = (streamWriter *)pvParameters;
+    const TickType_t xDelay = writerPassInterval / portTICK_PERIOD_MS;
+
+    while(1){
+        //woken by a ring with a flush due, or after the interval for the age policy
+        ulTaskNotifyTake(pdTRUE, xDelay);
+        if(!self->running){
+            break;
+        }
+
+        for(int i = 0; i < self->count; i++){
+            self->streams[i]->getRing()->service();
+        }
+        self->passes++;
+    }
+
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,188 @@
+/**
+ * @file wearStats.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of wearStats class
+**/
+
+#include "wearStats.h"
+#include <string.h>
+
+static const char* TAG = "wear";
+
+spiffsControl::wearStats::wearStats(){
+    memset(&totals, 0, sizeof(totals));
+    totals.version = wearVersion;
+    memset(sector_erases, 0, sizeof(sector_erases));
+    loaded = false;
+
+    dirty = false;
+    sectors_dirty = false;
+    saved_bytes = 0;
+    saved_time = 0;
+
+    saves = 0;
+
+    lock = xSemaphoreCreateMutex();
+}
+
+spiffsControl::wearStats::~wearStats(){
+    vSemaphoreDelete(lock);
+}
+
+esp_err_t spiffsControl::wearStats::load(){
+    static uint16_t sectors[wearMaxSectors]; //too large for the stack of the boot task
+    nvs_handle_t handle;
+    WearTotals stored;
+    size_t size = sizeof(stored);
+
+    memset(sectors, 0, sizeof(sectors));
+
+    esp_err_t ret = nvs_open(wearNamespace, NVS_READONLY, &handle);
+    if(ret == ESP_OK){
+        ret = nvs_get_blob(handle, "totals", &stored, &size);
+        if(ret == ESP_OK && (size != sizeof(stored) || stored.version != wearVersion)){
+            ESP_LOGW(TAG, "Counters from another version, starting again");
+            ret = ESP_ERR_NVS_NOT_FOUND;
+        }
+
+        //sector counts are only kept with the totals they belong to
+        size = sizeof(sectors);
+        if(ret == ESP_OK && nvs_get_blob(handle, "sectors", sectors, &size) != ESP_OK){
+            memset(sectors, 0, sizeof(sectors));
+        }
+        nvs_close(handle);
+    }
+
+    //nothing saved yet
+    if(ret == ESP_ERR_NVS_NOT_FOUND){
+        memset(&stored, 0, sizeof(stored));
+        stored.version = wearVersion;
+        ret = ESP_OK;
+    }
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Failed to read counters (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    //anything counted before the load, e.g. by recovery, is added on
+    stored.boots++;
+    stored.bytes_written += totals.bytes_written;
+    stored.appends += totals.appends;
+    stored.append_time += totals.append_time;
+    if(totals.max_latency > stored.max_latency) stored.max_latency = totals.max_latency;
+    stored.erases += totals.erases;
+    totals = stored;
+    for(int i = 0; i < wearMaxSectors; i++){
+        uint32_t erases = (uint32_t)sectors[i] + sector_erases[i];
+        sector_erases[i] = erases < UINT16_MAX ? erases : UINT16_MAX;
+    }
+
+    loaded = true;
+    dirty = true;
+    sectors_dirty = true;
+    saved_bytes = totals.bytes_written;
+    saved_time = esp_timer_get_time();
+
+    xSemaphoreGive(lock);
+
+    ESP_LOGI(TAG, "Boot %lu: %llu bytes written, %lu erases", (unsigned long)totals.boots,
+        (unsigned long long)totals.bytes_written, (unsigned long)totals.erases);
+    return ESP_OK;
+}
+
+bool spiffsControl::wearStats::save(bool force){
+    static uint16_t sectors[wearMaxSectors]; //copied under the lock, written after it
+    nvs_handle_t handle;
+    WearTotals copy;
+    bool with_sectors;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    bool due = force || totals.bytes_written - saved_bytes >= wearSaveBytes || now - saved_time >= (int64_t)wearSaveInterval * 1000;
+
+    if(!loaded || !dirty || !due){
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    copy = totals;
+    with_sectors = sectors_dirty;
+    if(with_sectors) memcpy(sectors, sector_erases, sizeof(sectors));
+
+    dirty = false;
+    sectors_dirty = false;
+    saved_bytes = totals.bytes_written;
+    saved_time = now;
+    xSemaphoreGive(lock);
+
+    esp_err_t ret = nvs_open(wearNamespace, NVS_READWRITE, &handle);
+    if(ret == ESP_OK){
+        ret = nvs_set_blob(handle, "totals", &copy, sizeof(copy));
+        if(ret == ESP_OK && with_sectors){
+            ret = nvs_set_blob(handle, "sectors", sectors, sizeof(sectors));
+        }
+        if(ret == ESP_OK){
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if(ret != ESP_OK){
+        ESP_LOGE(TAG, "Failed to save counters (%s)", esp_err_to_name(ret));
+
+        //try again next time
+        xSemaphoreTake(lock, portMAX_DELAY);
+        dirty = true;
+        sectors_dirty = sectors_dirty || with_sectors;
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    saves++;
+    ESP_LOGD(TAG, "Counters saved");
+    return true;
+}
+
+void spiffsControl::wearStats::addAppend(size_t bytes, uint32_t latency){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    totals.bytes_written += bytes;
+    totals.appends++;
+    totals.append_time += latency;
+    if(latency > totals.max_latency) totals.max_latency = latency;
+    dirty = true;
+    xSemaphoreGive(lock);
+}
+
+void spiffsControl::wearStats::addBytes(size_t bytes){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    totals.bytes_written += bytes;
+    dirty = true;
+    xSemaphoreGive(lock);
+}
+
+void spiffsControl::wearStats::addErase(uint32_t sector){
+    xSemaphoreTake(lock, portMAX_DELAY);
+    totals.erases++;
+    if(sector < wearMaxSectors && sector_erases[sector] < UINT16_MAX){
+        sector_erases[sector]++;
+        sectors_dirty = true;
+    }
+    dirty = true;
+    xSemaphoreGive(lock);
+}
+
+uint32_t spiffsControl::wearStats::getSectorErases(uint32_t sector){
+    return sector < wearMaxSectors ? sector_erases[sector] : 0;
+}
+
+uint32_t spiffsControl::wearStats::getMaxSectorErases(){
+    uint32_t most = 0;
+
+    for(int i = 0; i < wearMaxSectors; i++){
+        if(sector_erases[i] > most) most = sector_erases[i];
+    }
+    return most;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file telemetryCompression.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Streaming compression of Telemetry into fixed-size blocks
+**/
+
+#ifndef _telemetryCompression_H_included
+#define _telemetryCompression_H_included
+
+#include "telemetryControl.h"
+
+namespace telemetryControl{
+    //block config
+    constexpr int blockSize = 1024; //bytes per compressed block, header included
+    constexpr uint16_t blockMagic = 0x5443; //"TC"
+    constexpr uint8_t blockVersion = 2; //increment when the bit stream layout changes
+    constexpr uint8_t blockVersionFloat = 1; //temperatures XOR encoded as float bits; still decoded
+
+    /**
+     * @brief Header at the start of every compressed block
+     * @note the first sample of a block is stored uncompressed, so every block
+     * can be decoded on its own
+     */
+    struct __attribute__((packed)) BlockHeader{
+        uint16_t magic; // always blockMagic
+        uint8_t version; // bit stream layout version
+        uint8_t reserved;
+        uint16_t count; // number of samples in the block
+        uint16_t bits; // number of payload bits used
+        uint32_t crc; // esp_rom_crc32_le of the payload
+    };
+
+    constexpr int blockPayloadBits = (blockSize - sizeof(BlockHeader)) * 8;
+
+    //worst case size of one sample: time(4+64), duty(1+8), period(1+32), sensors(3+16 each)
+    constexpr int maxSampleBits = 68 + 9 + 33 + numSensors * 19;
+
+    //called with every sealed block
+    typedef void(*block_sink_t)(const uint8_t *block, int size);
+
+    /**
+     * @brief Gorilla style telemetry compressor
+     * @note - Timestamps are delta-of-delta encoded in micro-seconds
+     * @note - Temperatures are rounded to the resolution of binary records, then
+     * delta encoded against the previous sample, so sensor noise below the logged
+     * resolution costs no bits
+     * @note - PWM period is stored when it changes
+     * @note - Samples are packed into blockSize blocks that are handed to a sink once full
+     */
+    class Compressor{
+    public:
+        /**
+         * @brief Construct a new Compressor object
+         *
+         * @param block_sink function called with each sealed block
+         */
+        Compressor(block_sink_t block_sink);
+
+        /**
+         * @brief Adds a sample to the current block
+         * @note seals the block and starts a new one if the sample might not fit
+         *
+         * @param capture sample to compress
+         */
+        void append(const Telemetry *capture);
+
+        /**
+         * @brief Seals the current block, even if it is not full
+         * @note does nothing if the block is empty. Call before stopping
+         * the logger so buffered samples are not lost.
+         */
+        void flush();
+
+        /**
+         * @brief Get the number of samples in the current block
+         *
+         * @return int
+         */
+        inline int getCount(){
+            return count;
+        }
+
+        /**
+         * @brief Get the payload bits per sample of the last block sealed
+         *
+         * @return int bits, 0 before the first block is sealed
+         */
+        inline int getSampleBits(){
+            return sample_bits;
+        }
+
+    private:
+        void reset();
+        void writeBits(uint64_t value, int bits);
+        void writeSensor(int sensor, int16_t value);
+
+        block_sink_t sink;
+        uint8_t block[blockSize];
+        int position; //payload bits written
+        int count; //samples in block
+        int sample_bits; //payload bits per sample of the last sealed block
+
+        //previous sample
+        uint64_t prev_time;
+        int64_t prev_delta;
+        uint8_t prev_duty;
+        uint32_t prev_period;
+        int16_t prev_sens[numSensors]; //TempToCount() of each temperature
+    };
+
+    /**
+     * @brief Decodes blocks written by Compressor
+     *
+     */
+    class Decompressor{
+    public:
+        Decompressor();
+
+        /**
+         * @brief Loads a block to decode
+         *
+         * @param data blockSize bytes
+         * @return true if the header and crc are valid;
+         * @return false if the block can not be decoded
+         */
+        bool load(const uint8_t *data);
+
+        /**
+         * @brief Decodes the next sample of the loaded block
+         *
+         * @param capture destination for the sample
+         * @return true if a sample was decoded;
+         * @return false if there are no more samples in the block
+         */
+        bool next(Telemetry *capture);
+
+        inline int getRemaining(){
+            return count - index;
+        }
+
+    private:
+        uint64_t readBits(int bits);
+        float readSensor(int sensor);
+        float readSensorFloat(int sensor); //blockVersionFloat
+
+        uint8_t block[blockSize];
+        uint8_t version; //bit stream layout of the loaded block
+        int position; //payload bits read
+        int index; //samples read
+        int count; //samples in block
+
+        uint64_t prev_time;
+        int64_t prev_delta;
+        uint8_t prev_duty;
+        uint32_t prev_period;
+        int16_t prev_count[numSensors];
+        uint32_t prev_sens[numSensors]; //float bits, blockVersionFloat
+        uint8_t prev_leading[numSensors]; //XOR window of the previous sensor value
+        uint8_t prev_trailing[numSensors];
+    };
+}
+
+#endif // _telemetryCompression_H_included
@@ -9,9 +9,12 @@
 #define _telemetry_H_included
 
 #include "esp_sntp.h"
+#include "esp_rom_crc.h"
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include <cstring>
 
 namespace telemetryControl{
@@ -29,9 +32,39 @@ namespace telemetryControl{
 
     constexpr int sizeLine = sizeTime + sizeTemp + sizePWM + 3;
 
+    //.csv journal columns: ",<sequence>,<crc>"
+    constexpr int sizeJournalSequence = 10;
+    constexpr int sizeJournalCRC = 4; //hex digits
+    constexpr int sizeJournal = sizeJournalSequence + sizeJournalCRC + 2;
+    constexpr int sizeJournalLine = sizeLine + sizeJournal;
+
     constexpr int precisionSensor = 3;
     constexpr int precisionPWM = 3;
 
+    //binary record
+    constexpr uint8_t recordVersion = 1; //increment when the layout of Record changes
+    constexpr float recordTempScale = 50; //counts per degree; 0.02 resolution, +/-655 range
+    constexpr float recordPeriodScale = 100; //counts per second of pwm period
+    constexpr int16_t recordTempInvalid = INT16_MIN; //stored in place of a NaN temperature
+
+    /**
+     * @brief Fixed-size binary telemetry record
+     * @note - Compact alternative to a .csv line (46 bytes instead of ~155)
+     * @note - Temperatures and PWM period are stored as fixed-point integers
+     * @note - Last member is a CRC-16 of every byte before it
+     */
+    struct __attribute__((packed)) Record{
+        uint8_t version; // layout version, always recordVersion when written
+        uint8_t pwm_Duty; // pwm duty cycle (percentage)
+        uint16_t pwm_Period; // pwm period length (1/recordPeriodScale seconds), saturates at UINT16_MAX
+        uint32_t Seconds; // time: Seconds portion
+        uint32_t uSeconds; // time: micro-Seconds portion
+        int16_t Sens[numSensors]; // temperature array (1/recordTempScale degrees)
+        uint16_t crc; // esp_rom_crc16_le of all preceding bytes
+    };
+
+    constexpr int sizeRecord = sizeof(Record);
+
     /**
      * @brief Payload telemetry structure
      * @note - Contains time, temperatures, and pwm out data
@@ -56,10 +89,25 @@ namespace telemetryControl{
 
         /**
          * @brief Copies full telemetry into a string
+         * @note Formats in a single pass with integer arithmetic. Output is
+         * identical to the printf formats used by the per-field functions
+         * 
+         * @param LineChar destination string. length must be [sizeLine]
+         * @return int - number of characters written, not counting the null terminator
+         */
+        int ToCSV(char *LineChar);
+
+        /**
+         * @brief Reads telemetry back from a .csv line written by ToCSV()
+         * @note journal columns after the last cell are ignored. Values keep the
+         * precision of the line.
          * 
-         * @param LineChar destination string. length must be [line_size]
+         * @param LineChar line, null terminated; the newline is optional
+         * @return true if the line was read;
+         * @return false if it is not a sample line, e.g. the header.
+         * Telemetry is left unchanged.
          */
-        void ToCSV(char *LineChar);
+        bool FromCSV(const char *LineChar);
 
         /**
          * @brief Copies time telemetry into a string 
@@ -106,6 +154,24 @@ namespace telemetryControl{
          */
         void PWMToCSV(char *DutyChar, char*PeriodChar);
 
+        /**
+         * @brief Packs telemetry into a binary record
+         * @note temperatures are rounded to 1/recordTempScale and clamped to the int16 range
+         * 
+         * @param record destination record. version and crc are filled in
+         */
+        void ToRecord(Record *record);
+
+        /**
+         * @brief Unpacks a binary record into telemetry
+         * 
+         * @param record source record
+         * @return true if the record was unpacked;
+         * @return false if the version is unknown or the crc does not match.
+         * Telemetry is left unchanged.
+         */
+        bool FromRecord(const Record *record);
+
         /**
          * @brief Copies csv header template into a string
          * 
@@ -150,6 +216,50 @@ namespace telemetryControl{
 
         void setPWM(int duty_percentage, float cycle_period);
     };
+
+    /**
+     * @brief Adds journal columns to a .csv line: a sequence number and
+     * a CRC-16 of everything before the CRC, so a torn or corrupt line
+     * can be found after a power loss
+     * 
+     * @param LineChar .csv line ending in a newline. length must be [sizeJournalLine]
+     * @param length number of characters in the line
+     * @param sequence record sequence number
+     * @return int - number of characters in the journaled line
+     */
+    int JournalCSV(char *LineChar, int length, uint32_t sequence);
+
+    /**
+     * @brief Checks a .csv line from the log
+     * 
+     * @param LineChar line, not null terminated
+     * @param length number of characters in the line, newline included
+     * @param sequence_out sequence number of a journaled line, can be NULL.
+     * Left unchanged for a line without journal columns.
+     * @return true if the line ends in a newline and its crc matches. The header
+     * has no journal columns and only needs to be printable.
+     * @return false if the line is torn or corrupt, or is a sample line
+     * without journal columns (written before journaling)
+     */
+    bool CheckCSV(const char *LineChar, int length, uint32_t *sequence_out = NULL);
+
+    /**
+     * @brief Rounds a temperature to the resolution of a binary record
+     * @note shared by binary records and compressed blocks
+     * 
+     * @param temperature degrees
+     * @return int16_t 1/recordTempScale degrees, clamped to the int16 range;
+     * recordTempInvalid for NaN
+     */
+    int16_t TempToCount(float temperature);
+
+    /**
+     * @brief Get the temperature of a count from TempToCount()
+     * 
+     * @param count 1/recordTempScale degrees
+     * @return float degrees, NaN for recordTempInvalid
+     */
+    float CountToTemp(int16_t count);
 }
 
 #endif // _telemetry_H_included
\ No newline at end of file
@@ -0,0 +1,119 @@
+/**
+ * @file telemetryRollup.h
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Fixed-window min/max/mean summaries of Telemetry
+**/
+
+#ifndef _telemetryRollup_H_included
+#define _telemetryRollup_H_included
+
+#include "telemetryControl.h"
+
+namespace telemetryControl{
+    //rollup config
+    constexpr uint8_t rollupVersion = 1; //increment when the layout of RollupRecord changes
+
+    /**
+     * @brief Summary of every sample in one window of time
+     * @note - Temperatures are fixed-point like Record, recordTempInvalid where
+     * a sensor had no valid sample in the window
+     * @note - Last member is a CRC-16 of every byte before it
+     */
+    struct __attribute__((packed)) RollupRecord{
+        uint8_t version; // layout version, always rollupVersion when written
+        uint8_t tier; // rollup tier, chosen by the writer
+        uint16_t count; // samples in the window
+        uint32_t Seconds; // window start (seconds)
+        uint16_t period; // window length (seconds)
+        int16_t Min[numSensors]; // lowest temperature (1/recordTempScale degrees)
+        int16_t Max[numSensors]; // highest temperature (1/recordTempScale degrees)
+        int16_t Mean[numSensors]; // mean temperature (1/recordTempScale degrees)
+        uint16_t crc; // esp_rom_crc16_le of all preceding bytes
+    };
+
+    constexpr int sizeRollup = sizeof(RollupRecord);
+
+    //called with every sealed window
+    typedef void(*rollup_sink_t)(const RollupRecord *record);
+
+    /**
+     * @brief Incremental min/max/mean of Telemetry over fixed windows
+     * @note - Windows are aligned to multiples of the period since the epoch,
+     * so every tier's windows line up
+     * @note - Each sample only updates running sums, so memory and time per
+     * sample are constant
+     * @note - A window is sealed and handed to the sink once a sample of a
+     * later window arrives, or by flush()
+     */
+    class Rollup{
+    public:
+        /**
+         * @brief Construct a new Rollup object
+         *
+         * @param rollup_tier tier written to every record
+         * @param window_period window length (seconds)
+         * @param rollup_sink function called with each sealed window
+         */
+        Rollup(uint8_t rollup_tier, uint16_t window_period, rollup_sink_t rollup_sink);
+
+        /**
+         * @brief Adds a sample to its window
+         * @note seals the current window first if the sample is in a later one
+         *
+         * @param capture sample
+         */
+        void append(const Telemetry *capture);
+
+        /**
+         * @brief Seals the current window, even if it is not over
+         * @note does nothing if the window is empty. Call when the logger
+         * stops, so a gap in sampling is not summarized as one window.
+         */
+        void flush();
+
+        /**
+         * @brief Summarizes the current window without sealing it
+         *
+         * @param record destination record
+         * @return true if the window holds a sample
+         */
+        bool peek(RollupRecord *record);
+
+        inline uint16_t getPeriod(){
+            return period;
+        }
+        inline uint32_t getSealed(){
+            return sealed;
+        }
+
+    private:
+        void reset();
+        void fill(RollupRecord *record);
+
+        uint8_t tier;
+        uint16_t period;
+        rollup_sink_t sink;
+
+        //current window
+        uint32_t window; //start (seconds)
+        uint16_t count; //samples
+        float min[numSensors];
+        float max[numSensors];
+        float sum[numSensors];
+        uint16_t valid[numSensors]; //samples that were not NaN
+
+        //metrics
+        uint32_t sealed; //windows handed to the sink
+    };
+
+    /**
+     * @brief Checks a rollup record read back from the log
+     *
+     * @param record record
+     * @return true if the version is known and the crc matches
+     */
+    bool CheckRollup(const RollupRecord *record);
+}
+
+#endif // _telemetryRollup_H_included
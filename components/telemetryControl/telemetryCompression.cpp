@@ -0,0 +1,306 @@
+/**
+ * @file telemetryCompression.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of Compressor and Decompressor
+ *
+ * Bit stream, per sample after the first of a block:
+ *  time    '0' same interval, '10'+14, '110'+20, '1110'+32 or '1111'+64 bit delta-of-delta
+ *  duty    '0' unchanged, '1'+8 bits
+ *  period  '0' unchanged, '1'+32 bits
+ *  sensor  '0' unchanged, '10'+5 or '110'+9 bit change of TempToCount(),
+ *          '111'+16 bit count
+ * The first sample of a block stores time(64), duty(8), period(32) and
+ * each sensor count(16) as they are.
+ *
+ * Blocks of blockVersionFloat stored each sensor as float bits: 32 in the
+ * first sample, then '0' unchanged, '10'+bits inside the previous XOR
+ * window, '11'+5 bit leading zeros+5 bit (length-1)+length bits of XOR.
+**/
+
+#include "telemetryCompression.h"
+
+constexpr uint8_t windowNone = 0xFF; //no XOR window to reuse
+
+static uint64_t timeOf(const telemetryControl::Telemetry *capture){
+    return (uint64_t)capture->Seconds * 1000000 + capture->uSeconds;
+}
+
+static uint32_t bitsOf(float value){
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float floatOf(uint32_t bits){
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static bool fitsSigned(int64_t value, int bits){
+    return value >= -((int64_t)1 << (bits - 1)) && value < ((int64_t)1 << (bits - 1));
+}
+
+static int64_t signExtend(uint64_t value, int bits){
+    if(bits < 64 && (value >> (bits - 1)) & 1) value |= ~(uint64_t)0 << bits;
+    return (int64_t)value;
+}
+
+/* Compressor */
+
+telemetryControl::Compressor::Compressor(block_sink_t block_sink) : sink{block_sink}{
+    sample_bits = 0;
+    reset();
+}
+
+void telemetryControl::Compressor::reset(){
+    memset(block, 0, blockSize);
+    position = 0;
+    count = 0;
+}
+
+void telemetryControl::Compressor::writeBits(uint64_t value, int bits){
+    uint8_t *payload = block + sizeof(BlockHeader);
+
+    while(bits > 0){
+        int free_bits = 8 - (position & 7); //bits left in current byte
+        int chunk = bits < free_bits ? bits : free_bits;
+        uint8_t part = (value >> (bits - chunk)) & ((1 << chunk) - 1);
+
+        payload[position >> 3] |= part << (free_bits - chunk);
+        position += chunk;
+        bits -= chunk;
+    }
+}
+
+void telemetryControl::Compressor::writeSensor(int sensor, int16_t value){
+    int32_t delta = (int32_t)value - prev_sens[sensor];
+    prev_sens[sensor] = value;
+
+    if(delta == 0) writeBits(0b0, 1);
+    else if(fitsSigned(delta, 5)) { writeBits(0b10, 2); writeBits(delta, 5); }
+    else if(fitsSigned(delta, 9)) { writeBits(0b110, 3); writeBits(delta, 9); }
+    else { writeBits(0b111, 3); writeBits((uint16_t)value, 16); }
+}
+
+void telemetryControl::Compressor::append(const Telemetry *capture){
+    if(position + maxSampleBits > blockPayloadBits){
+        flush();
+    }
+
+    uint64_t time = timeOf(capture);
+    uint8_t duty = capture->pwm_Duty;
+    uint32_t period = bitsOf(capture->pwm_Period);
+
+    if(count == 0){
+        //first sample is stored raw
+        writeBits(time, 64);
+        writeBits(duty, 8);
+        writeBits(period, 32);
+
+        for(int i = 0; i < numSensors; i++){
+            prev_sens[i] = TempToCount(capture->Sens[i]);
+            writeBits((uint16_t)prev_sens[i], 16);
+        }
+
+        prev_delta = 0;
+    }
+    else{
+        //time
+        int64_t delta = time - prev_time;
+        int64_t dod = delta - prev_delta;
+
+        if(dod == 0) writeBits(0b0, 1);
+        else if(fitsSigned(dod, 14)) { writeBits(0b10, 2); writeBits(dod, 14); }
+        else if(fitsSigned(dod, 20)) { writeBits(0b110, 3); writeBits(dod, 20); }
+        else if(fitsSigned(dod, 32)) { writeBits(0b1110, 4); writeBits(dod, 32); }
+        else { writeBits(0b1111, 4); writeBits(dod, 64); }
+
+        prev_delta = delta;
+
+        //pwm
+        if(duty == prev_duty) writeBits(0b0, 1);
+        else { writeBits(0b1, 1); writeBits(duty, 8); }
+
+        if(period == prev_period) writeBits(0b0, 1);
+        else { writeBits(0b1, 1); writeBits(period, 32); }
+
+        //temp
+        for(int i = 0; i < numSensors; i++){
+            writeSensor(i, TempToCount(capture->Sens[i]));
+        }
+    }
+
+    prev_time = time;
+    prev_duty = duty;
+    prev_period = period;
+    count++;
+}
+
+void telemetryControl::Compressor::flush(){
+    if(count == 0){
+        return;
+    }
+
+    BlockHeader header = {
+        .magic = blockMagic,
+        .version = blockVersion,
+        .reserved = 0,
+        .count = (uint16_t)count,
+        .bits = (uint16_t)position,
+        .crc = esp_rom_crc32_le(0, block + sizeof(BlockHeader), (position + 7) / 8)
+    };
+    memcpy(block, &header, sizeof(header));
+
+    sink(block, blockSize);
+    sample_bits = position / count;
+    reset();
+}
+
+/* Decompressor */
+
+telemetryControl::Decompressor::Decompressor(){
+    version = blockVersion;
+    position = 0;
+    index = 0;
+    count = 0;
+}
+
+bool telemetryControl::Decompressor::load(const uint8_t *data){
+    BlockHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    //nothing left to decode if the block is rejected
+    index = 0;
+    count = 0;
+
+    if(header.magic != blockMagic || (header.version != blockVersion && header.version != blockVersionFloat) || header.bits > blockPayloadBits){
+        return false;
+    }
+
+    if(header.crc != esp_rom_crc32_le(0, data + sizeof(BlockHeader), (header.bits + 7) / 8)){
+        return false;
+    }
+
+    memcpy(block, data, blockSize);
+    version = header.version;
+    position = 0;
+    count = header.count;
+
+    return true;
+}
+
+uint64_t telemetryControl::Decompressor::readBits(int bits){
+    const uint8_t *payload = block + sizeof(BlockHeader);
+    uint64_t value = 0;
+
+    while(bits > 0){
+        int left_bits = 8 - (position & 7); //bits left in current byte
+        int chunk = bits < left_bits ? bits : left_bits;
+        uint8_t byte = position < blockPayloadBits ? payload[position >> 3] : 0; //corrupt count reads past the payload
+        uint8_t part = (byte >> (left_bits - chunk)) & ((1 << chunk) - 1);
+
+        value = (value << chunk) | part;
+        position += chunk;
+        bits -= chunk;
+    }
+
+    return value;
+}
+
+float telemetryControl::Decompressor::readSensor(int sensor){
+    if(version == blockVersionFloat){
+        return readSensorFloat(sensor);
+    }
+
+    if(readBits(1) == 0) {}
+    else if(readBits(1) == 0) prev_count[sensor] += signExtend(readBits(5), 5);
+    else if(readBits(1) == 0) prev_count[sensor] += signExtend(readBits(9), 9);
+    else prev_count[sensor] = (int16_t)readBits(16);
+
+    return CountToTemp(prev_count[sensor]);
+}
+
+float telemetryControl::Decompressor::readSensorFloat(int sensor){
+    if(readBits(1) == 0){
+        return floatOf(prev_sens[sensor]);
+    }
+
+    if(readBits(1) == 1){
+        //new window
+        prev_leading[sensor] = readBits(5);
+        int length = readBits(5) + 1;
+        if(prev_leading[sensor] + length > 32) length = 32 - prev_leading[sensor]; //corrupt window
+        prev_trailing[sensor] = 32 - prev_leading[sensor] - length;
+    }
+
+    int length = 32 - prev_leading[sensor] - prev_trailing[sensor];
+    prev_sens[sensor] ^= (uint32_t)readBits(length) << prev_trailing[sensor];
+
+    return floatOf(prev_sens[sensor]);
+}
+
+bool telemetryControl::Decompressor::next(Telemetry *capture){
+    float temperature[numSensors];
+
+    if(index >= count){
+        return false;
+    }
+
+    if(index == 0){
+        prev_time = readBits(64);
+        prev_duty = readBits(8);
+        prev_period = readBits(32);
+
+        for(int i = 0; i < numSensors; i++){
+            if(version == blockVersionFloat){
+                prev_sens[i] = readBits(32);
+                prev_leading[i] = windowNone;
+                temperature[i] = floatOf(prev_sens[i]);
+            }
+            else{
+                prev_count[i] = (int16_t)readBits(16);
+                temperature[i] = CountToTemp(prev_count[i]);
+            }
+        }
+
+        prev_delta = 0;
+    }
+    else{
+        //time
+        int64_t dod;
+        if(readBits(1) == 0) dod = 0;
+        else if(readBits(1) == 0) dod = signExtend(readBits(14), 14);
+        else if(readBits(1) == 0) dod = signExtend(readBits(20), 20);
+        else if(readBits(1) == 0) dod = signExtend(readBits(32), 32);
+        else dod = readBits(64);
+
+        prev_delta += dod;
+        prev_time += prev_delta;
+
+        //pwm
+        if(readBits(1)) prev_duty = readBits(8);
+        if(readBits(1)) prev_period = readBits(32);
+
+        //temp
+        for(int i = 0; i < numSensors; i++){
+            temperature[i] = readSensor(i);
+        }
+    }
+
+    if(position > blockPayloadBits){
+        //count in header does not match the bit stream
+        count = 0;
+        return false;
+    }
+
+    capture->setTime(prev_time / 1000000, prev_time % 1000000);
+    capture->setPWM(prev_duty, floatOf(prev_period));
+    for(int i = 0; i < numSensors; i++){
+        capture->setTemp(i, temperature[i]);
+    }
+
+    index++;
+    return true;
+}
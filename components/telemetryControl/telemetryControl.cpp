@@ -19,111 +19,322 @@ telemetryControl::Telemetry::Telemetry(){
     srand(epoch()); //random seed for testing
 }
 
-void telemetryControl::Telemetry::ToCSV(char *LineChar){
-    char Line[sizeLine]; // "<time>,<pwm>,<temp>\n\0"
-    char TimeBuffer[sizeTime]; // "<sec>,<usec>\0"
-    char PWMBuffer[sizePWM]; // "<pwm0>,<pwm1>,...\0"
-    char TempBuffer[sizeTemp]; // "<sens0>,<sens1>,...\0"
+/* CSV cell formatting
+ * Cells are written straight into the destination, left to right, and stop
+ * at [end]. This reproduces snprintf(buffer, size, ...) truncation where
+ * end = cell + size - 1, so output matches the printf based format exactly. */
+
+static int countDigits(uint64_t value){
+    int digits = 1;
+    while(value >= 10){
+        value /= 10;
+        digits++;
+    }
+    return digits;
+}
 
-    //time
-    TimeToCSV(TimeBuffer);
-    strcpy(Line, TimeBuffer);
+// value as [digits] zero-padded decimal digits
+static char *putDigits(char *out, char *end, uint64_t value, int digits){
+    char *last = out + digits;
+
+    for(char *pos = last; pos > out; value /= 10){
+        if(--pos < end) *pos = '0' + (value % 10);
+    }
 
-    strncat(Line, ",", 2);
+    return last < end ? last : end;
+}
 
-    //PWM
-    PWMToCSV(PWMBuffer);
-    strncat(Line, PWMBuffer, sizePWM);
+static char *putChar(char *out, char *end, char c){
+    if(out < end) *out++ = c;
+    return out;
+}
+
+// "%.<precision>lu"
+static char *putUnsigned(char *out, char *end, unsigned long value, int precision){
+    int digits = countDigits(value);
+    return putDigits(out, end, value, digits > precision ? digits : precision);
+}
+
+// "%<width>i"
+static char *putInt(char *out, char *end, int value, int width){
+    uint64_t magnitude = value < 0 ? -(int64_t)value : value;
+    int digits = countDigits(magnitude);
+
+    for(int pad = width - digits - (value < 0); pad > 0; pad--){
+        out = putChar(out, end, ' ');
+    }
+    if(value < 0) out = putChar(out, end, '-');
+
+    return putDigits(out, end, magnitude, digits);
+}
 
-    strncat(Line, ",", 2);
+// "%<width>f"; fixed point in micro-units, rounded half to even like printf
+static char *putFloat(char *out, char *end, float value, int width){
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool negative = bits >> 31;
+    int exponent = (bits >> 23) & 0xFF;
+    uint64_t mantissa = bits & 0x7FFFFF;
+
+    if(exponent == 0xFF || exponent > 150 + 19){
+        //nan, inf and magnitudes over 2^43 are outside the fixed point range
+        char buffer[64];
+        int ret = snprintf(buffer, sizeof(buffer), "%*f", width, value);
+        for(int i = 0; i < ret && buffer[i] != '\0'; i++){
+            out = putChar(out, end, buffer[i]);
+        }
+        return out;
+    }
+
+    //value = mantissa * 2^shift
+    int shift;
+    if(exponent == 0) shift = -149; //subnormal
+    else {
+        mantissa |= 0x800000;
+        shift = exponent - 150;
+    }
+
+    uint64_t micro; //value * 10^6, rounded
+    if(shift >= 0){
+        micro = (mantissa << shift) * 1000000;
+    }
+    else if(-shift > 45){
+        micro = 0; //below half a micro-unit
+    }
+    else {
+        uint64_t scaled = mantissa * 1000000;
+        uint64_t half = (uint64_t)1 << (-shift - 1);
+        uint64_t remainder = scaled & ((half << 1) - 1);
+
+        micro = scaled >> -shift;
+        if(remainder > half || (remainder == half && (micro & 1))) micro++;
+    }
+
+    uint64_t whole = micro / 1000000;
+    int digits = countDigits(whole);
+
+    for(int pad = width - (digits + 7 + negative); pad > 0; pad--){
+        out = putChar(out, end, ' ');
+    }
+    if(negative) out = putChar(out, end, '-');
+
+    out = putDigits(out, end, whole, digits);
+    out = putChar(out, end, '.');
+    return putDigits(out, end, micro % 1000000, 6);
+}
+
+/* CSV cells; widths and precisions match the original printf formats */
+
+static char *putSeconds(char *out, unsigned long seconds){
+    return putUnsigned(out, out + telemetryControl::sizeEpoch - 1, seconds, 10); // "%.10lu"
+}
+
+static char *putMicroSeconds(char *out, unsigned long micro){
+    return putUnsigned(out, out + telemetryControl::sizeMicroSecond - 1, micro, 6); // "%.6lu"
+}
+
+static char *putSensor(char *out, float temperature){
+    return putFloat(out, out + telemetryControl::sizeSensor - 1, temperature, 7); // "%7f"
+}
+
+static char *putPWMDuty(char *out, int duty){
+    return putInt(out, out + telemetryControl::sizePWMDuty - 1, duty, 3); // "%3i"
+}
+
+static char *putPWMPeriod(char *out, float period){
+    return putFloat(out, out + telemetryControl::sizePWMPeriod - 1, period, 4); // "%4f"
+}
+
+int telemetryControl::Telemetry::ToCSV(char *LineChar){
+    char *pos = LineChar; // "<time>,<pwm>,<temp>\n\0"
+
+    //time
+    pos = putSeconds(pos, Seconds);
+    *pos++ = ',';
+    pos = putMicroSeconds(pos, uSeconds);
+    *pos++ = ',';
+
+    //PWM
+    pos = putPWMDuty(pos, pwm_Duty);
+    *pos++ = ',';
+    pos = putPWMPeriod(pos, pwm_Period);
 
     //temp
-    TempToCSV(TempBuffer);
-    strncat(Line, TempBuffer, sizeTemp);
+    for(int i = 0; i < numSensors; i++){
+        *pos++ = ',';
+        pos = putSensor(pos, Sens[i]);
+    }
 
     //end
-    strncat(Line,"\n",2); // end line
-    strcpy(LineChar, Line);
+    *pos++ = '\n';
+    *pos = '\0';
+
+    return pos - LineChar;
 }
 
-void telemetryControl::Telemetry::TimeToCSV(char *TimeChar){
-    char Buffer[sizeTime]; // "<sec>,<usec>\0"
-    char SecBuffer[sizeEpoch]; // "<sec>\0"
-    char uSecBuffer[sizeMicroSecond]; // "<usec>\0"
+/* CSV cells read back. Cells are truncated, not rounded, so a cell is read as
+ * the middle of the values that print as it; written again it gives the same
+ * cell. */
 
-    TimeToCSV(SecBuffer, uSecBuffer);
+static float getFloat(const char *cell, char **end){
+    double value = strtod(cell, end);
+    const char *point = (const char *)memchr(cell, '.', *end - cell);
 
-    snprintf(Buffer, sizeTime, "%s,%s",SecBuffer, uSecBuffer);
-    strcpy(TimeChar, Buffer);
+    if(point != NULL && isfinite(value)){
+        int decimals = *end - point - 1;
+        value += copysign(0.5 * pow(10, -decimals), value);
+    }
+    return (float)value;
 }
 
-void telemetryControl::Telemetry::TimeToCSV(char *SecondsChar, char*uSecondsChar){
-    char Buffer[sizeEpoch]; // "<sec>\0"
-    char uBuffer[sizeMicroSecond]; // <usec>\0
-  
-    int ret = snprintf(Buffer, sizeEpoch, "%.10lu", Seconds); // todo: add definitions
-    if(ret > 0){
-        strcpy(SecondsChar, Buffer);
+bool telemetryControl::Telemetry::FromCSV(const char *LineChar){
+    const char *cell = LineChar;
+    char *end;
+
+    //only sample lines start with the seconds cell
+    if(*cell < '0' || *cell > '9'){
+        return false;
+    }
+
+    unsigned long seconds = strtoul(cell, &end, 10);
+    if(end == cell || *end != ','){
+        return false;
+    }
+
+    cell = end + 1;
+    unsigned long micro = strtoul(cell, &end, 10);
+    if(end == cell || *end != ','){
+        return false;
+    }
+
+    cell = end + 1;
+    int duty = strtol(cell, &end, 10);
+    if(end == cell || *end != ','){
+        return false;
+    }
+
+    cell = end + 1;
+    float period = getFloat(cell, &end);
+    if(end == cell){
+        return false;
     }
 
-    ret = snprintf(uBuffer, sizeMicroSecond, "%.6lu", uSeconds); // todo: add definitions
-    if(ret > 0){
-        strcpy(uSecondsChar, uBuffer);
+    float temperature[numSensors];
+    for(int i = 0; i < numSensors; i++){
+        if(*end != ','){
+            return false;
+        }
+
+        cell = end + 1;
+        temperature[i] = getFloat(cell, &end);
+        if(end == cell){
+            return false;
+        }
+    }
+
+    //end of the line, or the journal columns
+    if(*end != '\0' && *end != '\n' && *end != ','){
+        return false;
     }
+
+    Seconds = seconds;
+    uSeconds = micro;
+    pwm_Duty = duty;
+    pwm_Period = period;
+    memcpy(Sens, temperature, sizeof(Sens));
+
+    return true;
 }
 
-void telemetryControl::Telemetry::TempToCSV(char *TempChar){
-    char Buffer[sizeTemp]; // "<sens0>,<sens1>,...\0"
+void telemetryControl::Telemetry::TimeToCSV(char *TimeChar){
+    char *pos = putSeconds(TimeChar, Seconds); // "<sec>,<usec>\0"
+    *pos++ = ',';
+    pos = putMicroSeconds(pos, uSeconds);
+    *pos = '\0';
+}
 
-    volatile int dst_size = sizeSensor; //workaround for gcc format-truncation warning
-    snprintf(Buffer, dst_size, "%7f", Sens[0]);
+void telemetryControl::Telemetry::TimeToCSV(char *SecondsChar, char*uSecondsChar){
+    *putSeconds(SecondsChar, Seconds) = '\0';
+    *putMicroSeconds(uSecondsChar, uSeconds) = '\0';
+}
+
+void telemetryControl::Telemetry::TempToCSV(char *TempChar){
+    char *pos = putSensor(TempChar, Sens[0]); // "<sens0>,<sens1>,...\0"
 
     for(int i=1; i<numSensors; i++){
-        char SensBuffer[sizeSensor];
-        char CellBuffer[sizeSensor+1];
-        
-        TempToCSV(SensBuffer, i);
-        snprintf(CellBuffer, sizeSensor+1, ",%s",SensBuffer);
-        strncat(Buffer, CellBuffer, sizeSensor+1);
+        *pos++ = ',';
+        pos = putSensor(pos, Sens[i]);
     }
 
-    strcpy(TempChar, Buffer);
+    *pos = '\0';
 }
 
 void telemetryControl::Telemetry::TempToCSV(char *CellChar, int channel){
-    char Buffer[sizeSensor];
-    
-    int ret = snprintf(Buffer, sizeSensor, "%7f", Sens[channel]); // todo: add definitions
-
-    if(ret > 0){
-        strcpy(CellChar, Buffer);
-    }
+    *putSensor(CellChar, Sens[channel]) = '\0';
 }
 
 void telemetryControl::Telemetry::PWMToCSV(char *PWMChar){
-    char Buffer[sizePWM]; // "<duty>,<period>\0"
-    char DutyBuffer[sizePWMDuty]; // "<duty>\0"
-    char PeriodBuffer[sizePWMPeriod]; // "<period>\0"
+    char *pos = putPWMDuty(PWMChar, pwm_Duty); // "<duty>,<period>\0"
+    *pos++ = ',';
+    pos = putPWMPeriod(pos, pwm_Period);
+    *pos = '\0';
+}
+
+void telemetryControl::Telemetry::PWMToCSV(char *DutyChar, char*PeriodChar){
+    *putPWMDuty(DutyChar, pwm_Duty) = '\0';
+    *putPWMPeriod(PeriodChar, pwm_Period) = '\0';
+}
+
+void telemetryControl::Telemetry::ToRecord(Record *record){
+    record->version = recordVersion;
+    record->pwm_Duty = (uint8_t)pwm_Duty;
+    float period = pwm_Period * recordPeriodScale;
+    if(!(period > 0)) record->pwm_Period = 0;
+    else if(period >= UINT16_MAX) record->pwm_Period = UINT16_MAX; //periods over 655.35 seconds saturate
+    else record->pwm_Period = (uint16_t)lroundf(period);
+    record->Seconds = (uint32_t)Seconds;
+    record->uSeconds = (uint32_t)uSeconds;
 
-    PWMToCSV(DutyBuffer, PeriodBuffer);
+    for(int i = 0; i < numSensors; i++){
+        record->Sens[i] = TempToCount(Sens[i]);
+    }
 
-    snprintf(Buffer, sizePWM, "%s,%s",DutyBuffer, PeriodBuffer);
-    strcpy(PWMChar, Buffer);
+    record->crc = esp_rom_crc16_le(0, (const uint8_t *)record, sizeRecord - sizeof(record->crc));
 }
 
-void telemetryControl::Telemetry::PWMToCSV(char *DutyChar, char*PeriodChar){
-    char DutyBuffer[sizeEpoch]; // "<duty>\0"
-    char PeriodBuffer[sizeMicroSecond]; // <period>\0
+bool telemetryControl::Telemetry::FromRecord(const Record *record){
+    if(record->version != recordVersion){
+        return false;
+    }
 
-    int ret = snprintf(DutyBuffer, sizePWMDuty, "%3i", pwm_Duty); // todo: add definitions
-    if(ret > 0){
-        strcpy(DutyChar, DutyBuffer);
+    if(record->crc != esp_rom_crc16_le(0, (const uint8_t *)record, sizeRecord - sizeof(record->crc))){
+        return false;
     }
 
-    ret = snprintf(PeriodBuffer, sizePWMPeriod, "%4f", pwm_Period); // todo: add definitions
-    if(ret > 0){
-        strcpy(PeriodChar, PeriodBuffer);
+    Seconds = record->Seconds;
+    uSeconds = record->uSeconds;
+    pwm_Duty = record->pwm_Duty;
+    pwm_Period = record->pwm_Period / recordPeriodScale;
+
+    for(int i = 0; i < numSensors; i++){
+        Sens[i] = CountToTemp(record->Sens[i]);
     }
+
+    return true;
+}
+
+int16_t telemetryControl::TempToCount(float temperature){
+    float scaled = temperature * recordTempScale;
+
+    if(isnan(scaled)) return recordTempInvalid;
+    if(scaled >= INT16_MAX) return INT16_MAX;
+    if(scaled <= INT16_MIN + 1) return INT16_MIN + 1; //keep clear of recordTempInvalid
+    return (int16_t)lroundf(scaled);
+}
+
+float telemetryControl::CountToTemp(int16_t count){
+    return count == recordTempInvalid ? NAN : count / recordTempScale;
 }
 
 void telemetryControl::Telemetry::headerCSV(char *LineChar){
@@ -142,11 +353,85 @@ void telemetryControl::Telemetry::headerCSV(char *LineChar){
         strcat(LineBuffer, buffer);
     }
 
+    //journal
+    strcat(LineBuffer, ",log_Seq,log_CRC");
+
     strncat(LineBuffer,"\n",2); // end line
     //out
     strcpy(LineChar, LineBuffer);
 }
 
+static int hexValue(char c){
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int telemetryControl::JournalCSV(char *LineChar, int length, uint32_t sequence){
+    static const char hex[] = "0123456789ABCDEF";
+    char *pos = LineChar + length - 1; // over the newline
+    char *end = LineChar + sizeJournalLine - 1;
+
+    //sequence
+    *pos++ = ',';
+    pos = putUnsigned(pos, end, sequence, 1);
+    *pos++ = ',';
+
+    //crc of the line up to here
+    uint16_t crc = esp_rom_crc16_le(0, (const uint8_t *)LineChar, pos - LineChar);
+    for(int shift = 12; shift >= 0; shift -= 4){
+        *pos++ = hex[(crc >> shift) & 0xF];
+    }
+
+    //end
+    *pos++ = '\n';
+    *pos = '\0';
+
+    return pos - LineChar;
+}
+
+bool telemetryControl::CheckCSV(const char *LineChar, int length, uint32_t *sequence_out){
+    if(length < 1 || LineChar[length - 1] != '\n'){
+        return false; //torn
+    }
+
+    //journal columns end the line: ",<digits>,<4 hex digits>\n"
+    int crc_start = length - 1 - sizeJournalCRC;
+    bool journaled = crc_start > 1 && LineChar[crc_start - 1] == ',';
+    uint16_t crc = 0;
+
+    for(int i = crc_start; journaled && i < length - 1; i++){
+        int value = hexValue(LineChar[i]);
+        journaled = value >= 0;
+        crc = (crc << 4) | value;
+    }
+
+    int sequence_start = crc_start - 1;
+    while(journaled && sequence_start > 0 && LineChar[sequence_start - 1] >= '0' && LineChar[sequence_start - 1] <= '9'){
+        sequence_start--;
+    }
+    journaled = journaled && sequence_start > 0 && sequence_start < crc_start - 1 && LineChar[sequence_start - 1] == ',';
+
+    if(!journaled){
+        //only the header has no journal columns; it does not start with a time
+        if(LineChar[0] >= '0' && LineChar[0] <= '9') return false;
+
+        for(int i = 0; i < length - 1; i++){
+            if(LineChar[i] < ' ' || LineChar[i] > '~') return false;
+        }
+        return true;
+    }
+
+    if(crc != esp_rom_crc16_le(0, (const uint8_t *)LineChar, crc_start)){
+        return false;
+    }
+
+    if(sequence_out != NULL){
+        *sequence_out = strtoul(LineChar + sequence_start, NULL, 10);
+    }
+    return true;
+}
+
 void telemetryControl::Telemetry::clear(){
     Seconds = 0;
     uSeconds = 0;
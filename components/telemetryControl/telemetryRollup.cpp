@@ -0,0 +1,113 @@
+/**
+ * @file telemetryRollup.cpp
+ * @author Benjamin Navin (bnjames@cpp.edu)
+ *
+ * @brief Implementation of Rollup
+**/
+
+#include "telemetryRollup.h"
+
+// temperature as Record stores it
+static int16_t fixedOf(float temperature){
+    float scaled = temperature * telemetryControl::recordTempScale;
+
+    if(scaled >= INT16_MAX) return INT16_MAX;
+    if(scaled <= INT16_MIN + 1) return INT16_MIN + 1; //keep clear of recordTempInvalid
+    return (int16_t)lroundf(scaled);
+}
+
+telemetryControl::Rollup::Rollup(uint8_t rollup_tier, uint16_t window_period, rollup_sink_t rollup_sink){
+    tier = rollup_tier;
+    period = window_period > 0 ? window_period : 1;
+    sink = rollup_sink;
+    sealed = 0;
+
+    reset();
+}
+
+void telemetryControl::Rollup::reset(){
+    window = 0;
+    count = 0;
+
+    for(int i = 0; i < numSensors; i++){
+        min[i] = 0;
+        max[i] = 0;
+        sum[i] = 0;
+        valid[i] = 0;
+    }
+}
+
+void telemetryControl::Rollup::append(const Telemetry *capture){
+    uint32_t start = (uint32_t)capture->Seconds - (uint32_t)capture->Seconds % period;
+
+    if(count > 0 && (start != window || count == UINT16_MAX)){
+        flush();
+    }
+    if(count == 0){
+        window = start;
+    }
+
+    for(int i = 0; i < numSensors; i++){
+        float temperature = capture->Sens[i];
+        if(isnan(temperature)){
+            continue;
+        }
+
+        if(valid[i] == 0 || temperature < min[i]) min[i] = temperature;
+        if(valid[i] == 0 || temperature > max[i]) max[i] = temperature;
+        sum[i] += temperature;
+        valid[i]++;
+    }
+    count++;
+}
+
+void telemetryControl::Rollup::flush(){
+    RollupRecord record;
+
+    if(count == 0){
+        return;
+    }
+
+    fill(&record);
+    reset();
+
+    sealed++;
+    if(sink != NULL) sink(&record);
+}
+
+bool telemetryControl::Rollup::peek(RollupRecord *record){
+    if(count == 0){
+        return false;
+    }
+
+    fill(record);
+    return true;
+}
+
+void telemetryControl::Rollup::fill(RollupRecord *record){
+    record->version = rollupVersion;
+    record->tier = tier;
+    record->count = count;
+    record->Seconds = window;
+    record->period = period;
+
+    for(int i = 0; i < numSensors; i++){
+        if(valid[i] == 0){
+            record->Min[i] = recordTempInvalid;
+            record->Max[i] = recordTempInvalid;
+            record->Mean[i] = recordTempInvalid;
+            continue;
+        }
+
+        record->Min[i] = fixedOf(min[i]);
+        record->Max[i] = fixedOf(max[i]);
+        record->Mean[i] = fixedOf(sum[i] / valid[i]);
+    }
+
+    record->crc = esp_rom_crc16_le(0, (const uint8_t *)record, sizeRollup - sizeof(record->crc));
+}
+
+bool telemetryControl::CheckRollup(const RollupRecord *record){
+    return record->version == rollupVersion
+        && record->crc == esp_rom_crc16_le(0, (const uint8_t *)record, sizeRollup - sizeof(record->crc));
+}
@@ -0,0 +1,69 @@
+/**
+ * @file adcSweep_test.cpp
+ *
+ * @brief Checks that a sampleAll() sweep reads every sensor on its own channel
+ * and agrees with sample() of each sensor, with fewer reads, on the fake ADC
+**/
+
+#include "adcControl.h"
+#include "fakeAdc.h"
+#include "hostTest.h"
+
+using adcControl::numSensors;
+using adcControl::numSamples;
+
+//channel of each sensor on its unit; adc2 channel 1 and 3 are not used
+static const int channels[numSensors] = {0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 4, 5, 6, 7, 8, 9};
+
+int main(){
+    const float tolerance = 0.5f; //degrees; the noise averaged plus the table error
+    adcControl::adc sensor;
+    float swept[numSensors];
+
+    sensor.init();
+    CHECK(sensor.isReady());
+
+    //one sweep
+    int start = fake_adc_reads();
+    sensor.sampleAll(swept);
+    int sweep_reads = fake_adc_reads() - start;
+
+    //each sensor on its own
+    float sampled[numSensors];
+    start = fake_adc_reads();
+    for(int i = 0; i < numSensors; i++){
+        sampled[i] = sensor.sample(i);
+    }
+    int sample_reads = fake_adc_reads() - start;
+
+    for(int i = 0; i < numSensors; i++){
+        float expected = fake_adc_temperature(i < 8 ? 0 : 1, channels[i]);
+
+        CHECK(isfinite(swept[i]) && isfinite(sampled[i]));
+        CHECK(fabsf(swept[i] - sampled[i]) <= tolerance);
+        CHECK(fabsf(swept[i] - expected) <= tolerance);
+        CHECK(fabsf(sampled[i] - expected) <= tolerance);
+        if(fabsf(swept[i] - sampled[i]) > tolerance || fabsf(swept[i] - expected) > tolerance){
+            printf("sensor %i: swept %.2f, sampled %.2f, expected %.2f\n", i, swept[i], sampled[i], expected);
+        }
+    }
+
+    //neighbouring channels are further apart than the tolerance, so a sensor read on the wrong channel fails above
+    for(int i = 1; i < numSensors; i++){
+        CHECK(fabsf(fake_adc_temperature(i < 8 ? 0 : 1, channels[i]) - fake_adc_temperature(i - 1 < 8 ? 0 : 1, channels[i - 1])) > 2 * tolerance);
+    }
+
+    //one discarded read per channel, instead of one per sample
+    CHECK(sweep_reads == numSensors * (numSamples + 1));
+    CHECK(sample_reads == numSensors * numSamples * 2);
+    printf("reads per sweep: %i, per sensor sampling: %i\n", sweep_reads, sample_reads);
+
+    //sweeping again reads the same
+    float again[numSensors];
+    sensor.sampleAll(again);
+    for(int i = 0; i < numSensors; i++){
+        CHECK(fabsf(again[i] - swept[i]) <= tolerance);
+    }
+
+    return host_test_result();
+}
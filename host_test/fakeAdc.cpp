@@ -0,0 +1,95 @@
+/**
+ * @file fakeAdc.cpp
+ *
+ * @brief Fake ADC driver and calibration the adcControl host tests link
+ * against, in place of esp_adc
+**/
+
+#include "fakeAdc.h"
+
+/* Fake ADC. Each channel holds a level of its own, read with a little noise
+ * that repeats every few reads. The first read after switching channel is
+ * off, as the sample and hold has not settled; both sample() and sampleAll()
+ * must discard it. The calibration is the line fitting model of
+ * thermistorTable_test, with different coefficients on each unit so a sensor
+ * converted on the wrong unit's table shows. */
+
+struct adc_oneshot_unit_ctx_t{
+    int unit;
+    int channel; //last channel read, -1 for none
+    int noise; //next entry of noise
+    int reads;
+};
+
+struct adc_cali_scheme_t{
+    uint32_t coeff_a;
+    uint32_t coeff_b;
+};
+
+static adc_oneshot_unit_ctx_t units[2];
+static adc_cali_scheme_t schemes[2] = {{53047, 142}, {53500, 128}};
+
+static const int noise[] = {0, 3, -3, 1, -1, 2};
+constexpr int unsettled = 400; //added to the first read after switching channel
+
+int fake_adc_level(int unit, int channel){
+    return 1200 + unit * 800 + channel * 90;
+}
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *init_config, adc_oneshot_unit_handle_t *ret_unit){
+    adc_oneshot_unit_ctx_t *unit = &units[init_config->unit_id == ADC_UNIT_1 ? 0 : 1];
+
+    unit->unit = init_config->unit_id == ADC_UNIT_1 ? 0 : 1;
+    unit->channel = -1;
+    unit->noise = 0;
+    unit->reads = 0;
+    *ret_unit = unit;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t, adc_channel_t, const adc_oneshot_chan_cfg_t *){
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t handle, adc_channel_t chan, int *out_raw){
+    int raw = fake_adc_level(handle->unit, chan) + noise[handle->noise];
+
+    handle->noise = (handle->noise + 1) % (int)(sizeof(noise) / sizeof(noise[0]));
+    if(handle->channel != chan) raw += unsettled;
+    handle->channel = chan;
+    handle->reads++;
+
+    *out_raw = raw;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t){
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *config, adc_cali_handle_t *ret_handle){
+    *ret_handle = &schemes[config->unit_id == ADC_UNIT_1 ? 0 : 1];
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_delete_scheme_line_fitting(adc_cali_handle_t){
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage){
+    *voltage = (int)((uint64_t)raw * handle->coeff_a / 65536 + handle->coeff_b);
+    return ESP_OK;
+}
+
+float fake_adc_temperature(int unit, int channel){
+    const float r_inf = adcControl::thermistorNominal*exp((-adcControl::bCoefficient)/(adcControl::kelvin+adcControl::temperatureNominal));
+    int voltage;
+
+    adc_cali_raw_to_voltage(&schemes[unit], fake_adc_level(unit, channel), &voltage);
+    float resistance = ((adcControl::thermistorNominal*adcControl::supplyVoltage)/voltage)-adcControl::thermistorNominal;
+    return (adcControl::bCoefficient/log(resistance/r_inf))-adcControl::kelvin;
+}
+
+int fake_adc_reads(){
+    return units[0].reads + units[1].reads;
+}
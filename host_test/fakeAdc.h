@@ -0,0 +1,37 @@
+/**
+ * @file fakeAdc.h
+ *
+ * @brief Fake ADC the adcControl host tests run on, see fakeAdc.cpp
+**/
+
+#ifndef _fakeAdc_H_included
+#define _fakeAdc_H_included
+
+#include "adcControl.h"
+
+/**
+ * @brief Get the level of a channel of the fake ADC
+ *
+ * @param unit 0 for adc1, 1 for adc2
+ * @param channel channel of the unit
+ * @return int raw reading, before noise
+ */
+int fake_adc_level(int unit, int channel);
+
+/**
+ * @brief Get the temperature of a channel's level, through its unit's calibration
+ *
+ * @param unit 0 for adc1, 1 for adc2
+ * @param channel channel of the unit
+ * @return float degrees C
+ */
+float fake_adc_temperature(int unit, int channel);
+
+/**
+ * @brief Get the reads of both units since start
+ *
+ * @return int oneshot reads
+ */
+int fake_adc_reads();
+
+#endif // _fakeAdc_H_included
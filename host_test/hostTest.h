@@ -0,0 +1,45 @@
+/**
+ * @file hostTest.h
+ * 
+ * @brief Checks and timing shared by the host tests
+**/
+
+#ifndef _hostTest_H_included
+#define _hostTest_H_included
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int host_test_failures = 0;
+
+//records a failure and carries on, so one run reports every broken case
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        host_test_failures++; \
+    } \
+} while(0)
+
+/**
+ * @brief Get a monotonic time for benchmarks
+ * 
+ * @return int64_t nanoseconds
+ */
+static inline int64_t host_test_now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Prints the result of a test program
+ * 
+ * @return int exit code; 0 if every check passed
+ */
+static inline int host_test_result(){
+    printf(host_test_failures ? "FAILED (%d)\n" : "PASSED\n", host_test_failures);
+    return host_test_failures ? 1 : 0;
+}
+
+#endif // _hostTest_H_included
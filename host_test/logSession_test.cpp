@@ -0,0 +1,125 @@
+/**
+ * @file logSession_test.cpp
+ *
+ * @brief Checks that a read session resumes at its watermark after a reset,
+ * reads past a line too long for its buffer, and starts over after reset(),
+ * on a .csv log in a directory of the host and NVS kept in RAM
+**/
+
+#include "sessionReader.h"
+#include "hostTest.h"
+
+#include <filesystem>
+#include <string>
+
+using namespace spiffsControl;
+
+static const char *testDir = "logSession_test_files";
+static const char *testLog = "logSession_test_files/exp_log.csv";
+static constexpr uint8_t testTag = 0x01;
+static constexpr int testLines = 10;
+static constexpr int longLine = 4; //line longer than the session's line buffer
+
+static std::string lineOf(int number){
+    if(number == longLine) return std::string(readerLineSize + 100, 'x');
+    return "1700000000," + std::to_string(number);
+}
+
+/**
+ * @brief Log of one stream, as set up at boot
+ */
+struct bootedLog{
+    logSegments segments{testLog};
+    logStream stream{testTag, &segments};
+
+    bootedLog(){
+        segments.scan();
+    }
+};
+
+/**
+ * @brief Reads the next line of a session
+ *
+ * @return std::string line, "" if none
+ */
+static std::string readNext(sessionReader *reader){
+    lineSpan line;
+    return reader->readNext(&line) ? std::string(line.data, line.size) : "";
+}
+
+int main(){
+    std::filesystem::remove_all(testDir);
+    std::filesystem::create_directory(testDir);
+
+    {
+        bootedLog log;
+        for(int i = 0; i < testLines; i++){
+            std::string line = lineOf(i) + "\n";
+            CHECK(log.stream.getRing()->append(line.data(), line.size()));
+        }
+        CHECK(log.stream.getRing()->flush());
+
+        //a new session starts at the first line
+        sessionReader reader;
+        CHECK(reader.load(0, 0, &log.stream) == ESP_OK);
+        CHECK(reader.getWatermark() == 0);
+        CHECK(readNext(&reader) == lineOf(0));
+        CHECK(readNext(&reader) == lineOf(1));
+        CHECK(readNext(&reader) == lineOf(2));
+        CHECK(reader.commit() == ESP_OK);
+        CHECK(reader.getWatermark() == 3);
+
+        //read but never acknowledged
+        CHECK(readNext(&reader) == lineOf(3));
+
+        //a line too long for the buffer is cut short, and the next line is read whole
+        std::string cut = readNext(&reader);
+        CHECK(cut.size() == readerLineSize - 1 && cut == lineOf(longLine).substr(0, cut.size()));
+        CHECK(readNext(&reader) == lineOf(5));
+
+        //another session keeps its own watermark
+        sessionReader other;
+        CHECK(other.load(1, 0, &log.stream) == ESP_OK);
+        CHECK(readNext(&other) == lineOf(0));
+        CHECK(other.commit() == ESP_OK);
+    }
+
+    //after a reset the session resumes at its watermark, not where it stopped reading
+    {
+        bootedLog log;
+        sessionReader reader;
+        CHECK(reader.load(0, 0, &log.stream) == ESP_OK);
+        CHECK(reader.getWatermark() == 3);
+        CHECK(readNext(&reader) == lineOf(3));
+        readNext(&reader);
+        CHECK(readNext(&reader) == lineOf(5));
+
+        for(int i = 6; i < testLines; i++){
+            CHECK(readNext(&reader) == lineOf(i));
+        }
+        CHECK(readNext(&reader) == "");
+        CHECK(reader.commit() == ESP_OK);
+        CHECK(reader.getWatermark() == testLines);
+
+        sessionReader other;
+        CHECK(other.load(1, 0, &log.stream) == ESP_OK);
+        CHECK(other.getWatermark() == 1);
+        CHECK(readNext(&other) == lineOf(1));
+
+        //reset() starts the session over at the first line, also after a reset
+        CHECK(reader.reset() == ESP_OK);
+        CHECK(reader.getWatermark() == 0);
+        CHECK(readNext(&reader) == lineOf(0));
+    }
+
+    {
+        bootedLog log;
+        sessionReader reader;
+        CHECK(reader.load(0, 0, &log.stream) == ESP_OK);
+        CHECK(reader.getWatermark() == 0);
+        CHECK(readNext(&reader) == lineOf(0));
+    }
+
+    std::filesystem::remove_all(testDir);
+    return host_test_result();
+}
@@ -0,0 +1,254 @@
+/**
+ * @file logStore_test.cpp
+ * 
+ * @brief Checks the log store's slot scan at mount, wrap-around, torn slots
+ * and clear markers, on a partition kept in RAM
+**/
+
+#include "logStore.h"
+#include "hostTest.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace spiffsControl;
+
+/**
+ * @brief NOR flash in RAM: erase sets 0xFF, writes only clear bits
+ */
+class ramPartition : public storePartition{
+public:
+    ramPartition(int sectors) : flash(sectors * storeSectorSize, 0x00){
+        erases = 0;
+        tear_next = false;
+    }
+
+    esp_err_t open() override { return ESP_OK; }
+    uint32_t size() override { return flash.size(); }
+
+    esp_err_t read(uint32_t offset, void *data_out, size_t size) override {
+        if(offset + size > flash.size()) return ESP_ERR_INVALID_SIZE;
+        memcpy(data_out, &flash[offset], size);
+        return ESP_OK;
+    }
+
+    esp_err_t write(uint32_t offset, const void *data, size_t size) override {
+        if(offset + size > flash.size()) return ESP_ERR_INVALID_SIZE;
+
+        //power lost part way through: only the start of the slot is programmed
+        if(tear_next){
+            tear_next = false;
+            size = 6;
+        }
+        for(size_t i = 0; i < size; i++){
+            flash[offset + i] &= ((const uint8_t *)data)[i];
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t erase(uint32_t offset, size_t size) override {
+        if(offset % storeSectorSize != 0 || size % storeSectorSize != 0) return ESP_ERR_INVALID_ARG;
+        memset(&flash[offset], 0xFF, size);
+        erases++;
+        return ESP_OK;
+    }
+
+    const uint8_t *map(uint32_t offset, uint32_t size) override {
+        return offset + size <= flash.size() ? &flash[offset] : NULL;
+    }
+    void unmap() override {}
+
+    std::vector<uint8_t> flash;
+    int erases;
+    bool tear_next; //tears the next write
+};
+
+static constexpr int testSectors = 8;
+static constexpr uint8_t testTag = 0x01;
+
+static esp_err_t appendSequence(logStore *store, uint32_t value){
+    uint8_t payload[storePayloadSize];
+    memset(payload, (uint8_t)value, sizeof(payload));
+    memcpy(payload, &value, sizeof(value));
+    return store->append(payload, sizeof(payload), testTag);
+}
+
+//every stored record reads back with its own sequence number, and nothing older does
+static bool readsBack(logStore *store){
+    uint8_t payload[storePayloadSize];
+    size_t size;
+    uint8_t tag;
+
+    if(store->getOldest() > 0 && store->read(store->getOldest() - 1, payload) != ESP_ERR_NOT_FOUND) return false;
+    if(store->read(store->getNext(), payload) != ESP_ERR_NOT_FOUND) return false;
+
+    for(uint32_t sequence = store->getOldest(); sequence < store->getNext(); sequence++){
+        esp_err_t ret = store->read(sequence, payload, &size, &tag);
+        if(ret == ESP_ERR_INVALID_CRC) continue; //torn slot
+        if(ret != ESP_OK || size != storePayloadSize || tag != testTag) return false;
+
+        uint32_t value;
+        memcpy(&value, payload, sizeof(value));
+        if(value != sequence) return false;
+    }
+    return true;
+}
+
+static void testFreshAndRemount(){
+    ramPartition flash(testSectors);
+    logStore store(&flash);
+
+    CHECK(store.mount() == ESP_OK);
+    CHECK(store.getNext() == 0);
+    CHECK(store.getOldest() == 0);
+    CHECK(store.getCapacity() == testSectors * storeSlotsPerSector);
+
+    for(uint32_t i = 0; i < 100; i++){
+        CHECK(appendSequence(&store, i) == ESP_OK);
+    }
+    CHECK(store.getNext() == 100);
+    CHECK(readsBack(&store));
+
+    //the scan finds the head from the slots alone
+    logStore again(&flash);
+    CHECK(again.mount() == ESP_OK);
+    CHECK(again.getNext() == 100);
+    CHECK(again.getOldest() == 0);
+    CHECK(readsBack(&again));
+}
+
+static void testWrap(){
+    ramPartition flash(testSectors);
+    logStore store(&flash);
+    CHECK(store.mount() == ESP_OK);
+
+    const uint32_t total = store.getCapacity() * 3 + 37;
+    for(uint32_t i = 0; i < total; i++){
+        CHECK(appendSequence(&store, i) == ESP_OK);
+    }
+
+    //the oldest sectors were erased and reused; the erased sectors ahead hold nothing
+    uint32_t kept = store.getNext() - store.getOldest();
+    CHECK(store.getNext() == total);
+    CHECK(kept <= store.getCapacity() - storeSlotsPerSector);
+    CHECK(kept > store.getCapacity() - (storeEraseAhead + 2) * storeSlotsPerSector);
+    CHECK(readsBack(&store));
+
+    logStore again(&flash);
+    CHECK(again.mount() == ESP_OK);
+    CHECK(again.getNext() == store.getNext());
+    CHECK(again.getOldest() == store.getOldest());
+    CHECK(readsBack(&again));
+
+    //appends carry on across the wrap after a remount
+    for(uint32_t i = total; i < total + storeSlotsPerSector * 2; i++){
+        CHECK(appendSequence(&again, i) == ESP_OK);
+    }
+    CHECK(readsBack(&again));
+}
+
+static void testSectorBoundary(){
+    ramPartition flash(testSectors);
+    logStore store(&flash);
+    CHECK(store.mount() == ESP_OK);
+
+    //head exactly at the end of a sector, where mount() has to prepare the next one
+    for(uint32_t i = 0; i < storeSlotsPerSector * 2; i++){
+        CHECK(appendSequence(&store, i) == ESP_OK);
+    }
+
+    logStore again(&flash);
+    CHECK(again.mount() == ESP_OK);
+    CHECK(again.getNext() == storeSlotsPerSector * 2);
+    CHECK(appendSequence(&again, again.getNext()) == ESP_OK);
+    CHECK(readsBack(&again));
+}
+
+static void testTornSlot(){
+    ramPartition flash(testSectors);
+    logStore store(&flash);
+    CHECK(store.mount() == ESP_OK);
+
+    for(uint32_t i = 0; i < 10; i++){
+        CHECK(appendSequence(&store, i) == ESP_OK);
+    }
+    flash.tear_next = true;
+    CHECK(appendSequence(&store, 10) == ESP_OK);
+
+    //the torn slot keeps its sequence number and is never returned
+    logStore again(&flash);
+    CHECK(again.mount() == ESP_OK);
+    CHECK(again.getNext() == 11);
+
+    uint8_t payload[storePayloadSize];
+    CHECK(again.read(10, payload) == ESP_ERR_INVALID_CRC);
+    CHECK(appendSequence(&again, 11) == ESP_OK);
+    CHECK(readsBack(&again));
+}
+
+static void testClear(){
+    ramPartition flash(testSectors);
+    logStore store(&flash);
+    CHECK(store.mount() == ESP_OK);
+
+    for(uint32_t i = 0; i < 70; i++){
+        CHECK(appendSequence(&store, i) == ESP_OK);
+    }
+    CHECK(store.clear() == ESP_OK);
+    CHECK(store.getOldest() == store.getNext());
+
+    uint8_t payload[storePayloadSize];
+    CHECK(store.read(5, payload) == ESP_ERR_NOT_FOUND);
+
+    //the marker outlives a remount
+    logStore again(&flash);
+    CHECK(again.mount() == ESP_OK);
+    CHECK(again.getOldest() == store.getNext());
+    CHECK(again.getNext() == store.getNext());
+
+    uint32_t first = again.getNext();
+    CHECK(appendSequence(&again, first) == ESP_OK);
+    CHECK(again.getOldest() == first); //the marker itself is not a record
+    CHECK(again.read(first, payload) == ESP_OK);
+}
+
+static void testMapAndPreErase(){
+    ramPartition flash(testSectors);
+    logStore store(&flash);
+    CHECK(store.mount() == ESP_OK);
+
+    for(uint32_t i = 0; i < 150; i++){
+        CHECK(appendSequence(&store, i) == ESP_OK);
+    }
+
+    const uint8_t *slots;
+    size_t count = store.map(20, 1000, &slots);
+    CHECK(count == 130);
+    for(size_t i = 0; i < count; i++){
+        const StoreHeader *header = (const StoreHeader *)(slots + i * storeSlotSize);
+        CHECK(header->sequence == 20 + i);
+    }
+    store.unmap();
+
+    //sectors erased in the background leave no erases for the foreground
+    while(store.preErase(4)){
+    }
+    CHECK(store.getErasedAhead() == 4);
+    uint32_t foreground = store.getForegroundErases();
+    for(uint32_t i = 150; i < 150 + storeSlotsPerSector * 3; i++){
+        CHECK(appendSequence(&store, i) == ESP_OK);
+    }
+    CHECK(store.getForegroundErases() == foreground);
+    CHECK(readsBack(&store));
+}
+
+int main(){
+    testFreshAndRemount();
+    testWrap();
+    testSectorBoundary();
+    testTornSlot();
+    testClear();
+    testMapAndPreErase();
+
+    return host_test_result();
+}
@@ -0,0 +1,126 @@
+/**
+ * @file samplingService_test.cpp
+ *
+ * @brief Checks that the sampling service shares its sweeps between readers
+ * at different intervals, sweeps sooner when a reader speeds up, only sweeps
+ * on request with no readers, and leaves the fake ADC alone while the
+ * thermistors are unpowered
+ * @note the service runs on a thread, in real time; counts are checked
+ * against the most a run can take, and a loaded host only takes fewer
+**/
+
+#include "samplingService.h"
+#include "fakeAdc.h"
+#include "hostTest.h"
+
+#include <atomic>
+#include <thread>
+
+using adcControl::numSensors;
+using adcControl::numSamples;
+
+constexpr int fastSlot = 0;
+constexpr int slowSlot = 1;
+constexpr uint32_t fastInterval = 20; //milli-seconds
+constexpr uint32_t slowInterval = 60; //milli-seconds
+constexpr uint32_t runLength = 600; //milli-seconds both readers are subscribed
+constexpr int readsPerSweep = numSensors * (numSamples + 1);
+
+static std::atomic<bool> done;
+static std::atomic<int> wakes[adcControl::maxSubscribers];
+
+/**
+ * @brief Reader of a slot; counts its wake ups until unsubscribed
+ */
+static void reader(adcControl::samplingService *sampler, int slot){
+    while(!done){
+        if(sampler->wait(slot, portMAX_DELAY)) wakes[slot]++;
+    }
+}
+
+static int64_t elapsedMs(int64_t since){
+    return (host_test_now() - since) / 1000000;
+}
+
+int main(){
+    adcControl::adc sensor;
+    adcControl::samplingService sampler(&sensor);
+    adcControl::snapshot sweep;
+
+    sensor.init();
+    sensor.powerOn();
+    CHECK(sampler.start() == ESP_OK);
+
+    //nothing swept before a reader or refresh() asks
+    sampler.latest(&sweep);
+    CHECK(sweep.sequence == 0 && isnan(sweep.temperature[0]));
+
+    //no subscribers: refresh() sweeps once, then the snapshot is fresh for idleSweepInterval
+    int reads = fake_adc_reads();
+    CHECK(sampler.refresh(1000));
+    sampler.latest(&sweep);
+    CHECK(sweep.sequence == 1 && isfinite(sweep.temperature[0]) && sweep.sweep_time > 0);
+    CHECK(fake_adc_reads() - reads == readsPerSweep);
+    CHECK(sampler.refresh(1000));
+    vTaskDelay(100);
+    sampler.latest(&sweep);
+    CHECK(sweep.sequence == 1);
+    CHECK(fake_adc_reads() - reads == readsPerSweep);
+
+    //two readers share the sweeps of the faster one
+    uint32_t first = sweep.sequence;
+    reads = fake_adc_reads();
+    done = false;
+    sampler.subscribe(fastSlot, fastInterval);
+    sampler.subscribe(slowSlot, slowInterval);
+    std::thread fast(reader, &sampler, fastSlot);
+    std::thread slow(reader, &sampler, slowSlot);
+
+    vTaskDelay(runLength);
+    done = true;
+    sampler.unsubscribe(fastSlot); //wakes both readers, blocked without a timeout
+    sampler.unsubscribe(slowSlot);
+    fast.join();
+    slow.join();
+
+    sampler.latest(&sweep);
+    int sweeps = sweep.sequence - first;
+    CHECK(sweeps >= (int)(runLength / fastInterval) / 2);
+    CHECK(sweeps <= (int)(runLength / fastInterval) + 2); //each reader sweeping on its own would be a third more
+    CHECK(fake_adc_reads() - reads == sweeps * readsPerSweep);
+    CHECK(wakes[fastSlot] <= sweeps && wakes[fastSlot] >= sweeps - 2);
+    CHECK(wakes[slowSlot] >= 2 && wakes[slowSlot] <= (int)(runLength / slowInterval) + 2);
+    CHECK(wakes[slowSlot] < wakes[fastSlot]);
+    printf("%i sweeps, %i fast and %i slow wake ups in %i ms\n", sweeps, (int)wakes[fastSlot], (int)wakes[slowSlot], (int)runLength);
+
+    //a reader that speeds up is woken at its new interval, not at the end of its old one
+    sampler.subscribe(fastSlot, 2000);
+    CHECK(sampler.wait(fastSlot, 500)); //first sweep right away
+    int64_t start = host_test_now();
+    sampler.setInterval(fastSlot, fastInterval);
+    CHECK(sampler.wait(fastSlot, 1000));
+    CHECK(elapsedMs(start) < 500);
+    sampler.unsubscribe(fastSlot);
+
+    //unpowered: every sweep is NaN and the ADC is not read
+    sensor.powerOff();
+    reads = fake_adc_reads();
+    first = sweep.sequence;
+    sampler.subscribe(slowSlot, fastInterval);
+    CHECK(sampler.wait(slowSlot, 500));
+    CHECK(sampler.wait(slowSlot, 500));
+    sampler.unsubscribe(slowSlot);
+    sampler.latest(&sweep);
+    CHECK(sweep.sequence > first);
+    CHECK(sweep.sweep_time == 0);
+    for(int i = 0; i < numSensors; i++){
+        CHECK(isnan(sweep.temperature[i]));
+    }
+    CHECK(fake_adc_reads() == reads);
+
+    //returns once the task has ended
+    sampler.stop();
+    CHECK(!sampler.refresh(0));
+
+    return host_test_result();
+}
@@ -0,0 +1,49 @@
+/**
+ * @file gpio.h
+ * 
+ * @brief Host stand-in for the GPIO driver; levels are kept, not driven
+**/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+    GPIO_NUM_18 = 18,
+    GPIO_NUM_MAX = 40,
+} gpio_num_t;
+
+typedef enum {
+    GPIO_MODE_OUTPUT = 2,
+} gpio_mode_t;
+
+typedef enum {
+    GPIO_PULLUP_DISABLE,
+    GPIO_PULLUP_ENABLE,
+} gpio_pullup_t;
+
+typedef enum {
+    GPIO_PULLDOWN_DISABLE,
+    GPIO_PULLDOWN_ENABLE,
+} gpio_pulldown_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE,
+} gpio_int_type_t;
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+static inline esp_err_t gpio_config(const gpio_config_t *){
+    return ESP_OK;
+}
+static inline esp_err_t gpio_set_level(gpio_num_t, uint32_t){
+    return ESP_OK;
+}
@@ -0,0 +1,15 @@
+/**
+ * @file adc_cali.h
+ * 
+ * @brief Host stand-in for the ADC calibration driver; a test that links code
+ * reading the ADC defines these functions as its fake ADC
+**/
+
+#pragma once
+
+#include "esp_err.h"
+#include "hal/adc_types.h"
+
+typedef struct adc_cali_scheme_t *adc_cali_handle_t;
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage);
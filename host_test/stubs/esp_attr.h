@@ -0,0 +1,9 @@
+/**
+ * @file esp_attr.h
+ * 
+ * @brief Host stand-in for the placement attributes; the host has one memory
+**/
+
+#pragma once
+
+#define IRAM_ATTR
@@ -0,0 +1,15 @@
+/**
+ * @file esp_log.h
+ * 
+ * @brief Host stand-in for ESP-IDF logging; errors and warnings are printed
+**/
+
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, format, ...) printf("E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do {} while(0)
+#define ESP_LOGD(tag, format, ...) do {} while(0)
+#define ESP_LOGV(tag, format, ...) do {} while(0)
@@ -0,0 +1,33 @@
+/**
+ * @file esp_rom_crc.h
+ * 
+ * @brief Host stand-in for the ESP32 ROM CRC routines, bit for bit
+**/
+
+#pragma once
+
+#include <stdint.h>
+
+//CRC-16/CCITT, reflected, as the ROM computes it
+static inline uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len){
+    crc = ~crc;
+    for(uint32_t i = 0; i < len; i++){
+        crc ^= buf[i];
+        for(int bit = 0; bit < 8; bit++){
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+//CRC-32, reflected, as the ROM computes it
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len){
+    crc = ~crc;
+    for(uint32_t i = 0; i < len; i++){
+        crc ^= buf[i];
+        for(int bit = 0; bit < 8; bit++){
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,11 @@
+/**
+ * @file esp_sntp.h
+ * 
+ * @brief Host stand-in for the ESP-IDF header; only the time functions
+ * the components use
+**/
+
+#pragma once
+
+#include <time.h>
+#include <sys/time.h>
@@ -0,0 +1,24 @@
+/**
+ * @file esp_spiffs.h
+ * 
+ * @brief Host stand-in for SPIFFS; files are on the host file system, which
+ * is never reported as mounted
+**/
+
+#pragma once
+
+#include "esp_err.h"
+
+#include <stddef.h>
+
+typedef struct {
+    const char *base_path;
+    const char *partition_label;
+    size_t max_files;
+    bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+//no partition to measure, so nothing is evicted for space
+static inline esp_err_t esp_spiffs_info(const char *, size_t *, size_t *){
+    return ESP_ERR_INVALID_STATE;
+}
@@ -0,0 +1,21 @@
+/**
+ * @file FreeRTOS.h
+ * 
+ * @brief Host stand-in for the FreeRTOS types the components use; the host
+ * tests are single threaded
+**/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
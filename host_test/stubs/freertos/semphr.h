@@ -0,0 +1,25 @@
+/**
+ * @file semphr.h
+ * 
+ * @brief Host stand-in for FreeRTOS mutexes; the host tests are single
+ * threaded, so a mutex is always free
+**/
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(){
+    static int mutex;
+    return &mutex;
+}
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t){
+    return pdTRUE;
+}
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t){
+    return pdTRUE;
+}
+static inline void vSemaphoreDelete(SemaphoreHandle_t){
+}
@@ -0,0 +1,32 @@
+/**
+ * @file task.h
+ * 
+ * @brief Host stand-in for FreeRTOS tasks; the host tests are single
+ * threaded, so no task is ever created
+**/
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <stddef.h>
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *created, BaseType_t){
+    *created = NULL;
+    return pdFALSE;
+}
+static inline void vTaskDelete(TaskHandle_t){
+}
+static inline void vTaskDelay(TickType_t){
+}
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t){
+    return pdPASS;
+}
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *){
+}
+static inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t){
+    return 0;
+}
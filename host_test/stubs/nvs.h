@@ -0,0 +1,69 @@
+/**
+ * @file nvs.h
+ * 
+ * @brief Host stand-in for NVS, kept in RAM for the life of the test;
+ * values are stored as blobs, so a u32 reads back as a blob of 4 bytes
+**/
+
+#pragma once
+
+#include "esp_err.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+//namespaces opened, by handle; values by namespace and key
+inline std::vector<std::string> host_nvs_namespaces;
+inline std::map<std::string, std::vector<uint8_t>> host_nvs_values;
+
+static inline std::string host_nvs_key(nvs_handle_t handle, const char *key){
+    return host_nvs_namespaces[handle] + "/" + key;
+}
+
+static inline esp_err_t nvs_open(const char *name, nvs_open_mode_t, nvs_handle_t *handle_out){
+    host_nvs_namespaces.push_back(name);
+    *handle_out = host_nvs_namespaces.size() - 1;
+    return ESP_OK;
+}
+static inline void nvs_close(nvs_handle_t){
+}
+static inline esp_err_t nvs_commit(nvs_handle_t){
+    return ESP_OK;
+}
+static inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length){
+    host_nvs_values[host_nvs_key(handle, key)].assign((const uint8_t *)value, (const uint8_t *)value + length);
+    return ESP_OK;
+}
+static inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value_out, size_t *length){
+    auto found = host_nvs_values.find(host_nvs_key(handle, key));
+    if(found == host_nvs_values.end()) return ESP_ERR_NVS_NOT_FOUND;
+    if(value_out != NULL){
+        if(*length < found->second.size()) return ESP_ERR_INVALID_SIZE;
+        memcpy(value_out, found->second.data(), found->second.size());
+    }
+    *length = found->second.size();
+    return ESP_OK;
+}
+static inline esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value){
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+static inline esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value_out){
+    size_t length = sizeof(*value_out);
+    return nvs_get_blob(handle, key, value_out, &length);
+}
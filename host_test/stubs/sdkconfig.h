@@ -0,0 +1,8 @@
+/**
+ * @file sdkconfig.h
+ * 
+ * @brief Host stand-in for the project configuration; every option is
+ * left at its default
+**/
+
+#pragma once
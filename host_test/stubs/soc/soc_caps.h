@@ -0,0 +1,12 @@
+/**
+ * @file soc_caps.h
+ * 
+ * @brief Host stand-in for the ESP32 ADC capabilities
+**/
+
+#pragma once
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH (12)
+#define SOC_ADC_DIGI_RESULT_BYTES (2)
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH (2*1000*1000)
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW (20*1000)
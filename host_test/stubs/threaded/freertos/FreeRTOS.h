@@ -0,0 +1,23 @@
+/**
+ * @file FreeRTOS.h
+ * 
+ * @brief Host stand-in for FreeRTOS, with tasks on threads, for the host
+ * tests of components that run a task of their own
+**/
+
+#pragma once
+
+#include "../../freertos/FreeRTOS.h"
+
+#include <mutex>
+
+//one critical section for every lock, as disabling interrupts on both cores would be
+inline std::recursive_mutex host_critical;
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED portMUX_TYPE{0}
+#define portENTER_CRITICAL(mux) host_critical.lock()
+#define portEXIT_CRITICAL(mux) host_critical.unlock()
@@ -0,0 +1,55 @@
+/**
+ * @file semphr.h
+ * 
+ * @brief Host stand-in for FreeRTOS mutexes and binary semaphores, shared
+ * between threads; a tick is a milli-second
+**/
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+struct hostSemaphore{
+    std::mutex lock;
+    std::condition_variable given;
+    int count;
+};
+
+typedef hostSemaphore *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(){
+    return new hostSemaphore{{}, {}, 1};
+}
+static inline SemaphoreHandle_t xSemaphoreCreateBinary(){
+    return new hostSemaphore{{}, {}, 0};
+}
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks){
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+
+    if(ticks == portMAX_DELAY){
+        semaphore->given.wait(guard, [semaphore]{ return semaphore->count > 0; });
+    }
+    else if(!semaphore->given.wait_for(guard, std::chrono::milliseconds(ticks), [semaphore]{ return semaphore->count > 0; })){
+        return pdFALSE;
+    }
+
+    semaphore->count--;
+    return pdTRUE;
+}
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore){
+    std::lock_guard<std::mutex> guard(semaphore->lock);
+
+    if(semaphore->count > 0){
+        return pdFALSE;
+    }
+    semaphore->count = 1;
+    semaphore->given.notify_all();
+    return pdTRUE;
+}
+static inline void vSemaphoreDelete(SemaphoreHandle_t semaphore){
+    delete semaphore;
+}
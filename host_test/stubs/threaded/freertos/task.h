@@ -0,0 +1,78 @@
+/**
+ * @file task.h
+ * 
+ * @brief Host stand-in for FreeRTOS tasks, run on threads; a tick is a
+ * milli-second
+ * @note A task can only delete itself, at its end; deleting another task
+ * aborts, as it would leave the task's locks held
+**/
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+struct hostTask{
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications;
+};
+
+typedef hostTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+//task of the calling thread; threads that are not tasks get one when they first wait
+inline thread_local hostTask *host_current_task = NULL;
+
+static inline hostTask *host_task_of_thread(){
+    if(host_current_task == NULL) host_current_task = new hostTask{{}, {}, 0};
+    return host_current_task;
+}
+
+//tasks are never freed, so a task notified as it ends is still there
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *, uint32_t, void *parameters, UBaseType_t, TaskHandle_t *created, BaseType_t){
+    hostTask *task = new hostTask{{}, {}, 0};
+
+    if(created != NULL) *created = task;
+    std::thread([function, parameters, task]{
+        host_current_task = task;
+        function(parameters);
+    }).detach();
+    return pdPASS;
+}
+static inline void vTaskDelete(TaskHandle_t task){
+    if(task != NULL) abort();
+}
+static inline void vTaskDelay(TickType_t ticks){
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task){
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notifications++;
+    task->notified.notify_all();
+    return pdPASS;
+}
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *){
+    xTaskNotifyGive(task);
+}
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks){
+    hostTask *task = host_task_of_thread();
+    std::unique_lock<std::mutex> guard(task->lock);
+
+    if(ticks == portMAX_DELAY){
+        task->notified.wait(guard, [task]{ return task->notifications > 0; });
+    }
+    else{
+        task->notified.wait_for(guard, std::chrono::milliseconds(ticks), [task]{ return task->notifications > 0; });
+    }
+
+    uint32_t count = task->notifications;
+    if(count > 0) task->notifications = clear ? 0 : count - 1;
+    return count;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file telemetryCSV_test.cpp
+ * 
+ * @brief Checks Telemetry::ToCSV() byte for byte against the printf based
+ * formatter it replaced, and times both
+**/
+
+#include "telemetryControl.h"
+#include "hostTest.h"
+
+#include <random>
+
+using telemetryControl::Telemetry;
+
+/* Formatter of the baseline firmware, kept here as the reference. Same
+ * printf formats and buffer sizes, so the same truncation. */
+
+static void referenceTimeToCSV(const Telemetry *t, char *out){
+    char sec[telemetryControl::sizeEpoch];
+    char usec[telemetryControl::sizeMicroSecond];
+
+    snprintf(sec, telemetryControl::sizeEpoch, "%.10lu", t->Seconds);
+    snprintf(usec, telemetryControl::sizeMicroSecond, "%.6lu", t->uSeconds);
+    snprintf(out, telemetryControl::sizeTime, "%s,%s", sec, usec);
+}
+
+static void referencePWMToCSV(const Telemetry *t, char *out){
+    char duty[telemetryControl::sizePWMDuty];
+    char period[telemetryControl::sizePWMPeriod];
+
+    snprintf(duty, telemetryControl::sizePWMDuty, "%3i", t->pwm_Duty);
+    snprintf(period, telemetryControl::sizePWMPeriod, "%4f", t->pwm_Period);
+    snprintf(out, telemetryControl::sizePWM, "%s,%s", duty, period);
+}
+
+static void referenceTempToCSV(const Telemetry *t, char *out){
+    char buffer[telemetryControl::sizeTemp];
+
+    snprintf(buffer, telemetryControl::sizeSensor, "%7f", t->Sens[0]);
+    for(int i = 1; i < telemetryControl::numSensors; i++){
+        char sens[telemetryControl::sizeSensor];
+        char cell[telemetryControl::sizeSensor + 1];
+
+        snprintf(sens, telemetryControl::sizeSensor, "%7f", t->Sens[i]);
+        snprintf(cell, telemetryControl::sizeSensor + 1, ",%s", sens);
+        strncat(buffer, cell, telemetryControl::sizeSensor + 1);
+    }
+    strcpy(out, buffer);
+}
+
+static void referenceToCSV(const Telemetry *t, char *out){
+    char line[telemetryControl::sizeLine];
+    char time[telemetryControl::sizeTime];
+    char pwm[telemetryControl::sizePWM];
+    char temp[telemetryControl::sizeTemp];
+
+    referenceTimeToCSV(t, time);
+    strcpy(line, time);
+    strncat(line, ",", 2);
+    referencePWMToCSV(t, pwm);
+    strncat(line, pwm, telemetryControl::sizePWM);
+    strncat(line, ",", 2);
+    referenceTempToCSV(t, temp);
+    strncat(line, temp, telemetryControl::sizeTemp);
+    strncat(line, "\n", 2);
+    strcpy(out, line);
+}
+
+/**
+ * @brief Compares one sample's line from both formatters
+ * 
+ * @param t sample
+ * @return true if identical
+ */
+static bool matches(Telemetry *t){
+    char expected[telemetryControl::sizeLine];
+    char actual[telemetryControl::sizeLine];
+
+    referenceToCSV(t, expected);
+    int length = t->ToCSV(actual);
+
+    if(strcmp(expected, actual) != 0 || length != (int)strlen(expected)){
+        printf("expected: %s  actual: %s", expected, actual);
+        return false;
+    }
+    return true;
+}
+
+static void fill(Telemetry *t, std::mt19937 &rng, float low, float high){
+    std::uniform_real_distribution<float> temperature(low, high);
+    std::uniform_int_distribution<uint32_t> word;
+
+    t->setTime(word(rng), word(rng) % 1000000);
+    t->setPWM(word(rng) % 101, temperature(rng) < 0 ? 0 : word(rng) % 100000 / 100.0f);
+    for(int i = 0; i < telemetryControl::numSensors; i++){
+        t->setTemp(i, temperature(rng));
+    }
+}
+
+int main(){
+    Telemetry t;
+    std::mt19937 rng(1);
+
+    //samples in the thermistors' range
+    for(int i = 0; i < 100000; i++){
+        fill(&t, rng, -60, 160);
+        CHECK(matches(&t));
+    }
+
+    //cells that truncate, and the float edge cases
+    const float edges[] = {0.0f, -0.0f, 0.0000005f, 0.0000015f, -0.0000005f, 9.9999995f, 99.999999f,
+        999.99999f, -99.999999f, 12345.678f, -1234567.0f, 1e12f, -1e30f, 1e-40f, NAN, INFINITY, -INFINITY};
+    for(float edge : edges){
+        t.clear();
+        for(int i = 0; i < telemetryControl::numSensors; i++){
+            t.setTemp(i, edge);
+        }
+        t.setPWM(-5, edge);
+        CHECK(matches(&t));
+    }
+
+    //widest time and duty fields
+    t.clear();
+    t.setTime(4294967295UL, 999999);
+    t.setPWM(1000, 9999.9f);
+    CHECK(matches(&t));
+
+    //benchmark, on samples in the thermistors' range
+    const int lines = 200000;
+    char buffer[telemetryControl::sizeLine];
+    int64_t start = host_test_now();
+    for(int i = 0; i < lines; i++){
+        t.Sens[i % telemetryControl::numSensors] = 20.0f + (i % 1000) * 0.013f;
+        referenceToCSV(&t, buffer);
+    }
+    int64_t reference = host_test_now() - start;
+
+    start = host_test_now();
+    for(int i = 0; i < lines; i++){
+        t.Sens[i % telemetryControl::numSensors] = 20.0f + (i % 1000) * 0.013f;
+        t.ToCSV(buffer);
+    }
+    int64_t single_pass = host_test_now() - start;
+
+    printf("printf formatter: %lld ns/line\n", (long long)(reference / lines));
+    printf("ToCSV:            %lld ns/line (%.1fx)\n", (long long)(single_pass / lines), (double)reference / single_pass);
+
+    return host_test_result();
+}
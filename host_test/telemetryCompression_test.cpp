@@ -0,0 +1,160 @@
+/**
+ * @file telemetryCompression_test.cpp
+ *
+ * @brief Checks that compressed blocks decode back to the samples logged, at
+ * the resolution of binary records, that blocks of the float layout still
+ * decode, and that noisy thermistor readings take less flash than binary
+ * records
+**/
+
+#include "telemetryCompression.h"
+#include "hostTest.h"
+
+#include <random>
+#include <vector>
+
+using telemetryControl::Telemetry;
+
+static std::vector<std::vector<uint8_t>> blocks;
+
+static void sink(const uint8_t *block, int size){
+    blocks.push_back(std::vector<uint8_t>(block, block + size));
+}
+
+/* Writer of blockVersionFloat blocks, the layout before temperatures were
+ * rounded, as kept in the logs of older firmware. */
+
+static int old_position = 0;
+
+static uint32_t bitsOf(float value){
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static void putBits(std::vector<uint8_t> *block, uint64_t value, int bits){
+    uint8_t *payload = block->data() + sizeof(telemetryControl::BlockHeader);
+
+    for(int i = bits - 1; i >= 0; i--, old_position++){
+        if((value >> i) & 1) payload[old_position >> 3] |= 0x80 >> (old_position & 7);
+    }
+}
+
+static void sealOld(std::vector<uint8_t> *block, int count){
+    telemetryControl::BlockHeader header = {
+        .magic = telemetryControl::blockMagic,
+        .version = telemetryControl::blockVersionFloat,
+        .reserved = 0,
+        .count = (uint16_t)count,
+        .bits = (uint16_t)old_position,
+        .crc = esp_rom_crc32_le(0, block->data() + sizeof(header), (old_position + 7) / 8)
+    };
+    memcpy(block->data(), &header, sizeof(header));
+}
+
+/**
+ * @brief Thermistor readings of a slow heating run: every sensor drifts
+ * and is read with about 0.05 degrees of noise, once a second with jitter
+ */
+static void makeSamples(std::vector<Telemetry> *samples, int count){
+    std::mt19937 random(7);
+    std::normal_distribution<float> noise(0, 0.05f);
+    std::uniform_int_distribution<int> jitter(-2000, 2000);
+
+    for(int n = 0; n < count; n++){
+        Telemetry capture;
+        capture.setTime(1700000000 + n, 500000 + jitter(random));
+        capture.setPWM(n < count / 2 ? 40 : 0, 2.5f);
+        for(int i = 0; i < telemetryControl::numSensors; i++){
+            capture.setTemp(i, 22.0f + i * 0.7f + n * 0.002f + noise(random));
+        }
+        samples->push_back(capture);
+    }
+}
+
+int main(){
+    const int count = 5000;
+    const float resolution = 1 / telemetryControl::recordTempScale;
+    std::vector<Telemetry> samples;
+    telemetryControl::Compressor compressor(sink);
+
+    makeSamples(&samples, count);
+
+    //NaN readings, e.g. an unscanned sensor, and a saturated one
+    samples[10].setTemp(3, NAN);
+    samples[11].setTemp(3, NAN);
+    samples[20].setTemp(5, 900.0f);
+
+    for(int n = 0; n < count; n++){
+        compressor.append(&samples[n]);
+    }
+    int full_blocks = blocks.size();
+    compressor.flush();
+    CHECK(full_blocks > 0);
+
+    //every sample decodes, in order, at the resolution of binary records
+    telemetryControl::Decompressor decompressor;
+    int decoded = 0;
+    float max_error = 0;
+    bool nan_kept = true;
+    for(size_t b = 0; b < blocks.size(); b++){
+        Telemetry capture;
+
+        CHECK(decompressor.load(blocks[b].data()));
+        while(decompressor.next(&capture) && decoded < count){
+            const Telemetry *logged = &samples[decoded++];
+
+            CHECK(capture.Seconds == logged->Seconds && capture.uSeconds == logged->uSeconds);
+            CHECK(capture.pwm_Duty == logged->pwm_Duty);
+            for(int i = 0; i < telemetryControl::numSensors; i++){
+                if(isnan(logged->Sens[i])){
+                    nan_kept = nan_kept && isnan(capture.Sens[i]);
+                    continue;
+                }
+                float expected = logged->Sens[i] > INT16_MAX / telemetryControl::recordTempScale ? INT16_MAX / telemetryControl::recordTempScale : logged->Sens[i];
+                float error = fabsf(capture.Sens[i] - expected);
+                if(error > max_error) max_error = error;
+            }
+        }
+    }
+    CHECK(decoded == count);
+    CHECK(nan_kept);
+    CHECK(max_error <= resolution / 2 + 1e-4f);
+    printf("max error: %.4f degrees\n", max_error);
+
+    //blocks written before temperatures were rounded still decode
+    std::vector<uint8_t> old_block(telemetryControl::blockSize, 0);
+    putBits(&old_block, 1700000000ULL * 1000000, 64);
+    putBits(&old_block, 40, 8);
+    putBits(&old_block, bitsOf(2.5f), 32);
+    for(int i = 0; i < telemetryControl::numSensors; i++){
+        putBits(&old_block, bitsOf(20.123f + i), 32);
+    }
+    putBits(&old_block, 0, 3 + telemetryControl::numSensors); //second sample: nothing changed
+    sealOld(&old_block, 2);
+
+    Telemetry old_capture;
+    CHECK(decompressor.load(old_block.data()));
+    CHECK(decompressor.next(&old_capture) && old_capture.Sens[15] == 35.123f);
+    CHECK(decompressor.next(&old_capture) && old_capture.Sens[0] == 20.123f && old_capture.pwm_Duty == 40);
+    CHECK(!decompressor.next(&old_capture));
+
+    //a corrupt block is rejected
+    std::vector<uint8_t> corrupt = blocks[0];
+    corrupt[sizeof(telemetryControl::BlockHeader) + 10] ^= 0x01;
+    CHECK(!decompressor.load(corrupt.data()));
+
+    //flash taken by each sample in full blocks, against a binary record
+    int in_full_blocks = 0;
+    for(int b = 0; b < full_blocks; b++){
+        telemetryControl::BlockHeader header;
+        memcpy(&header, blocks[b].data(), sizeof(header));
+        in_full_blocks += header.count;
+    }
+    float per_sample = (float)full_blocks * telemetryControl::blockSize / in_full_blocks;
+    CHECK(per_sample < telemetryControl::sizeRecord);
+    CHECK(per_sample * 8 <= telemetryControl::maxSampleBits);
+    printf("compressed: %.1f bytes per sample, binary record: %i bytes\n", per_sample, telemetryControl::sizeRecord);
+
+    return host_test_result();
+}
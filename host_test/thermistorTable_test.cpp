@@ -0,0 +1,104 @@
+/**
+ * @file thermistorTable_test.cpp
+ *
+ * @brief Checks the thermistorTable conversion against the exact float
+ * conversion of adcControl for every raw code, and times both
+**/
+
+#include "thermistorTable.h"
+#include "hostTest.h"
+
+using adcControl::thermistorTable;
+
+/* Exact conversion of adc::convertExact(), with the thermistor constants of
+ * adcControl.h. The calibration is modelled on the ESP32 line fitting scheme:
+ * integer mV = raw * coeff_a / 65536 + coeff_b, here with the coefficients of
+ * a typical 11 dB unit (about 0.81 mV per code, 142 mV offset). */
+
+constexpr float bCoefficient = 3950;
+constexpr float thermistorNominal = 100000;
+constexpr float temperatureNominal = 25;
+constexpr float kelvin = 273.15;
+constexpr float supplyVoltage = 3300;
+const float r_inf = thermistorNominal*exp((-bCoefficient)/(kelvin+temperatureNominal));
+
+constexpr uint32_t coeffA = 53047;
+constexpr uint32_t coeffB = 142;
+
+static int rawToVoltage(uint32_t raw){
+    return (int)((uint64_t)raw * coeffA / 65536 + coeffB);
+}
+
+static float convertExact(uint32_t raw){
+    int voltage = rawToVoltage(raw);
+    float resistance = ((thermistorNominal*supplyVoltage)/voltage)-thermistorNominal;
+    return (bCoefficient/log(resistance/r_inf))-kelvin;
+}
+
+int main(){
+    static thermistorTable table;
+    float temperature;
+
+    //not built yet
+    CHECK(!table.lookup(2048, &temperature));
+
+    for(int point = 0; point < adcControl::tablePoints; point++){
+        table.set(point, convertExact(thermistorTable::rawOf(point)));
+    }
+
+    //every code in the thermistors' rated range converts, within 0.3 degrees
+    float max_error = 0;
+    int converted = 0;
+    for(uint32_t raw = 0; raw <= (uint32_t)adcControl::tableMaxRaw; raw++){
+        float exact = convertExact(raw);
+        bool found = table.lookup(raw, &temperature);
+
+        if(!isfinite(exact)){
+            CHECK(!found || isfinite(temperature));
+            continue;
+        }
+        if(exact < -40 || exact > 125){
+            continue;
+        }
+
+        CHECK(found);
+        if(found){
+            float error = fabsf(temperature - exact);
+            if(error > max_error) max_error = error;
+            converted++;
+        }
+    }
+    CHECK(converted > 0);
+    CHECK(max_error <= 0.3f);
+    printf("max error from -40 to 125 C: %.3f C over %i codes\n", max_error, converted);
+
+    //past the last code, or next to a code with no temperature, the exact path is used
+    CHECK(!table.lookup(adcControl::tableMaxRaw + 1, &temperature));
+    CHECK(!isfinite(convertExact(adcControl::tableMaxRaw)));
+    CHECK(!table.lookup(adcControl::tableMaxRaw, &temperature));
+
+    //benchmark, over every code
+    const int rounds = 200;
+    volatile float sink = 0;
+    int64_t start = host_test_now();
+    for(int i = 0; i < rounds; i++){
+        for(uint32_t raw = 0; raw <= (uint32_t)adcControl::tableMaxRaw; raw++){
+            sink = sink + convertExact(raw);
+        }
+    }
+    int64_t exact = host_test_now() - start;
+
+    start = host_test_now();
+    for(int i = 0; i < rounds; i++){
+        for(uint32_t raw = 0; raw <= (uint32_t)adcControl::tableMaxRaw; raw++){
+            if(table.lookup(raw, &temperature)) sink = sink + temperature;
+        }
+    }
+    int64_t lookup = host_test_now() - start;
+
+    const int conversions = rounds * (adcControl::tableMaxRaw + 1);
+    printf("exact conversion: %.1f ns\n", (double)exact / conversions);
+    printf("table lookup:     %.1f ns (%.1fx)\n", (double)lookup / conversions, (double)exact / lookup);
+
+    return host_test_result();
+}
@@ -14,13 +14,31 @@ using namespace std;
 #include <freertos/task.h>
 #include "esp_sleep.h" //power management
 #include "esp_sntp.h" //system time
+#include "esp_heap_caps.h" //download heap use
+#include "esp_timer.h" //boot timings
+#include "nvs.h" //settings kept over restarts
 
 #include "i2cControl.h"
 #include "adcControl.h"
+#include "samplingService.h"
 #include "pwmControl.h"
 #include "spiffsControl.h"
+#include "ringBuffer.h"
+#include "logStore.h"
+#include "espPartition.h"
+#include "logSession.h"
+#include "logReader.h"
+#include "sessionReader.h"
+#include "logStream.h"
+#include "streamWriter.h"
+#include "logCompactor.h"
+#include "flashMaintenance.h"
+#include "wearStats.h"
+#include "storagePolicy.h"
 #include "experimentControl.h"
 #include "telemetryControl.h"
+#include "telemetryCompression.h"
+#include "telemetryRollup.h"
 
 //Logging
 #define TAG "system"
@@ -32,6 +50,25 @@ using namespace std;
 
 //SPI
 #define LOG_FILE_NAME "/spiffs/exp_log.csv"
+#define LOG_RECORD_FILE_NAME "/spiffs/exp_log.bin"
+#define LOG_BLOCK_FILE_NAME "/spiffs/exp_log.blk"
+#define PASSIVE_LOG_FILE_NAME "/spiffs/pas_log.csv"
+#define PASSIVE_LOG_RECORD_FILE_NAME "/spiffs/pas_log.bin"
+#define PASSIVE_LOG_BLOCK_FILE_NAME "/spiffs/pas_log.blk"
+#define STORE_TAG_TELEMETRY 0x01 //log store record holding a telemetryControl::Record of the experiment stream
+#define STORE_TAG_PASSIVE 0x02 //log store record holding a telemetryControl::Record of the passive stream
+#define ROLLUP_MINUTE_FILE_NAME "/spiffs/r1m_log.bin"
+#define ROLLUP_TEN_MINUTE_FILE_NAME "/spiffs/r10m_log.bin"
+#define STORE_TAG_ROLLUP 0x03 //tag of the rollup streams; rollups are not kept in the log store
+
+//NVS
+#define SETTINGS_NAMESPACE "settings" //settings set over i2c that are kept over restarts
+#define SETTINGS_KEY_LOG_FORMAT "log_format"
+
+//Boot
+#define BOOT_NEEDS_LOG ((1 << BOOT_STORAGE) | (1 << BOOT_LOGS)) //handlers that read or write the logs
+#define BOOT_NEEDS_SESSIONS (BOOT_NEEDS_LOG | (1 << BOOT_SESSIONS)) //handlers of read sessions
+#define BOOT_NEEDS_ADC (1 << BOOT_ADC) //handlers that sample the thermistors
 
 /* Support Functions */
 
@@ -65,792 +102,2381 @@ void set_system_time_to_compile()
 /* Objects */
 spiffsControl::spiffs file;
 adcControl::adc sensor;
+adcControl::samplingService sampler(&sensor); //only sampler sweeps sensor
 pwmControl::pwm pwm(GPIO_NUM_5);
 i2cControl::i2cSlave i2c(GPIO_NUM_19, GPIO_NUM_23, 0x23);
 
 experimentControl::Experiment payload;
 
-/* Task Handles */
-
-TaskHandle_t exp_run_task = NULL;
-TaskHandle_t exp_log_task = NULL;
-TaskHandle_t exp_plog_task = NULL;
-
-/* Tasks */
+//boot phases, in the order they run; bit n of boot_ready is set once phase n is done
+enum boot_phase_t {
+    BOOT_I2C, //i2c slave answering
+    BOOT_PWM,
+    BOOT_STORAGE, //SPIFFS mounted and checked, or the log store mounted
+    BOOT_LOGS, //log segments scanned and recovered, log format restored, log tasks started
+    BOOT_SESSIONS, //read session watermarks loaded
+    BOOT_ADC, //ADC units set up, thermistors powered
+    BOOT_PHASES
+};
+volatile uint32_t boot_ready = 0;
+uint32_t boot_times[BOOT_PHASES] = {0}; //micro-seconds from start-up to the end of each phase
 
 /**
- * @brief Task that scans i2c bus for message. If message received,
- * process opcode and parameter handshake interaction. Calls
- * i2c_handler associated to opcode. Task does not self-delete.
+ * @brief Marks a boot phase done and records when
  * 
- * @param pvParameters none
+ * @param phase boot phase
  */
-void i2c_scan(void *pvParameters){
-    (void)pvParameters;
-
-    while(1){
-        i2c.update();
-    }
+void boot_done(boot_phase_t phase){
+    boot_times[phase] = esp_timer_get_time();
+    boot_ready |= 1 << phase;
+    ESP_LOGI(TAG, "Boot phase %i done at %lu us", (int)phase, (unsigned long)boot_times[phase]);
 }
 
 /**
- * @brief Task that runs experiment procedure as defined by the
- * Experiment struct. Logs telemetry data to SPI Flash
- * storage throughout procedure. Task deletes upon experiment
- * completion.
+ * @brief Checks that the subsystems a handler uses are up.
+ * Replies INVALID if they are not, so the OBC can retry once
+ * get_boot_status shows them ready.
  * 
- * @param pvParameters none
+ * @param phases bitmap of boot phases, e.g. BOOT_NEEDS_LOG
+ * @return true if every phase is done
  */
-void exp_run(void *pvParameters){
-    (void)pvParameters;
+bool boot_check(uint32_t phases){
+    if((boot_ready & phases) == phases) {
+        return true;
+    }
 
-    while(1){
-        //check if experiment is already running
-        if(payload.status){
-            //exit
-        }
+    ESP_LOGW(TAG_i2c, "Not ready (0x%02lX of 0x%02lX)", (unsigned long)boot_ready, (unsigned long)phases);
+    i2c.write_one_byte(i2cControl::invalidByte);
+    return false;
+}
 
-        //indicate that experiment is active
-        ESP_LOGI(TAG_task, "Experiment Starting");
-        payload.status = experimentControl::EXP_STARTUP;
+//log files of every stream, kept as segments; indexed by log stream, then log format
+spiffsControl::logSegments log_segments[experimentControl::logStreams][experimentControl::logFormats] = {
+    {LOG_FILE_NAME, LOG_RECORD_FILE_NAME, LOG_BLOCK_FILE_NAME},
+    {PASSIVE_LOG_FILE_NAME, PASSIVE_LOG_RECORD_FILE_NAME, PASSIVE_LOG_BLOCK_FILE_NAME}
+};
 
-        //reset current stage counter
-        payload.current_stage = 0;
+//log streams; indexed by log stream
+spiffsControl::logStream log_streams[experimentControl::logStreams] = {
+    {STORE_TAG_TELEMETRY, &log_segments[experimentControl::LOG_STREAM_EXPERIMENT][experimentControl::LOG_CSV]},
+    {STORE_TAG_PASSIVE, &log_segments[experimentControl::LOG_STREAM_PASSIVE][experimentControl::LOG_CSV]}
+};
+spiffsControl::streamWriter stream_writer;
 
-        //log baseline
-        ESP_LOGI(TAG_task, "Logging Baseline (%i ms)", (int)payload.startup_length);
-        vTaskDelay(payload.startup_length / portTICK_PERIOD_MS);
+//ring of the stream read over i2c (payload.log_stream)
+spiffsControl::ringBuffer *log_ring = log_streams[experimentControl::LOG_STREAM_EXPERIMENT].getRing();
 
-        //reset pwm out
-        pwm.setPWM(payload.pwm_period, 0);
-        pwm.startPWM();
+/**
+ * @brief Buffers a sealed compressed block of the experiment stream
+ * 
+ * @param block compressed block
+ * @param size length of block in bytes
+ */
+void log_block_experiment(const uint8_t *block, int size){
+    log_streams[experimentControl::LOG_STREAM_EXPERIMENT].getRing()->append(block, size);
+}
 
-        payload.status = experimentControl::EXP_ACTIVE;
+/**
+ * @brief Buffers a sealed compressed block of the passive stream
+ * 
+ * @param block compressed block
+ * @param size length of block in bytes
+ */
+void log_block_passive(const uint8_t *block, int size){
+    log_streams[experimentControl::LOG_STREAM_PASSIVE].getRing()->append(block, size);
+}
 
-        //stage loop
-        while(payload.current_stage < payload.stage_count){
-            //check for experiment exit
-            if(payload.stop_flag){
-                payload.stop_flag = false;
-                pwm.pausePWM();
-                break;
-            }
+//compressors; indexed by log stream
+telemetryControl::Compressor compressors[experimentControl::logStreams] = {log_block_experiment, log_block_passive};
+telemetryControl::Decompressor decompressor;
+
+//rollup tiers of the passive samples
+enum rollup_tier_t {
+    ROLLUP_MINUTE,
+    ROLLUP_TEN_MINUTE,
+    ROLLUP_TIERS
+};
+constexpr uint16_t rollupPeriods[ROLLUP_TIERS] = {60, 600}; //seconds; indexed by rollup tier
+constexpr uint32_t rollupRetention[ROLLUP_TIERS] = {98304, 163840}; //bytes kept, about 15 hours and 10 days; indexed by rollup tier
+
+//rollup logs, each a bounded ring of RollupRecords; indexed by rollup tier
+spiffsControl::logSegments rollup_segments[ROLLUP_TIERS] = {ROLLUP_MINUTE_FILE_NAME, ROLLUP_TEN_MINUTE_FILE_NAME};
+spiffsControl::logStream rollup_streams[ROLLUP_TIERS] = {
+    {STORE_TAG_ROLLUP, &rollup_segments[ROLLUP_MINUTE], telemetryControl::sizeRollup},
+    {STORE_TAG_ROLLUP, &rollup_segments[ROLLUP_TEN_MINUTE], telemetryControl::sizeRollup}
+};
 
-            //set pwm to stage pwm param
-            ESP_LOGI(TAG_task, "Advancing to Stage %i (%i ms)", (int)payload.current_stage, (int)payload.length[payload.current_stage]);
-            pwm.setDutyCycle(payload.pwm_duty[payload.current_stage]);
+/**
+ * @brief Buffers a sealed 1 minute window
+ * 
+ * @param record rollup record
+ */
+void rollup_sink_minute(const telemetryControl::RollupRecord *record){
+    rollup_streams[ROLLUP_MINUTE].getRing()->append(record, sizeof(*record));
+}
 
-            //wait stage length
-            vTaskDelay(payload.length[payload.current_stage] / portTICK_PERIOD_MS);
-            
-            payload.current_stage++;
-        }
+/**
+ * @brief Buffers a sealed 10 minute window
+ * 
+ * @param record rollup record
+ */
+void rollup_sink_ten_minute(const telemetryControl::RollupRecord *record){
+    rollup_streams[ROLLUP_TEN_MINUTE].getRing()->append(record, sizeof(*record));
+}
 
-        //turn off pwm
-        pwm.pausePWM();
+//rollups; indexed by rollup tier, only used by the passive logger and while it is stopped
+telemetryControl::Rollup rollups[ROLLUP_TIERS] = {
+    {ROLLUP_MINUTE, rollupPeriods[ROLLUP_MINUTE], rollup_sink_minute},
+    {ROLLUP_TEN_MINUTE, rollupPeriods[ROLLUP_TEN_MINUTE], rollup_sink_ten_minute}
+};
 
-        payload.status = experimentControl::EXP_COOLDOWN;
+/**
+ * @brief Seals the open window of every rollup tier, e.g.
+ * when the passive logger stops, so a gap in sampling is not
+ * summarized as one window
+ * 
+ */
+void rollup_seal(){
+    for(int tier = 0; tier < ROLLUP_TIERS; tier++) {
+        rollups[tier].flush();
+    }
+}
 
-        //post-experiment log
-        ESP_LOGI(TAG_task, "Logging cooldown (%i ms)", (int)payload.cooldown_length);
-        vTaskDelay(payload.cooldown_length / portTICK_PERIOD_MS);
+//get_rollup positions; indexed by rollup tier. Readers are not loaded, so they keep no watermark.
+spiffsControl::logSession rollup_readers[ROLLUP_TIERS];
 
-        //turn logger off
-        while(payload.logger_status == true){
-        }
-        vTaskDelete(exp_log_task);
+/**
+ * @brief Moves a rollup reader to its position in the
+ * rollup log. Records evicted by the retention limit are
+ * skipped.
+ * 
+ * @param tier rollup tier
+ * @param next if true, only moves to the start of another
+ * segment, once the reader has read to the end of one
+ * @return true if the reader is at its position
+ */
+bool rollup_seek(int tier, bool next){
+    spiffsControl::ringBuffer *ring = rollup_streams[tier].getRing();
+    spiffsControl::logSession *reader = &rollup_readers[tier];
+    telemetryControl::RollupRecord skip;
+    char path[spiffsControl::segmentPathSize];
+    uint32_t position = reader->getPosition();
+    uint32_t start, offset;
+
+    if(position < ring->getOldest()) position = ring->getOldest();
+
+    if(!ring->locate(position, &start, &offset, path)) {
+        return false;
+    }
+    if(next && (start != position || strcmp(path, reader->getPath()) == 0)) {
+        return false;
+    }
+    if(!reader->seek(path, start, offset)) {
+        return false;
+    }
 
-        //exit task
-        ESP_LOGI(TAG_task, "Experiment Completed");
-        payload.status = experimentControl::EXP_INACTIVE;
-        vTaskDelete(NULL);
+    while(reader->getPosition() < position) {
+        if(reader->readRecord(&skip, sizeof(skip)) == -1) {
+            reader->rewind();
+            return false;
+        }
     }
+    return true;
 }
 
 /**
- * @brief Task that discretely records system telemetry to SPI
- * Flash storage on a set inerval. Task does not self-delete.
+ * @brief Reads the next sealed window of a rollup tier,
+ * carrying on into the next segment at the end of each one.
+ * Starts from the oldest window kept. Records that fail
+ * their crc check are skipped.
  * 
- * @param pvParameters 
+ * @param tier rollup tier
+ * @param record_out destination for the record
+ * @return true if a record was read;
+ * @return false if there are no more records, the next call
+ * starts from the oldest record again
  */
-void exp_log(void *pvParameters){
-    uint32_t *interval = (uint32_t *) pvParameters;
-    const TickType_t xDelay = *interval / portTICK_PERIOD_MS;
-    ESP_LOGI(TAG_task, "Logger started: interval %ims", (int)*interval);
-    
-    //objects to hold log data
-    telemetryControl::Telemetry capture;
-    char line[telemetryControl::sizeLine];
-
-    while(1){
-        //set logger status as active
-        payload.logger_status = true;
-
-        //capture time data
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        capture.setTime(tv.tv_sec, tv.tv_usec);
-
-        //capture temperature data
-        for(int sensor_number = 0; sensor_number < telemetryControl::numSensors; sensor_number++){
-            //Gather data
-            float buffer = sensor.sample(sensor_number);
+bool rollup_read_next(int tier, telemetryControl::RollupRecord *record_out){
+    spiffsControl::logSession *reader = &rollup_readers[tier];
 
-            //Put data into Telemetry object
-            capture.setTemp(sensor_number, buffer);
-        }
+    if(!reader->isPositioned() && !rollup_seek(tier, false)) {
+        reader->rewind();
+        return false;
+    }
 
-        //capture heater data
-        if(pwm.getStatus()){
-            //if pwm is on
-            capture.setPWM(pwm.getDutyCycle(), pwm.getCyclePeriod());
-        }
-        else{
-            //if pwm is off
-            capture.setPWM(0, pwm.getCyclePeriod());
+    do {
+        while(reader->readRecord(record_out, sizeof(*record_out)) != -1) {
+            if(telemetryControl::CheckRollup(record_out)) return true;
+            ESP_LOGW(TAG, "Skipping corrupt rollup %lu", (unsigned long)reader->getPosition() - 1);
         }
+    } while(rollup_seek(tier, true));
 
-        //log telemetry
-        capture.ToCSV(line);
-        file.addLine(LOG_FILE_NAME, line);
-
-        //set logger status as inactive
-        payload.logger_status = false;
-
-        //wait interval
-        vTaskDelay(xDelay);
-    }
+    reader->rewind();
+    return false;
 }
 
-/* I2C Call Functions */
-
 /**
- * @brief Function called when an undefined opcode is
- * received.
+ * @brief Get the log that a stream writes a format to
  * 
- * @return nothing
+ * @param stream experimentControl log stream
+ * @param format experimentControl log format
+ * @return spiffsControl::logSegments* segment files of the log
  */
-void i2c_unused(i2cControl::parameter_t parameter){
-    ESP_LOGW(TAG_i2c, "Undefined Opcode");
+spiffsControl::logSegments *log_segments_of(uint8_t stream, uint8_t format){
+    if(stream >= experimentControl::logStreams) stream = experimentControl::LOG_STREAM_EXPERIMENT;
+    if(format > experimentControl::LOG_COMPRESSED) format = experimentControl::LOG_CSV;
+    return &log_segments[stream][format];
 }
 
 /**
- * @brief Function called when an opcode is ignored
+ * @brief Get the size of the records a format writes to its log file
  * 
- * @return nothing
+ * @param format experimentControl log format
+ * @return size_t length of every record in bytes, 0 for .csv lines
  */
-void i2c_ignore(i2cControl::parameter_t parameter){
-    ESP_LOGI(TAG_i2c, "OpCode Ignored");
+size_t log_record_size(uint8_t format){
+    if(format == experimentControl::LOG_BINARY) return telemetryControl::sizeRecord;
+    if(format == experimentControl::LOG_COMPRESSED) return telemetryControl::blockSize;
+    return 0;
 }
 
 /**
- * @brief OpCode: 0x21
- * @note Performs a software reset. When the function is 
- * called, execution of the program stops, both CPUs are 
- * reset, the application is loaded by the bootloader and 
- * starts execution again. 
+ * @brief Reads the timestamps of a log record, in the current
+ * log format
  * 
- * @param 0x49 Restart I2C
- * @param 0x05 Restart Device
- * 
- * @return VALID upon successful reset;
- * @return UNKNOWN if undefined parameter
+ * @param record .csv line, binary record or compressed block
+ * @param size length of record in bytes
+ * @param first_out earliest sample time (seconds)
+ * @param last_out latest sample time (seconds)
+ * @param decoder decompressor for compressed blocks
+ * @return true if the record holds a valid sample
  */
-void i2c_restart_device(i2cControl::parameter_t parameter){
-    if(parameter == 0x49) { //Restart I2C
-        ESP_LOGI(TAG_i2c, "Restarting I2C");
-        sensor.powerOff();
-        i2c.reset();
+bool log_record_time(const void *record, size_t size, uint32_t *first_out, uint32_t *last_out, telemetryControl::Decompressor *decoder){
+    telemetryControl::Telemetry capture;
 
-        i2c.write_one_byte(i2cControl::validByte);
+    if(payload.log_format == experimentControl::LOG_BINARY) {
+        if(size != telemetryControl::sizeRecord || !capture.FromRecord((const telemetryControl::Record *)record)) return false;
+
+        *first_out = *last_out = capture.Seconds;
+        return true;
     }
-    else if(parameter == 0x05) { //Restart Device
-        ESP_LOGI(TAG_i2c, "Restarting Device");
-        esp_restart();
+
+    if(payload.log_format == experimentControl::LOG_COMPRESSED) {
+        bool found = false;
+
+        if(size != telemetryControl::blockSize || !decoder->load((const uint8_t *)record)) return false;
+
+        while(decoder->next(&capture)) {
+            if(!found || capture.Seconds < *first_out) *first_out = capture.Seconds;
+            if(!found || capture.Seconds > *last_out) *last_out = capture.Seconds;
+            found = true;
+        }
+        return found;
     }
-    else {
-        ESP_LOGW(TAG_i2c, "Invalid Parameter");
-        i2c.write_one_byte(i2cControl::unknownByte);
+
+    //.csv line starts with the seconds cell; the header does not
+    const char *line = (const char *)record;
+    uint32_t seconds = 0;
+    size_t i = 0;
+
+    while(i < size && line[i] >= '0' && line[i] <= '9') {
+        seconds = seconds * 10 + (line[i++] - '0');
     }
+    if(i == 0 || i == size || line[i] != ',') return false;
+
+    *first_out = *last_out = seconds;
+    return true;
 }
 
+//decompressors of the log index; indexed by log stream, only used under the lock of the stream's ring
+telemetryControl::Decompressor time_decoders[experimentControl::logStreams];
 
 /**
- * @brief OpCode 0x03
- * @note Device will wake up from sleep mode when the
- * SCL pin is brought to low. 
- * 
- * @param _unused
+ * @brief Reads the timestamps of an experiment stream record
+ * for the log index. Called by its ring.
  * 
- * @return VALID upon wake
  */
-void i2c_wake_device(i2cControl::parameter_t parameter);
+bool log_record_time_experiment(const void *record, size_t size, uint32_t *first_out, uint32_t *last_out){
+    return log_record_time(record, size, first_out, last_out, &time_decoders[experimentControl::LOG_STREAM_EXPERIMENT]);
+}
 
 /**
- * @brief OpCode 0x02
- * @note Puts device in light sleep mode. In Light-sleep 
- * mode, the digital peripherals, most of the RAM, and 
- * CPUs are clock-gated and their supply voltage is 
- * reduced. Upon exit from Light-sleep, the digital 
- * peripherals, RAM, and CPUs resume operation and their 
- * internal states are preserved.
- * 
- * @param _unused
+ * @brief Reads the timestamps of a passive stream record
+ * for the log index. Called by its ring.
  * 
- * @return VALID before sleep
  */
-void i2c_sleep_device(i2cControl::parameter_t parameter){
-    //set up sleep mode
-    gpio_wakeup_enable(i2c.get_scl_io_pin(), GPIO_INTR_LOW_LEVEL);
-    esp_sleep_enable_gpio_wakeup();
+bool log_record_time_passive(const void *record, size_t size, uint32_t *first_out, uint32_t *last_out){
+    return log_record_time(record, size, first_out, last_out, &time_decoders[experimentControl::LOG_STREAM_PASSIVE]);
+}
 
-    //turn off any GPIO outputs
-    pwm.pausePWM();
-    sensor.powerOff();
+uint32_t log_sequence[experimentControl::logStreams] = {0}; //journal sequence number of the next .csv line; indexed by log stream
+uint8_t log_recovering = 0; //stream whose log log_recover() is checking
 
-    i2c.write_one_byte(i2cControl::validByte);
+/**
+ * @brief Checks a .csv log line for recovery. Keeps the
+ * sequence number of a valid line, so numbering carries on
+ * after the last line kept.
+ * 
+ * @param line .csv line
+ * @param size length of line in bytes
+ * @return true if the line is complete
+ */
+bool log_check_line(const void *line, size_t size){
+    uint32_t sequence = UINT32_MAX;
 
-    //put device to sleep
-    ESP_LOGI(TAG_i2c, "going to sleep...");
-    vTaskDelay(10 / portTICK_PERIOD_MS);
-    esp_light_sleep_start();
+    if(!telemetryControl::CheckCSV((const char *)line, size, &sequence)) return false;
 
-    /*device will wake when the i2c bus is used. OpCode
-    0x03 (Wake Device)'s should be used to wake the device
-    so it's i2c handler is run immediately upon waking.*/
-    i2c_wake_device(i2cControl::validByte);
+    if(sequence != UINT32_MAX) log_sequence[log_recovering] = sequence + 1;
+    return true;
 }
 
-//declared earlier so that it can be used by 0x02
-void i2c_wake_device(i2cControl::parameter_t parameter){
-    ESP_LOGI(TAG_i2c, "waking up...");
-    i2c.write_one_byte(i2c.get_device_address());
-    sensor.powerOn();
+/**
+ * @brief Checks a binary log record for recovery
+ * 
+ * @param record binary record
+ * @param size length of record in bytes
+ * @return true if the crc matches
+ */
+bool log_check_record(const void *record, size_t size){
+    telemetryControl::Telemetry capture;
+    return size == telemetryControl::sizeRecord && capture.FromRecord((const telemetryControl::Record *)record);
 }
 
 /**
- * @brief OpCode 0x04 (deprecated)
- * @note 
- * 
- * @param _unused
+ * @brief Checks a compressed log block for recovery
  * 
- * @return
+ * @param block compressed block
+ * @param size length of block in bytes
+ * @return true if the header and crc are valid
  */
-void i2c_run_system_check(i2cControl::parameter_t parameter){
-
+bool log_check_block(const void *block, size_t size){
+    //only called at boot, before the decompressor is used to read the log
+    return size == telemetryControl::blockSize && decompressor.load((const uint8_t *)block);
 }
 
 /**
- * @brief Opcode 0x25 (deprecated)
- * @note Device will run a brief system check on the
- * specified system and return a metric related to its
- * performance.
- * 
- * @param 0x54 PWM Signal Generator
- * @param 0x49 I2C Slave
- * @param 0x7C SPI Flash
- * @param 0x25 ADC Temperature Sensors
+ * @brief Checks a rollup record for recovery
  * 
- * @return 0x00 Installed;
- * @return 0x01 Not Installed;
- * @return 0x02 Active;
- * @return 0x03 Inactive;
- * @return UNKNWON if parameter is undefined
+ * @param record rollup record
+ * @param size length of record in bytes
+ * @return true if the crc matches
  */
-void i2c_get_system_check_result(i2cControl::parameter_t parameter){
-    //see onenotes of implementation suggestion
+bool rollup_check(const void *record, size_t size){
+    return size == telemetryControl::sizeRollup && telemetryControl::CheckRollup((const telemetryControl::RollupRecord *)record);
 }
 
 /**
- * @brief OpCode 0x07 (not implemented)
- * @note Determine time till experiment should be done
- * 
- * @param _unused
+ * @brief Drops records torn by a power loss from the end
+ * of every log. Only the active segment of a log is written,
+ * so only its end is read, and boot time does not depend
+ * on how much is logged.
  * 
- * @return Time (milli-seconds) till experiment will complete
  */
-void i2c_get_time_left_in_experiment(i2cControl::parameter_t parameter){
-    //
+void log_recover(){
+    for(log_recovering = 0; log_recovering < experimentControl::logStreams; log_recovering++) {
+        spiffsControl::logSegments *log = log_segments[log_recovering];
+        file.recover(log[experimentControl::LOG_CSV].getActivePath(), 0, log_check_line);
+        file.recover(log[experimentControl::LOG_BINARY].getActivePath(), telemetryControl::sizeRecord, log_check_record);
+        file.recover(log[experimentControl::LOG_COMPRESSED].getActivePath(), telemetryControl::blockSize, log_check_block);
+    }
 }
 
 /**
- * @brief Opcode 0x08
- * @note Start experiment task and logging task
- * 
- * @param _unused 
+ * @brief Writes all buffered telemetry of every stream to flash.
+ * Call before stopping a logger, sleeping, restarting or reading the log.
  * 
- * @return VALID if experiment has been started;
- * @return INVALID if experiment was already active
  */
-void i2c_start_experiment(i2cControl::parameter_t parameter){
-    //check if experiment is already running
-    if(payload.status == experimentControl::EXP_INACTIVE) {
-        //start logging
-        xTaskCreatePinnedToCore(exp_log, "logger", 4096, (void *) &payload.sample_interval, 3, &exp_log_task, 1);
-
-        //start experiment
-        xTaskCreatePinnedToCore(exp_run, "experiment", 4096, NULL, 2, &exp_run_task, 1); //i2c on core 0
-        
-        i2c.write_one_byte(i2cControl::validByte);
+void log_flush(){
+    for(int i = 0; i < experimentControl::logStreams; i++) {
+        compressors[i].flush();
+        log_streams[i].getRing()->flush();
     }
-    else{
-        //experiment is already running
-        i2c.write_one_byte(i2cControl::invalidByte);
+    for(int tier = 0; tier < ROLLUP_TIERS; tier++) {
+        rollup_streams[tier].getRing()->flush();
     }
 }
 
+//raw partition store, used instead of the log files when spiffsControl::useLogStore
+spiffsControl::espPartition store_partition(spiffsControl::storePartitionLabel);
+spiffsControl::logStore store(&store_partition);
+spiffsControl::latencyHistogram store_latency; //append() latency of the store
+uint32_t store_raw_cursor = 0; //next record sent by get_log_raw
+bool store_raw_reading = false; //if true, a raw download is in progress
+constexpr size_t storeRawSlots = (i2cControl::bufferSize - 2) / spiffsControl::storeSlotSize; //whole slots per get_log_raw, framing included
+
+//keeps erased flash ready so log writes do not garbage collect or erase
+spiffsControl::flashMaintenance maintenance(spiffsControl::useLogStore ? &store : NULL);
+
 /**
- * @brief OpCode 0x29
- * @note Exit experimeent
+ * @brief Idle check for flash maintenance
  * 
- * @param 0x84 Exit experiment immediately
- * @param 0x33 Exit experiment upon completion of current PWM stage.
- * Cooldown period will then begin to log recovery.
+ * @return true if no logger is sampling or writing
+ */
+bool log_idle(){
+    return !payload.logger_status && !payload.passive_logger_busy;
+}
+
+/**
+ * @brief Get the latency histogram of foreground log writes
  * 
- * @return VALID once experiment has been stopped;
- * @return INVALID if experiment was not active;
- * @return UNKNOWN if undefined parameter
+ * @return spiffsControl::latencyHistogram* log store appends
+ * or log ring flushes
  */
-void i2c_stop_experiment(i2cControl::parameter_t parameter){
-    if(parameter == 0x84){
-        //Delete experiment task if it has been created
+spiffsControl::latencyHistogram *write_latency(){
+    if(spiffsControl::useLogStore) return &store_latency;
+    return log_ring->getLatency();
+}
+
+//lifetime flash write and erase counters, saved to NVS by maintenance
+spiffsControl::wearStats wear;
+
+/**
+ * @brief Counts a log store append in the latency histogram
+ * and the wear counters
+ * 
+ * @param bytes flash bytes written
+ * @param latency micro-seconds the append took
+ */
+void store_appended(uint32_t bytes, uint32_t latency){
+    store_latency.add(latency);
+    wear.addAppend(bytes, latency);
+}
+
+/**
+ * @brief Counts a log store sector erase in the wear counters
+ * 
+ * @param sector erased sector
+ */
+void store_erased(uint32_t sector){
+    wear.addErase(sector);
+}
+
+//stretches logger intervals as the partition fills
+spiffsControl::storagePolicy policy;
+
+/**
+ * @brief Get the bytes a logged sample takes in flash, in
+ * the current log format
+ * 
+ * @return uint32_t bytes per sample; an upper bound for .csv
+ * lines. Compressed samples vary in size; the largest of the
+ * last blocks sealed, or the worst case before any is sealed.
+ */
+uint32_t sample_flash_size(){
+    if(spiffsControl::useLogStore) return spiffsControl::storeSlotSize;
+    if(payload.log_format == experimentControl::LOG_BINARY) return telemetryControl::sizeRecord;
+    if(payload.log_format == experimentControl::LOG_COMPRESSED) {
+        int bits = 0;
+        for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+            if(compressors[stream].getSampleBits() > bits) bits = compressors[stream].getSampleBits();
+        }
+        return ((bits > 0 ? bits : telemetryControl::maxSampleBits) + 7) / 8;
+    }
+    return telemetryControl::sizeJournalLine;
+}
+
+/**
+ * @brief Get how many samples a logger writes per hour, at
+ * its sampling interval (as throttled by the storage policy)
+ * or its stream's rate limit, whichever is longer
+ * 
+ * @param stream experimentControl log stream of the logger
+ * @return uint32_t samples per hour
+ */
+uint32_t stream_samples_per_hour(uint8_t stream){
+    uint32_t interval = stream == experimentControl::LOG_STREAM_EXPERIMENT ? payload.sample_interval : payload.sample_passive_interval;
+
+    interval = policy.stretch(stream, interval);
+
+    if(log_streams[stream].getInterval() > interval) interval = log_streams[stream].getInterval();
+    return interval > 0 ? 3600000 / interval : 0;
+}
+
+/**
+ * @brief Get the flash the log can still be written to before
+ * it is full and old records are evicted or overwritten
+ * 
+ * @return uint32_t bytes
+ */
+uint32_t log_free_bytes(){
+    if(spiffsControl::useLogStore) {
+        uint32_t kept = store.getNext() - store.getOldest();
+        return kept < store.getCapacity() ? (store.getCapacity() - kept) * spiffsControl::storeSlotSize : 0;
+    }
+
+    size_t total = 0, used = 0;
+    if(esp_spiffs_info(NULL, &total, &used) != ESP_OK) return 0;
+    return total > used ? total - used : 0;
+}
+
+//replaces closed .csv segments with compressed archives between experiments
+spiffsControl::logCompactor compactor;
+
+/**
+ * @brief Hands a sealed block of a segment archive to the compactor
+ * 
+ * @param block compressed block
+ * @param size length of block in bytes
+ */
+void compact_block(const uint8_t *block, int size){
+    compactor.write(block, size);
+}
+
+telemetryControl::Compressor compact_compressor(compact_block); //only used by the compactor task
+
+/**
+ * @brief Encodes a .csv log line into the archive being
+ * written. Called by compactor.
+ * 
+ * @param line .csv line without the newline, NULL to seal the last block
+ * @param size length of line in bytes
+ * @return true if the line was a sample
+ */
+bool compact_line(const char *line, size_t size){
+    telemetryControl::Telemetry capture;
+
+    if(line == NULL) {
+        compact_compressor.flush();
+        return false;
+    }
+    if(!capture.FromCSV(line)) return false;
+
+    compact_compressor.append(&capture);
+    return true;
+}
+
+/**
+ * @brief Idle check for log compaction
+ * 
+ * @return true if no experiment is running and no logger is
+ * sampling or writing
+ */
+bool compact_idle(){
+    return payload.status == experimentControl::EXP_INACTIVE && log_idle();
+}
+
+//downloads of the stream read over i2c; each has its own position, so get_log and get_log_range do not disturb each other
+spiffsControl::logReader log_reader(&log_streams[experimentControl::LOG_STREAM_EXPERIMENT], &store); //get_log and seek_log
+spiffsControl::logReader range_reader(&log_streams[experimentControl::LOG_STREAM_EXPERIMENT], &store); //get_log_range
+
+//read sessions with a watermark per consumer and stream, see i2c_get_session_log(); indexed by log stream, then session
+spiffsControl::sessionReader sessions[experimentControl::logStreams][spiffsControl::maxSessions];
+
+//downloads should not touch the heap, see i2c_get_storage_metric()
+uint32_t download_lines = 0; //lines sent by get_log, get_log_range and get_session_log since boot
+uint32_t download_heap_lines = 0; //of those, lines that left less heap free than before they were read
+
+/**
+ * @brief Sends a downloaded line, then reads the next block of
+ * the log file while the line is clocked out
+ * 
+ * @param line span of the line
+ * @param heap_free free heap before the line was read
+ * @param reader reader of the line, NULL if it does not read ahead
+ */
+void download_send(const spiffsControl::lineSpan *line, size_t heap_free, spiffsControl::logReader *reader){
+    i2c.write_bytes(line->data, line->size);
+    if(reader != NULL) reader->prefetch();
+
+    download_lines++;
+    if(heap_caps_get_free_size(MALLOC_CAP_DEFAULT) < heap_free) {
+        download_heap_lines++;
+    }
+}
+
+/**
+ * @brief Starts get_log and get_log_range over on the stream
+ * read over i2c, e.g. when the log is cleared, its format
+ * changes or another stream is selected
+ * 
+ */
+void downloads_restart(){
+    log_reader.setStream(&log_streams[payload.log_stream]);
+    range_reader.setStream(&log_streams[payload.log_stream]);
+}
+
+/**
+ * @brief Get a session of the stream read over i2c
+ * 
+ * @param id session number
+ * @return spiffsControl::sessionReader* session
+ */
+spiffsControl::sessionReader *session_of(int id){
+    return &sessions[payload.log_stream][id];
+}
+
+/**
+ * @brief Restarts every session of every stream from the first
+ * record, e.g. when the log is cleared or its format changes
+ * 
+ */
+void sessions_reset(){
+    for(int i = 0; i < spiffsControl::maxSessions; i++) {
+        for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+            sessions[stream][i].reset();
+        }
+    }
+}
+
+/**
+ * @brief Rewinds every session of the read stream to its
+ * watermark, after the read stream changes. Samples read but
+ * not acknowledged are read again.
+ * 
+ */
+void sessions_rewind(){
+    for(int i = 0; i < spiffsControl::maxSessions; i++) {
+        session_of(i)->rewind();
+    }
+}
+
+/**
+ * @brief Changes the format the loggers write. Every stream
+ * carries on in the log files of the new format.
+ * @note only call from the i2c task, which owns the readers and
+ * sessions it restarts, while no logger is active
+ * 
+ * @param format experimentControl log format
+ */
+void log_set_format(uint8_t format){
+    //seal the last block, so no samples wait in a compressor of the old format
+    for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+        compressors[stream].flush();
+    }
+
+    payload.log_format = format;
+    for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+        log_streams[stream].getRing()->setLog(log_segments_of(stream, payload.log_format), log_record_size(payload.log_format));
+    }
+    downloads_restart();
+    if(!spiffsControl::useLogStore) sessions_reset(); //watermarks count records of the old file
+    ESP_LOGI(TAG, "Log Format set to %i", (int)payload.log_format);
+}
+
+/**
+ * @brief Keeps the log format in NVS, so the loggers carry on
+ * in the same files after a restart
+ * 
+ * @param format experimentControl log format
+ */
+void log_save_format(uint8_t format){
+    nvs_handle_t handle;
+
+    esp_err_t ret = nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &handle);
+    if(ret == ESP_OK) {
+        ret = nvs_set_u8(handle, SETTINGS_KEY_LOG_FORMAT, format);
+        if(ret == ESP_OK) ret = nvs_commit(handle);
+        nvs_close(handle);
+    }
+    if(ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save log format (%s)", esp_err_to_name(ret));
+    }
+}
+
+/**
+ * @brief Points the rings at the log files of the format kept
+ * in NVS. Session watermarks were kept in the same format, so
+ * they are not reset.
+ * @note call once NVS is up and before any logger runs
+ */
+void log_restore_format(){
+    nvs_handle_t handle;
+    uint8_t format = payload.log_format;
+
+    if(nvs_open(SETTINGS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return; //nothing saved yet
+    }
+    nvs_get_u8(handle, SETTINGS_KEY_LOG_FORMAT, &format);
+    nvs_close(handle);
+
+    if(format > experimentControl::LOG_COMPRESSED || format == payload.log_format) {
+        return;
+    }
+
+    payload.log_format = format;
+    for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+        log_streams[stream].getRing()->setLog(log_segments_of(stream, payload.log_format), log_record_size(payload.log_format));
+    }
+    ESP_LOGI(TAG, "Log Format restored to %i", (int)payload.log_format);
+}
+
+/**
+ * @brief Applies the storage policy to a logger. Measures the
+ * free flash every policyCheckInterval, then sets the logger's
+ * sampling interval for the tier that applies.
+ * @note called by the logger while it is marked busy, so it is
+ * not stopped while it holds the SPIFFS lock
+ * 
+ * @param stream experimentControl log stream of the logger
+ * @param interval sampling interval set for the logger (milli-seconds)
+ */
+void log_throttle(uint8_t stream, uint32_t interval){
+    if(policy.due()) {
+        policy.update(log_free_bytes());
+    }
+    sampler.setInterval(stream, policy.stretch(stream, interval));
+}
+
+/* Task Handles */
+
+TaskHandle_t exp_run_task = NULL;
+TaskHandle_t exp_log_task = NULL;
+TaskHandle_t exp_plog_task = NULL;
+
+/* Tasks */
+
+/**
+ * @brief Task that scans i2c bus for message. If message received,
+ * process opcode and parameter handshake interaction. Calls
+ * i2c_handler associated to opcode. Task does not self-delete.
+ * 
+ * @param pvParameters none
+ */
+void i2c_scan(void *pvParameters){
+    (void)pvParameters;
+
+    while(1){
+        i2c.update();
+    }
+}
+
+//what a logger task samples at and the stream it logs to, see exp_log()
+struct loggerArgs{
+    experimentControl::uint32_t *interval; //time (milli-seconds) between samples
+    uint8_t stream; //experimentControl log stream
+    TaskHandle_t *task; //logger task, cleared by the logger as it ends
+    volatile bool stop; //if true, the logger ends once its current sample is appended
+};
+loggerArgs experiment_logger = {&payload.sample_interval, experimentControl::LOG_STREAM_EXPERIMENT, &exp_log_task, false};
+loggerArgs passive_logger = {&payload.sample_passive_interval, experimentControl::LOG_STREAM_PASSIVE, &exp_plog_task, false};
+
+void exp_log(void *pvParameters);
+
+/**
+ * @brief Starts a logger task on core 1
+ * 
+ * @param logger loggerArgs of the logger
+ * @param name task name
+ * @param priority task priority
+ */
+void logger_start(loggerArgs *logger, const char *name, UBaseType_t priority){
+    logger->stop = false;
+    xTaskCreatePinnedToCore(exp_log, name, 4096, (void *) logger, priority, logger->task, 1);
+}
+
+/**
+ * @brief Asks a logger task to end and waits until it has
+ * @note The logger deletes itself once its current sample is
+ * appended, so it never ends holding a stream's buffers or a
+ * lock. Loggers are never deleted with vTaskDelete().
+ * 
+ * @param logger loggerArgs of the logger
+ */
+void logger_stop(loggerArgs *logger){
+    if(*logger->task == NULL){
+        return;
+    }
+
+    logger->stop = true;
+    sampler.unsubscribe(logger->stream); //wakes the logger if it waits on a sweep
+    while(*logger->task != NULL){
+        vTaskDelay(1);
+    }
+}
+
+/**
+ * @brief Waits in the experiment task, returning early if the
+ * experiment is halted (see i2c_stop_experiment())
+ * 
+ * @param length time to wait (milli-seconds)
+ * @return true if the wait ran its length;
+ * @return false if the experiment was halted
+ */
+bool exp_wait(uint32_t length){
+    //halting also notifies the task, so a halt after this check still ends the wait
+    if(!payload.halt_flag){
+        ulTaskNotifyTake(pdTRUE, length / portTICK_PERIOD_MS);
+    }
+    return !payload.halt_flag;
+}
+
+/**
+ * @brief Task that runs experiment procedure as defined by the
+ * Experiment struct. Logs telemetry data to SPI Flash
+ * storage throughout procedure. Task deletes upon experiment
+ * completion, or once halted.
+ * 
+ * @param pvParameters none
+ */
+void exp_run(void *pvParameters){
+    (void)pvParameters;
+
+    while(1){
+        //check if experiment is already running
         if(payload.status){
-            ESP_LOGD(TAG_i2c, "Stopping Experiment");
+            //exit
+        }
+
+        //indicate that experiment is active
+        ESP_LOGI(TAG_task, "Experiment Starting");
+        payload.status = experimentControl::EXP_STARTUP;
+
+        //reset current stage counter
+        payload.current_stage = 0;
+
+        //log baseline
+        ESP_LOGI(TAG_task, "Logging Baseline (%i ms)", (int)payload.startup_length);
+        bool running = exp_wait(payload.startup_length);
+
+        if(running){
+            //reset pwm out
+            pwm.setPWM(payload.pwm_period, 0);
+            pwm.startPWM();
+
+            payload.status = experimentControl::EXP_ACTIVE;
+        }
+
+        //stage loop
+        while(running && payload.current_stage < payload.stage_count){
+            //check for experiment exit
+            if(payload.stop_flag){
+                payload.stop_flag = false;
+                pwm.pausePWM();
+                break;
+            }
+
+            //set pwm to stage pwm param
+            ESP_LOGI(TAG_task, "Advancing to Stage %i (%i ms)", (int)payload.current_stage, (int)payload.length[payload.current_stage]);
+            pwm.setDutyCycle(payload.pwm_duty[payload.current_stage]);
+
+            //wait stage length
+            running = exp_wait(payload.length[payload.current_stage]);
+            
+            payload.current_stage++;
+        }
+
+        //turn off pwm
+        pwm.pausePWM();
+
+        if(running){
+            payload.status = experimentControl::EXP_COOLDOWN;
 
-            //delete experiment task
-            vTaskDelete(exp_run_task);
-            payload.status = experimentControl::EXP_INACTIVE;
-            ESP_LOGI(TAG_i2c, "Experiment Halted");
+            //post-experiment log
+            ESP_LOGI(TAG_task, "Logging cooldown (%i ms)", (int)payload.cooldown_length);
+            exp_wait(payload.cooldown_length);
+        }
+
+        //turn logger off
+        logger_stop(&experiment_logger);
+        log_flush();
+
+        //the last segment of the run can be compacted
+        log_streams[experimentControl::LOG_STREAM_EXPERIMENT].getRing()->seal();
+
+        //exit task
+        ESP_LOGI(TAG_task, running ? "Experiment Completed" : "Experiment Halted");
+        payload.status = experimentControl::EXP_INACTIVE;
+        exp_run_task = NULL;
+        vTaskDelete(NULL);
+    }
+}
+
+/**
+ * @brief Task that discretely records system telemetry to SPI
+ * Flash storage on a set inerval. Task deletes once asked to
+ * stop, see logger_stop().
+ * @note Samples are only copied into the stream's buffers;
+ * stream_writer writes them to flash
+ * 
+ * @param pvParameters loggerArgs of the logger
+ */
+void exp_log(void *pvParameters){
+    loggerArgs *args = (loggerArgs *) pvParameters;
+    spiffsControl::logStream *stream = &log_streams[args->stream];
+    spiffsControl::ringBuffer *ring = stream->getRing();
+    telemetryControl::Compressor *stream_compressor = &compressors[args->stream];
+    bool *busy = args->stream == experimentControl::LOG_STREAM_EXPERIMENT ? &payload.logger_status : &payload.passive_logger_busy;
+    ESP_LOGI(TAG_task, "Logger started: interval %ims, stream 0x%02X", (int)*args->interval, stream->getTag());
+    
+    //objects to hold log data
+    telemetryControl::Telemetry capture;
+    char line[telemetryControl::sizeJournalLine];
+    telemetryControl::Record record;
+    adcControl::snapshot sweep;
+
+    //the sampling service wakes the logger on its interval
+    sampler.subscribe(args->stream, policy.stretch(args->stream, *args->interval));
+
+    while(!args->stop){
+        //wait interval
+        if(!sampler.wait(args->stream, portMAX_DELAY)){
+            continue;
+        }
+
+        //skip samples over the stream's rate limit
+        if(!stream->admit()){
+            continue;
+        }
+
+        //set logger status as active
+        *busy = true;
+
+        //sample slower as the partition fills
+        log_throttle(args->stream, *args->interval);
+
+        //capture time and temperature data of the newest sweep
+        sampler.latest(&sweep);
+        capture.setTime(sweep.seconds, sweep.microseconds);
+        for(int sensor_number = 0; sensor_number < telemetryControl::numSensors; sensor_number++){
+            //Put data into Telemetry object
+            capture.setTemp(sensor_number, sweep.temperature[sensor_number]);
+        }
+
+        //capture heater data
+        if(pwm.getStatus()){
+            //if pwm is on
+            capture.setPWM(pwm.getDutyCycle(), pwm.getCyclePeriod());
+        }
+        else{
+            //if pwm is off
+            capture.setPWM(0, pwm.getCyclePeriod());
+        }
+
+        //log telemetry
+        if(spiffsControl::useLogStore){
+            capture.ToRecord(&record);
+            store.append(&record, sizeof(record), stream->getTag());
+        }
+        else if(payload.log_format == experimentControl::LOG_BINARY){
+            capture.ToRecord(&record);
+            ring->append(&record, sizeof(record));
+        }
+        else if(payload.log_format == experimentControl::LOG_COMPRESSED){
+            stream_compressor->append(&capture);
+        }
+        else{
+            int length = capture.ToCSV(line);
+            length = telemetryControl::JournalCSV(line, length, log_sequence[args->stream]++);
+            ring->append(line, length);
+        }
+
+        //summaries of long passive campaigns
+        if(args->stream == experimentControl::LOG_STREAM_PASSIVE && !spiffsControl::useLogStore){
+            for(int tier = 0; tier < ROLLUP_TIERS; tier++){
+                rollups[tier].append(&capture);
+            }
+        }
+
+        //set logger status as inactive
+        *busy = false;
+    }
+
+    //exit task
+    sampler.unsubscribe(args->stream);
+    ESP_LOGI(TAG_task, "Logger stopped: stream 0x%02X", stream->getTag());
+    *args->task = NULL;
+    vTaskDelete(NULL);
+}
+
+/* I2C Call Functions */
+
+/**
+ * @brief Function called when an undefined opcode is
+ * received.
+ * 
+ * @return nothing
+ */
+void i2c_unused(i2cControl::parameter_t parameter){
+    ESP_LOGW(TAG_i2c, "Undefined Opcode");
+}
+
+/**
+ * @brief Function called when an opcode is ignored
+ * 
+ * @return nothing
+ */
+void i2c_ignore(i2cControl::parameter_t parameter){
+    ESP_LOGI(TAG_i2c, "OpCode Ignored");
+}
+
+/**
+ * @brief OpCode: 0x21
+ * @note Performs a software reset. When the function is 
+ * called, execution of the program stops, both CPUs are 
+ * reset, the application is loaded by the bootloader and 
+ * starts execution again. 
+ * 
+ * @param 0x49 Restart I2C
+ * @param 0x05 Restart Device
+ * 
+ * @return VALID upon successful reset;
+ * @return UNKNOWN if undefined parameter
+ */
+void i2c_restart_device(i2cControl::parameter_t parameter){
+    if(parameter == 0x49) { //Restart I2C
+        ESP_LOGI(TAG_i2c, "Restarting I2C");
+        sensor.powerOff();
+        i2c.reset();
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else if(parameter == 0x05) { //Restart Device
+        ESP_LOGI(TAG_i2c, "Restarting Device");
+        if((boot_ready & BOOT_NEEDS_LOG) == BOOT_NEEDS_LOG) {
+            if(!payload.passive_logger_busy) rollup_seal();
+            log_flush();
+        }
+        wear.save(true);
+        esp_restart();
+    }
+    else {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+    }
+}
+
+
+/**
+ * @brief OpCode 0x03
+ * @note Device will wake up from sleep mode when the
+ * SCL pin is brought to low. 
+ * 
+ * @param _unused
+ * 
+ * @return VALID upon wake
+ */
+void i2c_wake_device(i2cControl::parameter_t parameter);
+
+/**
+ * @brief OpCode 0x02
+ * @note Puts device in light sleep mode. In Light-sleep 
+ * mode, the digital peripherals, most of the RAM, and 
+ * CPUs are clock-gated and their supply voltage is 
+ * reduced. Upon exit from Light-sleep, the digital 
+ * peripherals, RAM, and CPUs resume operation and their 
+ * internal states are preserved.
+ * 
+ * @param _unused
+ * 
+ * @return VALID before sleep
+ */
+void i2c_sleep_device(i2cControl::parameter_t parameter){
+    //set up sleep mode
+    gpio_wakeup_enable(i2c.get_scl_io_pin(), GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+    //turn off any GPIO outputs
+    pwm.pausePWM();
+    sensor.powerOff();
+
+    //store buffered samples
+    log_flush();
+    wear.save(true);
+
+    i2c.write_one_byte(i2cControl::validByte);
+
+    //put device to sleep
+    ESP_LOGI(TAG_i2c, "going to sleep...");
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+    esp_light_sleep_start();
+
+    /*device will wake when the i2c bus is used. OpCode
+    0x03 (Wake Device)'s should be used to wake the device
+    so it's i2c handler is run immediately upon waking.*/
+    i2c_wake_device(i2cControl::validByte);
+}
+
+//declared earlier so that it can be used by 0x02
+void i2c_wake_device(i2cControl::parameter_t parameter){
+    ESP_LOGI(TAG_i2c, "waking up...");
+    i2c.write_one_byte(i2c.get_device_address());
+    sensor.powerOn();
+}
+
+/**
+ * @brief OpCode 0x04 (deprecated)
+ * @note 
+ * 
+ * @param _unused
+ * 
+ * @return
+ */
+void i2c_run_system_check(i2cControl::parameter_t parameter){
+
+}
+
+/**
+ * @brief Formerly Opcode 0x25 (deprecated, not installed)
+ * @note Opcode 0x25 is now Commit Session, see
+ * i2c_commit_session(). Device would run a brief system
+ * check on the specified system and return a metric
+ * related to its performance.
+ * 
+ * @param 0x54 PWM Signal Generator
+ * @param 0x49 I2C Slave
+ * @param 0x7C SPI Flash
+ * @param 0x25 ADC Temperature Sensors
+ * 
+ * @return 0x00 Installed;
+ * @return 0x01 Not Installed;
+ * @return 0x02 Active;
+ * @return 0x03 Inactive;
+ * @return UNKNWON if parameter is undefined
+ */
+void i2c_get_system_check_result(i2cControl::parameter_t parameter){
+    //see onenotes of implementation suggestion
+}
+
+/**
+ * @brief OpCode 0x07 (not implemented)
+ * @note Determine time till experiment should be done
+ * 
+ * @param _unused
+ * 
+ * @return Time (milli-seconds) till experiment will complete
+ */
+void i2c_get_time_left_in_experiment(i2cControl::parameter_t parameter){
+    //
+}
+
+/**
+ * @brief Opcode 0x08
+ * @note Start experiment task and logging task
+ * 
+ * @param _unused 
+ * 
+ * @return VALID if experiment has been started;
+ * @return INVALID if experiment was already active
+ */
+void i2c_start_experiment(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG | BOOT_NEEDS_ADC)) {
+        return;
+    }
+
+    //check if experiment is already running
+    if(payload.status == experimentControl::EXP_INACTIVE) {
+        //start logging
+        logger_start(&experiment_logger, "logger", 3);
+
+        //start experiment
+        xTaskCreatePinnedToCore(exp_run, "experiment", 4096, NULL, 2, &exp_run_task, 1); //i2c on core 0
+        
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        //experiment is already running
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x29
+ * @note Exit experimeent
+ * 
+ * @param 0x84 Exit experiment immediately
+ * @param 0x33 Exit experiment upon completion of current PWM stage.
+ * Cooldown period will then begin to log recovery.
+ * 
+ * @return VALID once experiment has been stopped;
+ * @return INVALID if experiment was not active;
+ * @return UNKNOWN if undefined parameter
+ */
+void i2c_stop_experiment(i2cControl::parameter_t parameter){
+    if(parameter == 0x84){
+        //Delete experiment task if it has been created
+        if(payload.status){
+            ESP_LOGD(TAG_i2c, "Stopping Experiment");
+
+            //halt experiment task, it stops its logger and deletes itself
+            payload.halt_flag = true;
+            xTaskNotifyGive(exp_run_task);
+            while(exp_run_task != NULL){
+                vTaskDelay(1);
+            }
+            payload.halt_flag = false;
+            ESP_LOGI(TAG_i2c, "Experiment Log Halted");
+
+            i2c.write_one_byte(i2cControl::validByte);
+        }
+        else{
+            //experiment is not active
+            i2c.write_one_byte(i2cControl::invalidByte);
+        }
+
+    }
+    else if(parameter == 0x33){
+        //check if experiment is active
+        if(payload.status){
+            ESP_LOGD(TAG_i2c, "Raising experiment stop flag");
+            //prompt experiment to end after current stage
+            payload.stop_flag = true;
+
+            i2c.write_one_byte(i2cControl::validByte);
+        }
+        else{
+            //experiment is not active
+            i2c.write_one_byte(i2cControl::invalidByte);
+        }
+    }
+    else { //Invalid Parameter
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x06
+ * @note Check if the experiment is active
+ * 
+ * @param _unused
+ * 
+ * @return VALID if experiment is active;
+ * @return INVALID if experiment is inactive
+ */
+void i2c_get_experiment_status(i2cControl::parameter_t parameter){
+    if(payload.status){
+        //xperiment is active
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        //experiment is inactive
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x16
+ * @note Get the current PWM stage that the experiment is on
+ * 
+ * @param _unused
+ * 
+ * @return Integer number of stage;
+ * @return INVALID if experiment is not active
+ */
+void i2c_get_current_stage(i2cControl::parameter_t parameter){
+    if(payload.status == experimentControl::EXP_ACTIVE){
+        i2c.write_one_byte(payload.current_stage);
+    }
+    
+    if(payload.status == experimentControl::EXP_INACTIVE){
+        i2c.write_one_byte(experimentControl::EXP_INACTIVE);
+    }
+
+    if(payload.status == experimentControl::EXP_STARTUP){
+        i2c.write_one_byte(experimentControl::EXP_STARTUP);
+    }
+
+    if(payload.status == experimentControl::EXP_COOLDOWN){
+        i2c.write_one_byte(experimentControl::EXP_COOLDOWN);
+    }
+}
+
+/**
+ * @brief OpCode 0x2A
+ * @note Set the number of stages that the experiment will progress
+ * through. Default is 16 stages.
+ * 
+ * @param uint8_t Number of Stages
+ * 
+ * @return VALID if value was set;
+ * @return INVALID if experiment was active and value was not set
+ */
+void i2c_set_number_of_stages(i2cControl::parameter_t parameter){
+    if(!payload.status){
+        payload.set_stage_count(parameter);
+        ESP_LOGI(TAG_i2c, "Exp Stage Count set to %i", (int)payload.stage_count);
+
+        payload.generate_pwm_duty_array();
+        ESP_LOGI(TAG_i2c, "Exp PWM progression generated");
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        //do not allow changing while experiment is active
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x8D
+ * @note Set the amount of time that the experiment will spend on each
+ * PWM stage.
+ * 
+ * @param uint32_t Time (milli-seconds)
+ * 
+ * @return VALID if value was set;
+ * @return INVALID if experiment was active and value was not set
+ */
+void i2c_set_stage_length(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        payload.set_stage_length(parameter);
+        ESP_LOGI(TAG_i2c, "Exp All Stage Lengths set to %i ms", (int)payload.length[0]);
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x9D
+ * @note Set the amount of time that the experiment will spend
+ * on a specified stage.
+ * 
+ * @param Stage
+ * @param PWM_Duty_%
+ * 
+ * @return  
+ */
+void i2c_set_individual_length(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        //parse parameter
+        uint8_t stage = (parameter >> 24) & 0xFF;
+        uint32_t length = parameter & 0xFFFFFF;
+
+        ESP_LOGW(TAG_i2c, "stage: %i, length %i", (int)stage, (int)length);
+
+        //check values
+        if(stage >= payload.stage_count){
+            i2c.write_one_byte(0xFD);
+        }
+        else{
+            //set value
+            payload.length[stage] = length;
+            ESP_LOGI(TAG_i2c, "Exp PWM at Stage #%u set to %lu%%", stage, payload.length[stage]);
+
+            i2c.write_one_byte(i2cControl::validByte);
+        }
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x98
+ * @note Set the amount of time the experiment will spend before
+ * starting the first stage of the experiment. The PWM output will
+ * be turned off and the log task will be recording temperature
+ * data. Useful to get baseline temperatures before experiment.
+ * 
+ * @param uint32_t Time (milli-seconds)
+ * 
+ * @return VALID if value was set;
+ * @return INVALID if experiment was active and value was not set 
+ */
+void i2c_set_startup_length(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        payload.startup_length = parameter;
+        ESP_LOGI(TAG_i2c, "Exp Startup Length set to %i ms", (int)payload.startup_length);
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x99
+ * @note Set the amount of time the experiment will spend after
+ * completing the last stage of the experiment. The PWM output
+ * will be turned off and the log will be recording temperature
+ * data. Useful to observe how the temperatures normalize.
+ * 
+ * @param uint32_t Time (milli-seconds)
+ * 
+ * @return VALID if value was set;
+ * @return INVALID if experimnent was active and value was not set
+ */
+void i2c_set_cooldown_length(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        payload.cooldown_length = parameter;
+        ESP_LOGI(TAG_i2c, "Exp Cooldown Length set to %i ms", (int)payload.cooldown_length);
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x5A
+ * @note Set the PWM Duty % of a specific stage
+ * 
+ * @param Stage
+ * @param PWM_Duty_%
+ * 
+ * @return  
+ */
+void i2c_set_individual_pwm(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        //parse parameter
+        uint8_t stage = (parameter >> 8) & 0xFF;
+        uint8_t pwm = parameter & 0xFF;
+
+        //check values
+        if(stage >= payload.stage_count){
+            i2c.write_one_byte(0xFD);
+        }
+        else if(pwm > 100){
+            i2c.write_one_byte(0xFE);
+        }
+        else{
+            //set value
+            payload.length[stage] = pwm;
+            ESP_LOGI(TAG_i2c, "Exp PWM at Stage #%i set to %i%%", (int)stage, (int)payload.length[stage]);
+
+            i2c.write_one_byte(i2cControl::validByte);
+        }
+       
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x9B (untested)
+ * @note Set the PWM output signal's period attribute. System
+ * intended for periods greater than one second but can handle
+ * values less than one second as well.
+ * 
+ * @param float Time (seconds)
+ * 
+ * @return VALID if value was set
+ * @return INVALID if experiment was active and value was not set 
+ */
+void i2c_set_pwm_period(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        //convert raw hex to float
+        union {
+            float float_data;
+            uint32_t uint_data;
+        } float_to_uint = { .uint_data = parameter };
+
+        //check float value
+        if(float_to_uint.float_data < pwmControl::minPeriod) {
+            i2c.write_one_byte(0xFD);
+        }
+        else{
+            payload.pwm_period = float_to_uint.float_data;
+            ESP_LOGI(TAG_i2c, "Exp PWM Period set to %f s", (float)payload.pwm_period);
+
+            i2c.write_one_byte(i2cControl::validByte);
+        }
+
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x4E (untested)
+ * @note Set the temperature threshold to trigger safe mode
+ * 
+ * @param float Temperature (kelvin) 
+ * 
+ * @return VALID upon setting value
+ */
+void i2c_set_max_temperature(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        //convert raw hex to float
+        union {
+            float float_data;
+            uint32_t uint_data;
+        } float_to_uint = { .uint_data = parameter };
+
+        payload.max_temperature = float_to_uint.float_data;
+        ESP_LOGI(TAG_i2c, "Exp Max Temperature set to %f s", (float)payload.max_temperature);
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x97
+ * @note Set the amount of time that the log task will pass in
+ * between samples. A lower number means more frequent samples
+ * and a higher number means less frequent samples.
+ * 
+ * @param uint32_t Time (milli-seconds)
+ * 
+ * @return VALID if value was set
+ * @return INVALID if experiment was active and value was not set 
+ */
+void i2c_set_sampling_interval(i2cControl::parameter_t parameter){
+    //do not allow changing while experiment is active
+    if(!payload.status){
+        payload.sample_interval = parameter;
+        ESP_LOGI(TAG_i2c, "Exp Sampling Interval set to %i ms", (int)payload.sample_interval);
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x9E
+ * @note Set the amount of time that the passivelog task
+ * will pass in between samples. A lower number means more
+ * frequent samples and a higher number means less frequent
+ * samples.
+ * 
+ * @param uint32_t Time (milli-seconds)
+ * 
+ * @return VALID if value was set
+ * @return INVALID if task is active and value was not set 
+ */
+void i2c_set_passive_sampling_interval(i2cControl::parameter_t parameter){
+    //do not allow changing while task is active
+    if(!payload.passive_logger_status){
+        payload.sample_passive_interval = parameter;
+        ESP_LOGI(TAG_i2c, "Passive Sampling Interval set to %i ms", (int)payload.sample_passive_interval);
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
+    else{
+        i2c.write_one_byte(i2cControl::invalidByte);
+    }
+}
+
+/**
+ * @brief OpCode 0x0F
+ * @note Prepares experiment log file to be read by the
+ * I2C system. Telemetry still buffered in RAM is written
+ * to flash. This function must be called before get_log
+ * 
+ * @param _unused
+ * 
+ * @return VALID when log is ready to be read :)
+ */
+void i2c_prepare_log(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
+    }
 
-            //delete logger task
-            while(payload.logger_status == true){
-                ESP_LOGD(TAG_i2c, "..");
-            }
-            vTaskDelete(exp_log_task);
-            ESP_LOGI(TAG_i2c, "Experiment Log Halted");
+    log_flush();
 
-            //turn off pwm
-            pwm.pausePWM();
+    i2c.write_one_byte(i2cControl::validByte);
+}
 
-            i2c.write_one_byte(i2cControl::validByte);
-        }
-        else{
-            //experiment is not active
-            i2c.write_one_byte(i2cControl::invalidByte);
-        }
+/**
+ * @brief OpCode 0x11
+ * @note Returns an individual line from the experiment
+ * log file. This function must be called after prepare_log.
+ * The first call will return the first line, the second
+ * call will return the second line, etc... If there is no
+ * line to send, it will close the file. Log files are read
+ * from the oldest segment kept by the retention policy; a
+ * .csv download whose header was evicted gets a new one
+ * first. With the raw log
+ * store, records are read from the oldest stored. Binary and compressed
+ * logs are exported one sample at a time as .csv lines
+ * without the journal columns of the .csv log;
+ * records and blocks that fail their crc check are skipped.
+ * Compressed samples are only readable once their block has
+ * been sealed (block full or logger stopped).
+ * 
+ * @param _unused
+ * 
+ * @return string containing one line of log data
+ * @return INVALID if there is no log data to return
+ */
+void i2c_get_log(i2cControl::parameter_t parameter){
+    size_t heap_free = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    spiffsControl::lineSpan buffer;
 
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
     }
-    else if(parameter == 0x33){
-        //check if experiment is active
-        if(payload.status){
-            ESP_LOGD(TAG_i2c, "Raising experiment stop flag");
-            //prompt experiment to end after current stage
-            payload.stop_flag = true;
 
-            i2c.write_one_byte(i2cControl::validByte);
-        }
-        else{
-            //experiment is not active
-            i2c.write_one_byte(i2cControl::invalidByte);
-        }
+    if(log_reader.readNext(&buffer)) {
+        download_send(&buffer, heap_free, &log_reader);
     }
-    else { //Invalid Parameter
-        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+    else {
         i2c.write_one_byte(i2cControl::invalidByte);
     }
 }
 
 /**
- * @brief OpCode 0x06
- * @note Check if the experiment is active
+ * @brief OpCode 0x14
+ * @note Returns one window of a rollup tier: the count, min,
+ * max and mean of every passive logger sample in 1 or 10
+ * minutes of time, as a telemetryControl::RollupRecord (108
+ * bytes, crc-16 last). Windows are sealed once the next one
+ * starts or the passive logger stops, and each tier keeps its
+ * newest windows in a bounded log (about 15 hours of 1 minute
+ * windows, 10 days of 10 minute windows). The first call of
+ * a tier returns its oldest window kept; later calls carry on
+ * until every window is sent. Not available with the raw log
+ * store.
  * 
- * @param _unused
+ * @param 0x00 Next 1 minute window
+ * @param 0x01 Next 10 minute window
+ * @param 0x10 Open 1 minute window, not sealed yet
+ * @param 0x11 Open 10 minute window, not sealed yet
  * 
- * @return VALID if experiment is active;
- * @return INVALID if experiment is inactive
+ * @return RollupRecord
+ * @return INVALID if there are no more windows to send, the
+ * next call starts from the oldest window again; or the open
+ * window is empty or being updated
+ * @return UNKNOWN if undefined parameter
  */
-void i2c_get_experiment_status(i2cControl::parameter_t parameter){
-    if(payload.status){
-        //xperiment is active
-        i2c.write_one_byte(i2cControl::validByte);
+void i2c_get_rollup(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
     }
-    else{
-        //experiment is inactive
+
+    int tier = parameter & 0x0F;
+    bool open = parameter & 0x10;
+    telemetryControl::RollupRecord record;
+
+    if(tier >= ROLLUP_TIERS || (parameter & ~0x1F)) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+        return;
+    }
+
+    bool found;
+    if(spiffsControl::useLogStore) {
+        found = false;
+    }
+    else if(open) {
+        found = !payload.passive_logger_busy && rollups[tier].peek(&record);
+    }
+    else {
+        found = rollup_read_next(tier, &record);
+    }
+
+    if(found) {
+        i2c.write_bytes(&record, sizeof(record));
+    }
+    else {
         i2c.write_one_byte(i2cControl::invalidByte);
     }
 }
 
 /**
- * @brief OpCode 0x16
- * @note Get the current PWM stage that the experiment is on
+ * @brief OpCode 0x13
+ * @note Returns the next stored slots of the raw log store
+ * exactly as they are on flash, up to the i2c buffer size.
+ * The first call starts from the oldest record; later calls
+ * carry on until every record is sent. Slots are transmitted
+ * straight from the memory-mapped partition, with no copy.
+ * Each slot is a StoreHeader (sequence, length, tag, reserved,
+ * crc32) and its payload; the reader checks the sequence and
+ * crc, since records of every stream are sent and the oldest
+ * sector may be reused during the download. Only available
+ * in log store mode (CONFIG_SPIFFSCONTROL_LOG_STORE, off by
+ * default). Log files on SPIFFS are not memory-mapped; they
+ * are downloaded with get_log.
  * 
  * @param _unused
  * 
- * @return Integer number of stage;
- * @return INVALID if experiment is not active
+ * @return whole slots of the log store
+ * @return INVALID if there are no more slots to send, the next
+ * call starts from the oldest record again, or if the log is
+ * on SPIFFS
  */
-void i2c_get_current_stage(i2cControl::parameter_t parameter){
-    if(payload.status == experimentControl::EXP_ACTIVE){
-        i2c.write_one_byte(payload.current_stage);
+void i2c_get_log_raw(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
     }
-    
-    if(payload.status == experimentControl::EXP_INACTIVE){
-        i2c.write_one_byte(experimentControl::EXP_INACTIVE);
+
+    if(!spiffsControl::useLogStore) {
+        ESP_LOGW(TAG_i2c, "Raw download needs the log store, use get_log");
+        i2c.write_one_byte(i2cControl::invalidByte);
+        return;
     }
 
-    if(payload.status == experimentControl::EXP_STARTUP){
-        i2c.write_one_byte(experimentControl::EXP_STARTUP);
+    const uint8_t *slots;
+    if(!store_raw_reading) {
+        store_raw_cursor = store.getOldest();
+        store_raw_reading = true;
     }
+    if(store_raw_cursor < store.getOldest()) store_raw_cursor = store.getOldest();
 
-    if(payload.status == experimentControl::EXP_COOLDOWN){
-        i2c.write_one_byte(experimentControl::EXP_COOLDOWN);
+    size_t count = store.map(store_raw_cursor, storeRawSlots, &slots);
+
+    if(count > 0) {
+        i2c.write_bytes(slots, count * spiffsControl::storeSlotSize);
+        store_raw_cursor += count;
+    }
+    else {
+        store_raw_reading = false;
+        store.unmap();
+        i2c.write_one_byte(i2cControl::invalidByte);
     }
 }
 
 /**
- * @brief OpCode 0x2A
- * @note Set the number of stages that the experiment will progress
- * through. Default is 16 stages.
+ * @brief OpCode 0x61
+ * @note Moves the get_log position so the next get_log
+ * returns the requested line. Lets a dropped line be
+ * requested again without restarting the download. Lines
+ * of the log files are numbered from 0 (the .csv header, or
+ * the first sample of a binary log) at the last reset_log;
+ * lines evicted by the retention policy are gone. Log store
+ * lines are numbered from the oldest stored. The offset index
+ * finds the line without reading the lines before it.
  * 
- * @param uint8_t Number of Stages
+ * @param line line number (3 bytes)
  * 
- * @return VALID if value was set;
- * @return INVALID if experiment was active and value was not set
+ * @return VALID if the next get_log returns the line
+ * @return INVALID if there is no such line, or the log is
+ * compressed (samples can only be found by decoding blocks)
  */
-void i2c_set_number_of_stages(i2cControl::parameter_t parameter){
-    if(!payload.status){
-        payload.set_stage_count(parameter);
-        ESP_LOGI(TAG_i2c, "Exp Stage Count set to %i", (int)payload.stage_count);
-
-        payload.generate_pwm_duty_array();
-        ESP_LOGI(TAG_i2c, "Exp PWM progression generated");
+void i2c_seek_log(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
+    }
 
+    if(log_reader.seek(parameter)) {
+        ESP_LOGI(TAG_i2c, "Log position set to line %lu", parameter);
         i2c.write_one_byte(i2cControl::validByte);
     }
-    else{
-        //do not allow changing while experiment is active
+    else {
         i2c.write_one_byte(i2cControl::invalidByte);
     }
 }
 
 /**
- * @brief OpCode 0x8D
- * @note Set the amount of time that the experiment will spend on each
- * PWM stage.
+ * @brief OpCode 0x81
+ * @note Set the start of the time window returned by
+ * get_log_range. Restarts the range download.
  * 
- * @param uint32_t Time (milli-seconds)
+ * @param seconds window start (epoch seconds)
  * 
- * @return VALID if value was set;
- * @return INVALID if experiment was active and value was not set
+ * @return VALID
  */
-void i2c_set_stage_length(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        payload.set_stage_length(parameter);
-        ESP_LOGI(TAG_i2c, "Exp All Stage Lengths set to %i ms", (int)payload.length[0]);
+void i2c_set_log_range_start(i2cControl::parameter_t parameter){
+    range_reader.setWindow(parameter, range_reader.getLast());
+    ESP_LOGI(TAG_i2c, "Log range start set to %lu", (unsigned long)range_reader.getFirst());
 
-        i2c.write_one_byte(i2cControl::validByte);
-    }
-    else{
-        i2c.write_one_byte(i2cControl::invalidByte);
-    }
+    i2c.write_one_byte(i2cControl::validByte);
 }
 
 /**
- * @brief OpCode 0x9D
- * @note Set the amount of time that the experiment will spend
- * on a specified stage.
+ * @brief OpCode 0x82
+ * @note Set the end of the time window returned by
+ * get_log_range. Restarts the range download.
  * 
- * @param Stage
- * @param PWM_Duty_%
+ * @param seconds window end (epoch seconds), inclusive
  * 
- * @return  
+ * @return VALID
  */
-void i2c_set_individual_length(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        //parse parameter
-        uint8_t stage = (parameter >> 24) & 0xFF;
-        uint32_t length = parameter & 0xFFFFFF;
+void i2c_set_log_range_end(i2cControl::parameter_t parameter){
+    range_reader.setWindow(range_reader.getFirst(), parameter);
+    ESP_LOGI(TAG_i2c, "Log range end set to %lu", (unsigned long)range_reader.getLast());
 
-        ESP_LOGW(TAG_i2c, "stage: %i, length %i", (int)stage, (int)length);
+    i2c.write_one_byte(i2cControl::validByte);
+}
 
-        //check values
-        if(stage >= payload.stage_count){
-            i2c.write_one_byte(0xFD);
-        }
-        else{
-            //set value
-            payload.length[stage] = length;
-            ESP_LOGI(TAG_i2c, "Exp PWM at Stage #%u set to %lu%%", stage, payload.length[stage]);
+/**
+ * @brief OpCode 0x12
+ * @note Returns the next line of the experiment log with
+ * a time (seconds) inside the window set by 0x81 and 0x82,
+ * in the same format as get_log. Parts of the log with no
+ * samples in the window are skipped using the log index,
+ * so one stage can be downloaded out of a long log without
+ * reading the rest. Call prepare_log first. Has its own
+ * position, so it can be interleaved with get_log.
+ * 
+ * @param _unused
+ * 
+ * @return string containing one line of log data
+ * @return INVALID if there are no more lines in the window
+ */
+void i2c_get_log_range(i2cControl::parameter_t parameter){
+    size_t heap_free = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    spiffsControl::lineSpan buffer;
 
-            i2c.write_one_byte(i2cControl::validByte);
-        }
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
     }
-    else{
+
+    if(range_reader.readRange(&buffer)) {
+        download_send(&buffer, heap_free, &range_reader);
+    }
+    else {
         i2c.write_one_byte(i2cControl::invalidByte);
     }
 }
 
 /**
- * @brief OpCode 0x98
- * @note Set the amount of time the experiment will spend before
- * starting the first stage of the experiment. The PWM output will
- * be turned off and the log task will be recording temperature
- * data. Useful to get baseline temperatures before experiment.
+ * @brief OpCode 0x23
+ * @note Moves a read session back to its watermark, the
+ * last record it acknowledged. Lines read since the last
+ * commit_session will be returned again.
  * 
- * @param uint32_t Time (milli-seconds)
+ * @param session session number, from 0 to 3
  * 
- * @return VALID if value was set;
- * @return INVALID if experiment was active and value was not set 
+ * @return VALID
+ * @return UNKNOWN if undefined session
  */
-void i2c_set_startup_length(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        payload.startup_length = parameter;
-        ESP_LOGI(TAG_i2c, "Exp Startup Length set to %i ms", (int)payload.startup_length);
+void i2c_rewind_session(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
+    }
 
-        i2c.write_one_byte(i2cControl::validByte);
+    if(parameter >= spiffsControl::maxSessions) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+        return;
     }
-    else{
+
+    session_of(parameter)->rewind();
+
+    i2c.write_one_byte(i2cControl::validByte);
+}
+
+/**
+ * @brief OpCode 0x24
+ * @note Returns the next line of a read session, in the
+ * same format as get_log. A session starts after its
+ * watermark, so a consumer only downloads what was logged
+ * since its last commit, and keeps its position across a
+ * reset. Sessions do not share a position with get_log or
+ * with each other. Call prepare_log first.
+ * 
+ * @param session session number, from 0 to 3
+ * 
+ * @return string containing one line of log data
+ * @return INVALID if there are no new lines
+ * @return UNKNOWN if undefined session
+ */
+void i2c_get_session_log(i2cControl::parameter_t parameter){
+    size_t heap_free = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    spiffsControl::lineSpan buffer;
+
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
+    }
+
+    if(parameter >= spiffsControl::maxSessions) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+    }
+    else if(session_of(parameter)->readNext(&buffer)) {
+        download_send(&buffer, heap_free, NULL);
+    }
+    else {
         i2c.write_one_byte(i2cControl::invalidByte);
     }
 }
 
 /**
- * @brief OpCode 0x99
- * @note Set the amount of time the experiment will spend after
- * completing the last stage of the experiment. The PWM output
- * will be turned off and the log will be recording temperature
- * data. Useful to observe how the temperatures normalize.
+ * @brief OpCode 0x25
+ * @note Acknowledges every line a session has returned,
+ * moving its watermark up to them. The watermark is kept in
+ * NVS. For a compressed log, a block is acknowledged once
+ * all of its samples have been returned. Reuses the opcode
+ * of the deprecated system check result, which was never
+ * installed.
  * 
- * @param uint32_t Time (milli-seconds)
+ * @param session session number, from 0 to 3
  * 
- * @return VALID if value was set;
- * @return INVALID if experimnent was active and value was not set
+ * @return VALID if the watermark was saved
+ * @return INVALID if NVS error
+ * @return UNKNOWN if undefined session
  */
-void i2c_set_cooldown_length(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        payload.cooldown_length = parameter;
-        ESP_LOGI(TAG_i2c, "Exp Cooldown Length set to %i ms", (int)payload.cooldown_length);
+void i2c_commit_session(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
+    }
 
-        i2c.write_one_byte(i2cControl::validByte);
+    if(parameter >= spiffsControl::maxSessions) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+        return;
     }
-    else{
-        i2c.write_one_byte(i2cControl::invalidByte);
+
+    if(session_of(parameter)->commit() == ESP_OK) i2c.write_one_byte(i2cControl::validByte);
+    else i2c.write_one_byte(i2cControl::invalidByte);
+}
+
+/**
+ * @brief OpCode 0x26
+ * @note Returns the watermark of a read session: the
+ * number of log records it has acknowledged (.csv lines,
+ * binary records or compressed blocks), or the next store
+ * sequence number with the raw log store.
+ * 
+ * @param session session number, from 0 to 3
+ * 
+ * @return watermark (4 bytes)
+ * @return UNKNOWN if undefined session
+ */
+void i2c_get_session_watermark(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
     }
+
+    if(parameter >= spiffsControl::maxSessions) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+        return;
+    }
+
+    i2c.write_four_bytes(session_of(parameter)->getWatermark());
 }
 
 /**
- * @brief OpCode 0x5A
- * @note Set the PWM Duty % of a specific stage
+ * @brief OpCode 0x1C
+ * @note Deletes the log of every stream and the rollups,
+ * and creates blank logs. Not needed to make room; the oldest log segments
+ * are evicted under the retention policy (0x83, 0x84).
  * 
- * @param Stage
- * @param PWM_Duty_%
+ * @param _unused
  * 
- * @return  
+ * @return VALID upon log reset 
+ * @return INVALID if SPI error
  */
-void i2c_set_individual_pwm(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        //parse parameter
-        uint8_t stage = (parameter >> 8) & 0xFF;
-        uint8_t pwm = parameter & 0xFF;
+void i2c_reset_log(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
+    }
 
-        //check values
-        if(stage >= payload.stage_count){
-            i2c.write_one_byte(0xFD);
-        }
-        else if(pwm > 100){
-            i2c.write_one_byte(0xFE);
-        }
-        else{
-            //set value
-            payload.length[stage] = pwm;
-            ESP_LOGI(TAG_i2c, "Exp PWM at Stage #%i set to %i%%", (int)stage, (int)payload.length[stage]);
+    downloads_restart();
+    sessions_reset();
+    memset(log_sequence, 0, sizeof(log_sequence));
+
+    if(spiffsControl::useLogStore) {
+        if(store.clear() == ESP_OK) i2c.write_one_byte(i2cControl::validByte);
+        else i2c.write_one_byte(i2cControl::invalidByte);
+        return;
+    }
+
+    telemetryControl::Telemetry active;
+    char header[spiffsControl::buffer_size];
+    active.headerCSV(header);
+
+    for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+        //buffered samples belong to the old log
+        compressors[stream].flush();
+        log_streams[stream].getRing()->clear();
 
-            i2c.write_one_byte(i2cControl::validByte);
+        //erase the logs of the other formats
+        for(int format = experimentControl::LOG_CSV; format <= experimentControl::LOG_COMPRESSED; format++) {
+            if(format != payload.log_format) log_segments[stream][format].clear();
         }
-       
+
+        //add header
+        file.addLine(log_segments[stream][experimentControl::LOG_CSV].getActivePath(), header);
     }
-    else{
-        i2c.write_one_byte(i2cControl::invalidByte);
+
+    //the rollups summarize the old log
+    for(int tier = 0; tier < ROLLUP_TIERS; tier++) {
+        rollup_readers[tier].rewind();
+        rollup_streams[tier].getRing()->clear();
     }
+
+    i2c.write_one_byte(i2cControl::validByte);
 }
 
 /**
- * @brief OpCode 0x9B (untested)
- * @note Set the PWM output signal's period attribute. System
- * intended for periods greater than one second but can handle
- * values less than one second as well.
+ * @brief OpCode 0x2C
+ * @note Set the format that the loggers write telemetry in.
+ * Ignored when the raw log store is used; it only holds binary
+ * records.
+ * Binary records are about a quarter the size of a .csv line;
+ * compressed blocks are about a third of a binary record.
+ * Both keep temperatures to 0.02 degrees.
+ * Get Log (0x11) returns .csv lines in either format.
+ * The format is kept over restarts.
  * 
- * @param float Time (seconds)
+ * @param 0x00 CSV (.csv line per sample)
+ * @param 0x01 Binary (fixed-size record per sample)
+ * @param 0x02 Compressed (delta encoded blocks)
  * 
  * @return VALID if value was set
- * @return INVALID if experiment was active and value was not set 
+ * @return INVALID if a logger is active and value was not set
+ * @return UNKNOWN if undefined parameter
  */
-void i2c_set_pwm_period(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        //convert raw hex to float
-        union {
-            float float_data;
-            uint32_t uint_data;
-        } float_to_uint = { .uint_data = parameter };
-
-        //check float value
-        if(float_to_uint.float_data < pwmControl::minPeriod) {
-            i2c.write_one_byte(0xFD);
-        }
-        else{
-            payload.pwm_period = float_to_uint.float_data;
-            ESP_LOGI(TAG_i2c, "Exp PWM Period set to %f s", (float)payload.pwm_period);
-
-            i2c.write_one_byte(i2cControl::validByte);
-        }
+void i2c_set_log_format(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
+    }
 
+    if(parameter > experimentControl::LOG_COMPRESSED) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
     }
-    else{
+    else if(payload.status || payload.passive_logger_status) {
+        //do not allow changing while a logger is active
         i2c.write_one_byte(i2cControl::invalidByte);
     }
+    else {
+        log_set_format(parameter);
+        log_save_format(parameter);
+
+        i2c.write_one_byte(i2cControl::validByte);
+    }
 }
 
 /**
- * @brief OpCode 0x4E (untested)
- * @note Set the temperature threshold to trigger safe mode
+ * @brief OpCode 0x3B
+ * @note Returns a storage metric
  * 
- * @param float Temperature (kelvin) 
+ * @param 0x01 Log ring occupancy (bytes)
+ * @param 0x02 Log ring peak occupancy (bytes)
+ * @param 0x03 Log ring flush count
+ * @param 0x04 Last flush latency (micro-seconds)
+ * @param 0x05 Max flush latency (micro-seconds)
+ * @param 0x06 Records dropped by the log ring
+ * @param 0x07 Bytes written to the log file since boot
+ * @param 0x08 Log file write errors since boot
+ * @param 0x09 Median write latency (micro-seconds, within 2x)
+ * @param 0x0A 99th percentile write latency (micro-seconds, within 2x)
+ * @param 0x0B Flash maintenance steps run
+ * @param 0x0C Flash free (SPIFFS unused bytes, or bytes erased ahead
+ * in the log store)
+ * @param 0x0D Sector erases done while appending (log store)
+ * @param 0x0E Log segments kept
+ * @param 0x0F Bytes kept in the log segments
+ * @param 0x10 Log segments evicted since boot
+ * @param 0x11 Number of the oldest log line kept
+ * @param 0x12 Samples refused by the stream's rate limit since boot
+ * @param 0x13 Log ring flushes done by the logger instead of the stream writer
+ * @param 0x14 Log segments compacted into archives since boot
+ * @param 0x15 Bytes freed by compaction since boot
+ * @param 0x16 Log lines downloaded since boot
+ * @param 0x17 Downloaded lines that left less heap free than
+ * before (counts allocations of other tasks too, so it is an
+ * upper bound; 0 while downloads do not allocate)
+ * @param 0x18 Log file blocks read ahead for downloads since boot
  * 
- * @return VALID upon setting value
+ * Log ring, log segment and rate limit metrics are of the stream
+ * being read (0x2D).
+ * Write latency is the log ring flush, or a log store append.
+ * 
+ * @return uint32_t metric value
+ * @return UNKNOWN if undefined parameter
  */
-void i2c_set_max_temperature(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        //convert raw hex to float
-        union {
-            float float_data;
-            uint32_t uint_data;
-        } float_to_uint = { .uint_data = parameter };
-
-        payload.max_temperature = float_to_uint.float_data;
-        ESP_LOGI(TAG_i2c, "Exp Max Temperature set to %f s", (float)payload.max_temperature);
-
-        i2c.write_one_byte(i2cControl::validByte);
+void i2c_get_storage_metric(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
     }
-    else{
-        i2c.write_one_byte(i2cControl::invalidByte);
+
+    switch(parameter) {
+        case 0x01: i2c.write_four_bytes(log_ring->getOccupancy()); break;
+        case 0x02: i2c.write_four_bytes(log_ring->getPeakOccupancy()); break;
+        case 0x03: i2c.write_four_bytes(log_ring->getFlushCount()); break;
+        case 0x04: i2c.write_four_bytes(log_ring->getLastFlushLatency()); break;
+        case 0x05: i2c.write_four_bytes(log_ring->getMaxFlushLatency()); break;
+        case 0x06: i2c.write_four_bytes(log_ring->getDropped()); break;
+        case 0x07: i2c.write_four_bytes(log_ring->getBytesWritten()); break;
+        case 0x08: i2c.write_four_bytes(log_ring->getWriteErrors()); break;
+        case 0x09: i2c.write_four_bytes(write_latency()->percentile(50)); break;
+        case 0x0A: i2c.write_four_bytes(write_latency()->percentile(99)); break;
+        case 0x0B: i2c.write_four_bytes(maintenance.getSteps()); break;
+        case 0x0C: i2c.write_four_bytes(maintenance.getFreeBytes()); break;
+        case 0x0D: i2c.write_four_bytes(store.getForegroundErases()); break;
+        case 0x0E: i2c.write_four_bytes(log_ring->getSegmentCount()); break;
+        case 0x0F: i2c.write_four_bytes(log_ring->getRetainedBytes()); break;
+        case 0x10: i2c.write_four_bytes(log_ring->getEvicted()); break;
+        case 0x11: i2c.write_four_bytes(log_ring->getOldest()); break;
+        case 0x12: i2c.write_four_bytes(log_streams[payload.log_stream].getLimited()); break;
+        case 0x13: i2c.write_four_bytes(log_ring->getForegroundFlushes()); break;
+        case 0x14: i2c.write_four_bytes(compactor.getCompacted()); break;
+        case 0x15: i2c.write_four_bytes(compactor.getBytesSaved()); break;
+        case 0x16: i2c.write_four_bytes(download_lines); break;
+        case 0x17: i2c.write_four_bytes(download_heap_lines); break;
+        case 0x18: i2c.write_four_bytes(log_reader.getBlocksRead() + range_reader.getBlocksRead()); break;
+        default:
+            ESP_LOGW(TAG_i2c, "Invalid Parameter");
+            i2c.write_one_byte(i2cControl::unknownByte);
     }
 }
 
 /**
- * @brief OpCode 0x97
- * @note Set the amount of time that the log task will pass in
- * between samples. A lower number means more frequent samples
- * and a higher number means less frequent samples.
+ * @brief OpCode 0x3C
+ * @note Returns a flash wear metric. Counters are kept for
+ * the life of the flash: they are saved to NVS at most every
+ * 10 minutes (or 256 KB written) and before a restart, so a
+ * reset loses at most that much.
  * 
- * @param uint32_t Time (milli-seconds)
+ * @param 0x01 Bytes written to the log partition (lower 32 bits)
+ * @param 0x02 Bytes written to the log partition (upper 32 bits)
+ * @param 0x03 Log writes (ring flushes or log store appends)
+ * @param 0x04 Mean log write latency (micro-seconds)
+ * @param 0x05 Max log write latency (micro-seconds)
+ * @param 0x06 Sector erases (log store only; SPIFFS erases
+ * inside its own garbage collection)
+ * @param 0x07 Most erases of any one sector
+ * @param 0x08 Boots counted
+ * @param 0x09 Saves to NVS since boot
+ * @param 0x1000 to 0x11FF Erases of sector 0 to 511
  * 
- * @return VALID if value was set
- * @return INVALID if experiment was active and value was not set 
+ * @return uint32_t metric value
+ * @return UNKNOWN if undefined parameter
  */
-void i2c_set_sampling_interval(i2cControl::parameter_t parameter){
-    //do not allow changing while experiment is active
-    if(!payload.status){
-        payload.sample_interval = parameter;
-        ESP_LOGI(TAG_i2c, "Exp Sampling Interval set to %i ms", (int)payload.sample_interval);
+void i2c_get_wear_metric(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
+    }
 
-        i2c.write_one_byte(i2cControl::validByte);
+    if(parameter >= 0x1000 && parameter < 0x1000 + spiffsControl::wearMaxSectors) {
+        i2c.write_four_bytes(wear.getSectorErases(parameter - 0x1000));
+        return;
     }
-    else{
-        i2c.write_one_byte(i2cControl::invalidByte);
+
+    switch(parameter) {
+        case 0x01: i2c.write_four_bytes((uint32_t)wear.getBytesWritten()); break;
+        case 0x02: i2c.write_four_bytes((uint32_t)(wear.getBytesWritten() >> 32)); break;
+        case 0x03: i2c.write_four_bytes((uint32_t)wear.getAppends()); break;
+        case 0x04: i2c.write_four_bytes(wear.getMeanLatency()); break;
+        case 0x05: i2c.write_four_bytes(wear.getMaxLatency()); break;
+        case 0x06: i2c.write_four_bytes(wear.getErases()); break;
+        case 0x07: i2c.write_four_bytes(wear.getMaxSectorErases()); break;
+        case 0x08: i2c.write_four_bytes(wear.getBoots()); break;
+        case 0x09: i2c.write_four_bytes(wear.getSaves()); break;
+        default:
+            ESP_LOGW(TAG_i2c, "Invalid Parameter");
+            i2c.write_one_byte(i2cControl::unknownByte);
     }
 }
 
 /**
- * @brief OpCode 0x9E
- * @note Set the amount of time that the passivelog task
- * will pass in between samples. A lower number means more
- * frequent samples and a higher number means less frequent
- * samples.
+ * @brief OpCode 0x3D
+ * @note Returns how long the log can be written before the
+ * partition is full, at the loggers' sampling intervals (or
+ * their stream's rate limit, 0x85) and the current log
+ * format (0x2C). The record size is an upper bound for .csv
+ * and compressed logs, so the forecast is conservative. Past
+ * it, the oldest records are evicted (0x83, 0x84).
  * 
- * @param uint32_t Time (milli-seconds)
+ * @param 0x00 Running loggers
+ * @param 0x01 Experiment logger, as if it were running alone
+ * @param 0x02 Passive logger, as if it were running alone
+ * @param 0x03 Both loggers
+ * @param 0x10 Free bytes
+ * @param 0x11 Bytes per sample
  * 
- * @return VALID if value was set
- * @return INVALID if task is active and value was not set 
+ * @return uint32_t Time (hours), 0xFFFFFFFF if nothing is logged
+ * @return uint32_t bytes for 0x10 and 0x11
+ * @return UNKNOWN if undefined parameter
  */
-void i2c_set_passive_sampling_interval(i2cControl::parameter_t parameter){
-    //do not allow changing while task is active
-    if(!payload.passive_logger_status){
-        payload.sample_passive_interval = parameter;
-        ESP_LOGI(TAG_i2c, "Passive Sampling Interval set to %i ms", (int)payload.sample_passive_interval);
+void i2c_get_capacity_forecast(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
+    }
 
-        i2c.write_one_byte(i2cControl::validByte);
+    bool experiment, passive;
+    switch(parameter) {
+        case 0x00:
+            experiment = payload.status != experimentControl::EXP_INACTIVE;
+            passive = payload.passive_logger_status;
+            break;
+        case 0x01: experiment = true; passive = false; break;
+        case 0x02: experiment = false; passive = true; break;
+        case 0x03: experiment = true; passive = true; break;
+        case 0x10: i2c.write_four_bytes(log_free_bytes()); return;
+        case 0x11: i2c.write_four_bytes(sample_flash_size()); return;
+        default:
+            ESP_LOGW(TAG_i2c, "Invalid Parameter");
+            i2c.write_one_byte(i2cControl::unknownByte);
+            return;
     }
-    else{
-        i2c.write_one_byte(i2cControl::invalidByte);
+
+    uint64_t samples = 0; //per hour
+    if(experiment) samples += stream_samples_per_hour(experimentControl::LOG_STREAM_EXPERIMENT);
+    if(passive) samples += stream_samples_per_hour(experimentControl::LOG_STREAM_PASSIVE);
+
+    uint64_t bytes = samples * sample_flash_size(); //per hour
+    uint64_t hours = bytes > 0 ? log_free_bytes() / bytes : UINT32_MAX;
+    i2c.write_four_bytes(hours < UINT32_MAX ? (uint32_t)hours : UINT32_MAX);
+}
+
+/**
+ * @brief OpCode 0x83
+ * @note Set how many bytes of the log of the stream being
+ * read (0x2D) are kept.
+ * When a log segment is closed or the partition is full, the
+ * oldest segments are evicted until the log fits, so long
+ * passive logging runs without reset_log. Default is 0.
+ * 
+ * @param uint32_t Size (bytes), 0 for a share of 3/4 of the
+ * partition, split with the other logs that hold data
+ * 
+ * @return VALID
+ */
+void i2c_set_log_retention_size(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
     }
+
+    log_ring->setRetention(parameter, log_ring->getRetentionAge());
+    i2c.write_one_byte(i2cControl::validByte);
 }
 
 /**
- * @brief OpCode 0x0F (deprecated)
- * @note Prepares experiment log file to be read by the
- * I2C system. This function must be called before get_log
+ * @brief OpCode 0x84
+ * @note Set how long a closed log segment of the stream being
+ * read (0x2D) is kept after its last write. Older segments are
+ * evicted when the next segment is closed. Default is 0.
  * 
- * @param _unused
+ * @param uint32_t Time (seconds), 0 for no limit
  * 
- * @return VALID when log is ready to be read :)
+ * @return VALID
  */
-void i2c_prepare_log(i2cControl::parameter_t parameter){
+void i2c_set_log_retention_age(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_LOG)) {
+        return;
+    }
+
+    log_ring->setRetention(log_ring->getRetentionBytes(), parameter);
+    i2c.write_one_byte(i2cControl::validByte);
 }
 
 /**
- * @brief OpCode 0x11
- * @note Returns an individual line from the experiment
- * log file. This function must be called after prepare_log.
- * The first call will return the first line, the second
- * call will return the second line, etc... If there is no
- * line to send, it will close the file.
+ * @brief OpCode 0x2D
+ * @note Select the log stream that Get Log (0x11), Get Log
+ * Range (0x12), the read sessions (0x23-0x26) and the log
+ * metrics read. Each logger writes its own stream, so the
+ * experiment samples can be downloaded without the passive
+ * ones. Downloads in progress start over; sessions carry on
+ * from their watermark in the selected stream.
  * 
- * @param _unused
+ * @param 0x00 Experiment logger
+ * @param 0x01 Passive logger
  * 
- * @return string containing one line of log data
- * @return INVALID if there is no log data to return
+ * @return VALID if stream was selected
+ * @return UNKNOWN if undefined parameter
  */
-void i2c_get_log(i2cControl::parameter_t parameter){
-    string buffer;
-    int line;
+void i2c_set_log_stream(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_SESSIONS)) {
+        return;
+    }
 
-    line = file.readLine(LOG_FILE_NAME,&buffer);
-    if(line != -1) {
-        i2c.write_string(buffer);
+    if(parameter >= experimentControl::logStreams) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+        return;
     }
-    else {
-        i2c.write_one_byte(i2cControl::invalidByte);
+
+    payload.log_stream = parameter;
+    log_ring = log_streams[payload.log_stream].getRing();
+    downloads_restart();
+    sessions_rewind();
+    ESP_LOGI(TAG_i2c, "Log Stream set to %i", (int)payload.log_stream);
+
+    i2c.write_one_byte(i2cControl::validByte);
+}
+
+/**
+ * @brief OpCode 0x85
+ * @note Set the least time between two samples logged to
+ * a stream. Samples a logger takes sooner are not logged, so
+ * a short interval on one logger cannot fill the partition.
+ * Default is 0.
+ * 
+ * @param uint32_t Stream in the most significant byte, time
+ * (milli-seconds) in the lower three bytes, 0 for no limit
+ * 
+ * @return VALID if value was set
+ * @return UNKNOWN if undefined stream
+ */
+void i2c_set_log_stream_rate(i2cControl::parameter_t parameter){
+    uint8_t stream = parameter >> 24;
+
+    if(stream >= experimentControl::logStreams) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+        return;
     }
+
+    log_streams[stream].setInterval(parameter & 0x00FFFFFF);
+    i2c.write_one_byte(i2cControl::validByte);
 }
 
 /**
- * @brief OpCode 0x1C
- * @note Deletes the experiment log and creates a blank
- * log.
+ * @brief OpCode 0x86
+ * @note Set a tier of the storage policy. While less flash
+ * is free than a tier's threshold, throttled loggers (0x88)
+ * sample its multiplier times slower, so a campaign keeps
+ * logging instead of filling the partition. The tier with
+ * the lowest threshold above the free flash applies. A tier
+ * is left once the free flash is 16 KB above its threshold.
+ * Defaults: 2x below 256 KB, 4x below 128 KB, 8x below
+ * 64 KB. The log format is not changed by the policy; set
+ * compressed blocks with Set Log Format (0x2C).
  * 
- * @param _unused
+ * @param uint32_t Tier (0-3) in bits 31-30, bit 29 unused,
+ * multiplier (1-31) in bits 28-24, threshold (bytes free,
+ * 0 to remove the tier) in bits 23-0
  * 
- * @return VALID upon log reset 
- * @return INVALID if SPI error
+ * @return VALID if tier was set
+ * @return UNKNOWN if multiplier is 0
  */
-void i2c_reset_log(i2cControl::parameter_t parameter){
-    //erase log
-    file.clearLog(LOG_FILE_NAME);
+void i2c_set_storage_policy_tier(i2cControl::parameter_t parameter){
+    int tier = (parameter >> 30) & 0x03;
+    uint8_t stretch = (parameter >> 24) & 0x1F;
 
-    telemetryControl::Telemetry active;
+    if(!policy.setTier(tier, parameter & 0x00FFFFFF, stretch)) {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+        return;
+    }
+    i2c.write_one_byte(i2cControl::validByte);
+}
 
-    //add header
-    char header[spiffsControl::buffer_size];
-    active.headerCSV(header);
-    file.addLine(LOG_FILE_NAME, header);
+/**
+ * @brief OpCode 0x87
+ * @note Returns the state of the storage policy
+ * 
+ * @param 0x00 Tier that applies, 0xFFFFFFFF if none
+ * @param 0x01 Experiment sampling interval as throttled (milli-seconds)
+ * @param 0x02 Passive sampling interval as throttled (milli-seconds)
+ * @param 0x03 Free bytes at the last check
+ * @param 0x04 Tier changes since boot
+ * @param 0x05 Throttled log streams (bitmap)
+ * 
+ * @return uint32_t value
+ * @return UNKNOWN if undefined parameter
+ */
+void i2c_get_storage_policy(i2cControl::parameter_t parameter){
+    switch(parameter) {
+        case 0x00: i2c.write_four_bytes((uint32_t)policy.getActive()); break;
+        case 0x01: i2c.write_four_bytes(policy.stretch(experimentControl::LOG_STREAM_EXPERIMENT, payload.sample_interval)); break;
+        case 0x02: i2c.write_four_bytes(policy.stretch(experimentControl::LOG_STREAM_PASSIVE, payload.sample_passive_interval)); break;
+        case 0x03: i2c.write_four_bytes(policy.getFreeBytes()); break;
+        case 0x04: i2c.write_four_bytes(policy.getChanges()); break;
+        case 0x05: i2c.write_four_bytes(policy.getStreams()); break;
+        default:
+            ESP_LOGW(TAG_i2c, "Invalid Parameter");
+            i2c.write_one_byte(i2cControl::unknownByte);
+    }
+}
 
+/**
+ * @brief OpCode 0x88
+ * @note Set which loggers the storage policy throttles.
+ * Default is the passive logger only.
+ * 
+ * @param uint32_t Bitmap, bit 0 experiment logger, bit 1
+ * passive logger
+ * 
+ * @return VALID
+ */
+void i2c_set_storage_policy_streams(i2cControl::parameter_t parameter){
+    policy.setStreams(parameter & ((1 << experimentControl::logStreams) - 1));
     i2c.write_one_byte(i2cControl::validByte);
 }
 
@@ -870,10 +2496,14 @@ void i2c_reset_log(i2cControl::parameter_t parameter){
  */
 void i2c_passive_logger(i2cControl::parameter_t parameter){
     if(parameter == 0x01) { //start logger
+        if(!boot_check(BOOT_NEEDS_LOG | BOOT_NEEDS_ADC)) {
+            return;
+        }
+
         //check if passive logger is already running
         if(payload.passive_logger_status == false) {
             //start task
-            xTaskCreatePinnedToCore(exp_log, "plogger", 4096, (void *) &payload.sample_passive_interval, 1, &exp_plog_task, 1);
+            logger_start(&passive_logger, "plogger", 1);
             payload.passive_logger_status = true;
             ESP_LOGI(TAG_i2c, "Passive Log Task started");
 
@@ -886,8 +2516,10 @@ void i2c_passive_logger(i2cControl::parameter_t parameter){
     }
     else if(parameter == 0x02) { //stop logger
         if(payload.passive_logger_status == true) {
-
-            vTaskDelete(exp_plog_task);
+            //the logger ends once its current sample is appended
+            logger_stop(&passive_logger);
+            rollup_seal();
+            log_flush();
             payload.passive_logger_status = false;
             ESP_LOGI(TAG_i2c, "Passive Log Task Deleted");
 
@@ -974,6 +2606,11 @@ void i2c_set_time(i2cControl::parameter_t parameter){
 /**
  * @brief Opcode 0x34
  * @note Returns the temperature of a specified sensor
+ * from the newest sweep of the sampling service, at most
+ * the fastest logger interval old. With no logger running,
+ * the sensors are swept first if the newest sweep is more
+ * than 1 second old. NaN while the thermistors are
+ * unpowered, or if no sweep could be made.
  * 
  * @param 0x00 Sensor 0
  * @param 0x01 Sensor 1
@@ -984,6 +2621,10 @@ void i2c_set_time(i2cControl::parameter_t parameter){
  * @return UNKNOWN if the parameter is undefined
  */
 void i2c_get_temperature(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_ADC)) {
+        return;
+    }
+
     ESP_LOGW(TAG_i2c, "PARAMETER: %02X", (int)parameter);
     if(parameter >= telemetryControl::numSensors) {
         i2c.write_one_byte(i2cControl::unknownByte);
@@ -991,8 +2632,10 @@ void i2c_get_temperature(i2cControl::parameter_t parameter){
 
     }
     else {
-        float temperature;
-        temperature = sensor.sample(parameter);
+        adcControl::snapshot sweep;
+        sampler.refresh(100 / portTICK_PERIOD_MS);
+        sampler.latest(&sweep);
+        float temperature = sweep.temperature[parameter];
         union {
             float float_data;
             uint32_t uint_data;
@@ -1002,6 +2645,55 @@ void i2c_get_temperature(i2cControl::parameter_t parameter){
     }
 }
 
+/**
+ * @brief OpCode 0x35
+ * @note Set how fast ADC1 (sensors 0-7) is scanned by DMA.
+ * Samples of sensors 0-7 are the mean of the newest 256
+ * scans of each sensor, so a sweep does not wait on the
+ * ADC. Sensors 8-15 are on ADC2, which the ESP32 can only
+ * read in oneshot mode. Default is 20000.
+ * 
+ * @param uint32_t Conversions per second over all 8 channels
+ * (20000 to 2000000), 0 for oneshot reads of ADC1 as well
+ * 
+ * @return VALID if the rate was set
+ * @return INVALID if the scan could not be started
+ */
+void i2c_set_adc_rate(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_ADC)) {
+        return;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if(parameter == 0) {
+        ret = sensor.setContinuous(false);
+    }
+    else {
+        ret = sensor.getContinuous()->setRate(parameter);
+        if(ret == ESP_OK) ret = sensor.setContinuous(true);
+    }
+
+    i2c.write_one_byte(ret == ESP_OK ? i2cControl::validByte : i2cControl::invalidByte);
+}
+
+/**
+ * @brief OpCode 0x36
+ * @note Returns how long the last sweep of all 16
+ * sensors by the sampling service took
+ * 
+ * @param _unused
+ * 
+ * @return uint32_t sweep duration in microseconds, 0
+ * before the first sweep
+ */
+void i2c_get_sweep_time(i2cControl::parameter_t parameter){
+    if(!boot_check(BOOT_NEEDS_ADC)) {
+        return;
+    }
+
+    i2c.write_four_bytes(sensor.getSweepTime());
+}
+
 /**
  * @brief OpCode 0x15
  * @note Returns the current PWM Duty value
@@ -1014,6 +2706,132 @@ void i2c_get_pwm_duty(i2cControl::parameter_t parameter){
     i2c.write_one_byte(pwm.getDutyCycle());
 }
 
+/**
+ * @brief OpCode 0x27
+ * @note Returns which subsystems are up, or when a boot
+ * phase finished. I2C answers as soon as the application
+ * starts; storage and the ADC are brought up afterwards
+ * by a background task. Handlers that need a subsystem
+ * that is not up yet return INVALID.
+ * Bit n of the bitmap is set once phase n is done:
+ * 0 I2C, 1 PWM, 2 storage mounted and checked, 3 logs
+ * recovered and log tasks running, 4 read sessions loaded,
+ * 5 ADC.
+ * 
+ * @param 0x00 Ready bitmap
+ * @param 0x01 to 0x06 Time phase 0 to 5 finished (micro-seconds
+ * since start-up, 0 if not done yet)
+ * 
+ * @return uint32_t bitmap or time
+ * @return UNKNOWN if undefined parameter
+ */
+void i2c_get_boot_status(i2cControl::parameter_t parameter){
+    if(parameter == 0x00) {
+        i2c.write_four_bytes(boot_ready);
+    }
+    else if(parameter <= BOOT_PHASES) {
+        i2c.write_four_bytes(boot_times[parameter - 1]);
+    }
+    else {
+        ESP_LOGW(TAG_i2c, "Invalid Parameter");
+        i2c.write_one_byte(i2cControl::unknownByte);
+    }
+}
+
+/**
+ * @brief Task that brings up storage and the ADC after
+ * i2c is answering. Deletes itself when done.
+ * 
+ * @param pvParameters none
+ */
+void boot_init(void *pvParameters){
+    (void)pvParameters;
+
+    // Storage
+    file.init();
+    if(spiffsControl::useLogStore) {
+        store.setCounters(store_appended, store_erased);
+        store.mount();
+    }
+    boot_done(BOOT_STORAGE);
+
+    // Log segments and recovery
+    if(!spiffsControl::useLogStore) {
+        for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+            for(int format = experimentControl::LOG_CSV; format <= experimentControl::LOG_COMPRESSED; format++) {
+                log_segments[stream][format].scan();
+            }
+        }
+        log_recover();
+
+        for(int tier = 0; tier < ROLLUP_TIERS; tier++) {
+            rollup_segments[tier].scan();
+            file.recover(rollup_segments[tier].getActivePath(), telemetryControl::sizeRollup, rollup_check);
+        }
+    }
+
+    // Log format kept over the restart; NVS also holds the sessions and wear
+    spiffsControl::logSession::init();
+    log_restore_format();
+
+    // Log index
+    log_streams[experimentControl::LOG_STREAM_EXPERIMENT].getRing()->setTimeSource(log_record_time_experiment);
+    log_streams[experimentControl::LOG_STREAM_PASSIVE].getRing()->setTimeSource(log_record_time_passive);
+
+    // Wear counting; loaded with the sessions, once NVS is up
+    for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+        log_streams[stream].getRing()->setWear(&wear);
+    }
+    for(int tier = 0; tier < ROLLUP_TIERS; tier++) {
+        rollup_streams[tier].getRing()->setWear(&wear);
+        rollup_streams[tier].getRing()->setRetention(rollupRetention[tier], 0);
+    }
+    compactor.setWear(&wear);
+    maintenance.setWear(&wear);
+
+    // Log streams, written by one task
+    if(!spiffsControl::useLogStore) {
+        for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+            stream_writer.add(&log_streams[stream]);
+        }
+        for(int tier = 0; tier < ROLLUP_TIERS; tier++) {
+            stream_writer.add(&rollup_streams[tier]);
+        }
+        stream_writer.start();
+    }
+
+    // Log compaction, between experiments
+    if(!spiffsControl::useLogStore) {
+        for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+            compactor.add(log_streams[stream].getRing());
+        }
+        compactor.start(compact_line, compact_idle);
+    }
+
+    // Flash maintenance
+    maintenance.start(log_idle);
+    boot_done(BOOT_LOGS);
+
+    // Read sessions
+    for(int stream = 0; stream < experimentControl::logStreams; stream++) {
+        for(int i = 0; i < spiffsControl::maxSessions; i++) {
+            sessions[stream][i].load(i, stream, &log_streams[stream], &store);
+        }
+    }
+    wear.load();
+    boot_done(BOOT_SESSIONS);
+
+    // ADC, sensors 0-7 scanned by DMA
+    sensor.init();
+    sensor.setContinuous(true);
+    sensor.powerOn();
+    sampler.start();
+    boot_done(BOOT_ADC);
+
+    ESP_LOGI(TAG, "Boot completed in %lu us", (unsigned long)boot_times[BOOT_ADC]);
+    vTaskDelete(NULL);
+}
+
 extern "C" void app_main(void)
 {
     set_system_time_to_compile();
@@ -1026,12 +2844,6 @@ extern "C" void app_main(void)
     // i2c setup
     i2c.init();
 
-    // PWM setup
-    pwm.initPWM();
-
-    // ADC
-    sensor.powerOn();
-
     //define i2c handler call functions
     i2c.install_handler_unused(i2c_unused);
     i2c.install_handler_ignore(i2c_ignore);
@@ -1050,6 +2862,8 @@ extern "C" void app_main(void)
     i2c.install_handler(0x32, i2c_get_time);
     i2c.install_handler(0x93, i2c_set_time);
     i2c.install_handler(0x34, i2c_get_temperature);
+    i2c.install_handler(0x35, i2c_set_adc_rate);
+    i2c.install_handler(0x36, i2c_get_sweep_time);
     i2c.install_handler(0x15, i2c_get_pwm_duty);
     i2c.install_handler(0x16, i2c_get_current_stage);
     i2c.install_handler(0x97, i2c_set_sampling_interval);
@@ -1061,8 +2875,39 @@ extern "C" void app_main(void)
     i2c.install_handler(0x9D, i2c_set_individual_length);
     i2c.install_handler(0x9E, i2c_set_passive_sampling_interval);
     i2c.install_handler(0x3F, i2c_passive_logger);
+    i2c.install_handler(0x2C, i2c_set_log_format);
+    i2c.install_handler(0x3B, i2c_get_storage_metric);
+    i2c.install_handler(0x61, i2c_seek_log);
+    i2c.install_handler(0x81, i2c_set_log_range_start);
+    i2c.install_handler(0x82, i2c_set_log_range_end);
+    i2c.install_handler(0x12, i2c_get_log_range);
+    i2c.install_handler(0x13, i2c_get_log_raw);
+    i2c.install_handler(0x14, i2c_get_rollup);
+    i2c.install_handler(0x23, i2c_rewind_session);
+    i2c.install_handler(0x24, i2c_get_session_log);
+    i2c.install_handler(0x25, i2c_commit_session);
+    i2c.install_handler(0x26, i2c_get_session_watermark);
+    i2c.install_handler(0x83, i2c_set_log_retention_size);
+    i2c.install_handler(0x84, i2c_set_log_retention_age);
+    i2c.install_handler(0x2D, i2c_set_log_stream);
+    i2c.install_handler(0x85, i2c_set_log_stream_rate);
+    i2c.install_handler(0x27, i2c_get_boot_status);
+    i2c.install_handler(0x3C, i2c_get_wear_metric);
+    i2c.install_handler(0x3D, i2c_get_capacity_forecast);
+    i2c.install_handler(0x86, i2c_set_storage_policy_tier);
+    i2c.install_handler(0x87, i2c_get_storage_policy);
+    i2c.install_handler(0x88, i2c_set_storage_policy_streams);
+
+    //answer the OBC before anything slow runs
+    xTaskCreatePinnedToCore(i2c_scan, "SCAN", 4096, NULL, tskIDLE_PRIORITY, NULL, 0); //i2c on core 0
+    boot_done(BOOT_I2C);
 
-    ESP_LOGI(TAG, "Setup completed.");
+    // PWM setup
+    pwm.initPWM();
+    boot_done(BOOT_PWM);
 
-    xTaskCreatePinnedToCore(i2c_scan, "SCAN", 4096, NULL, tskIDLE_PRIORITY, NULL, 0); //i2c on core 0
+    // Storage and ADC, in the background
+    xTaskCreatePinnedToCore(boot_init, "boot", 4096, NULL, 1, NULL, 1);
+
+    ESP_LOGI(TAG, "Setup completed.");
 }
\ No newline at end of file